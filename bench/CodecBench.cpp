@@ -0,0 +1,73 @@
+#include <benchmark/benchmark.h>
+
+#include <string>
+
+#include "codec.hpp"
+#include "message.hpp"
+
+namespace {
+/// Creates post request with payload of given size
+havka::Request makeRequest(std::size_t size) {
+    havka::Request request;
+    std::string data(size, 'x');
+    request.message = havka::Message();
+    request.message->setData(data.c_str(), data.size(),
+                             havka::MessageDataType::Binary);
+    request.topic = "orders.created.eu";
+    request.type = havka::RequestType::PostMessageSafe;
+    return request;
+}
+
+/// Creates get response with payload of given size
+havka::Response makeResponse(std::size_t size) {
+    havka::Response response;
+    std::string data(size, 'x');
+    response.message = havka::Message();
+    response.message->setData(data.c_str(), data.size(),
+                              havka::MessageDataType::Binary);
+    response.topic = "orders.created.eu";
+    response.type = havka::ResponseType::GetSuccess;
+    return response;
+}
+
+void BM_EncodeRequest(benchmark::State& state) {
+    auto request = makeRequest(state.range(0));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(havka::encode(request));
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+
+void BM_DecodeRequest(benchmark::State& state) {
+    auto frame = havka::encode(makeRequest(state.range(0)));
+    havka::Request request;
+    for (auto _ : state) {
+        havka::decode(frame.data(), frame.size(), request);
+        benchmark::DoNotOptimize(request);
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+
+void BM_EncodeResponse(benchmark::State& state) {
+    auto response = makeResponse(state.range(0));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(havka::encode(response));
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+
+void BM_DecodeResponse(benchmark::State& state) {
+    auto frame = havka::encode(makeResponse(state.range(0)));
+    havka::Response response;
+    for (auto _ : state) {
+        havka::decode(frame.data(), frame.size(), response);
+        benchmark::DoNotOptimize(response);
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+}  // namespace
+
+BENCHMARK(BM_EncodeRequest)->RangeMultiplier(16)->Range(16, 1 << 20);
+BENCHMARK(BM_DecodeRequest)->RangeMultiplier(16)->Range(16, 1 << 20);
+BENCHMARK(BM_EncodeResponse)->RangeMultiplier(16)->Range(16, 1 << 20);
+BENCHMARK(BM_DecodeResponse)->RangeMultiplier(16)->Range(16, 1 << 20);
@@ -0,0 +1,39 @@
+#include <benchmark/benchmark.h>
+
+#include <memory>
+
+#include "server/queue.h"
+
+namespace {
+/// Queue shared by all threads of one benchmark run
+std::shared_ptr<havka::MutexQueue<havka::Message>> queue;
+
+/**
+ * Every thread pushes a message and pops one, so the queue
+ * stays short and threads contend on its mutex.
+ */
+void BM_MutexQueuePushPop(benchmark::State& state) {
+    if (state.thread_index() == 0) {
+        queue = std::make_shared<havka::MutexQueue<havka::Message>>();
+    }
+    havka::Message message;
+    std::string data(state.range(0), 'x');
+    message.setData(data.c_str(), data.size(), havka::MessageDataType::Text);
+
+    for (auto _ : state) {
+        queue->push(message);
+        benchmark::DoNotOptimize(queue->pop());
+    }
+    state.SetItemsProcessed(state.iterations() * 2);
+    state.SetBytesProcessed(state.iterations() * 2 * state.range(0));
+    if (state.thread_index() == 0) {
+        queue.reset();
+    }
+}
+}  // namespace
+
+BENCHMARK(BM_MutexQueuePushPop)
+    ->Arg(16)
+    ->Arg(1024)
+    ->ThreadRange(1, 16)
+    ->UseRealTime();
@@ -0,0 +1,41 @@
+#include <benchmark/benchmark.h>
+
+#include <string>
+#include <vector>
+
+#include "server/storage.h"
+
+namespace {
+/**
+ * Posts message to one of range(0) topics and gets it back,
+ * measures topic lookup and queue cost as the number of topics grows.
+ */
+void BM_RamStoragePostGet(benchmark::State& state) {
+    auto storage =
+        havka::createMessageStorage(StorageType::RAM, QueueType::MutexQueue);
+    std::vector<std::string> tags;
+    tags.reserve(state.range(0));
+    for (int64_t i = 0; i < state.range(0); ++i) {
+        tags.push_back("topic." + std::to_string(i));
+    }
+    havka::Message message;
+    message.setData("0123456789abcdef", 16, havka::MessageDataType::Text);
+    /// topics exist before measurement
+    for (const auto& tag : tags) {
+        storage->postMessage(message, tag);
+    }
+
+    std::size_t index = 0;
+    for (auto _ : state) {
+        const auto& tag = tags[index];
+        storage->postMessage(message, tag);
+        benchmark::DoNotOptimize(storage->getMessageNonblocking(tag));
+        if (++index == tags.size()) {
+            index = 0;
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * 2);
+}
+}  // namespace
+
+BENCHMARK(BM_RamStoragePostGet)->RangeMultiplier(10)->Range(1, 100000);
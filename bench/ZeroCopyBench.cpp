@@ -0,0 +1,116 @@
+#include <benchmark/benchmark.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <ctime>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "server/zerocopy.h"
+
+namespace {
+/// Pair of connected TCP sockets on loopback, receiver drops all bytes
+class TcpPair {
+public:
+    TcpPair() {
+        int listener = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t length = sizeof(address);
+        bind(listener, reinterpret_cast<sockaddr*>(&address), length);
+        listen(listener, 1);
+        getsockname(listener, reinterpret_cast<sockaddr*>(&address), &length);
+        sender_ = socket(AF_INET, SOCK_STREAM, 0);
+        connect(sender_, reinterpret_cast<sockaddr*>(&address), length);
+        receiver_ = accept(listener, nullptr, nullptr);
+        close(listener);
+        thread_ = std::thread([this] {
+            std::vector<char> buffer(1 << 20);
+            while (read(receiver_, buffer.data(), buffer.size()) > 0) {
+            }
+        });
+    }
+
+    ~TcpPair() {
+        shutdown(sender_, SHUT_RDWR);
+        thread_.join();
+        close(sender_);
+        close(receiver_);
+    }
+
+    int getSender() const { return sender_; }
+
+private:
+    int sender_;
+    int receiver_;
+    std::thread thread_;
+};
+
+/// CPU time of calling thread in nanoseconds
+std::int64_t getThreadCpuNs() {
+    timespec time{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+    return time.tv_sec * 1000000000LL + time.tv_nsec;
+}
+
+/**
+ * Sends payload of range(0) bytes over loopback TCP, flags are passed to
+ * send. With zerocopy every payload is finished when its pages are
+ * released, as a connection of the server does.
+ */
+void sendPayloads(benchmark::State& state, bool zeroCopy) {
+    TcpPair pair;
+    int fd = pair.getSender();
+    if (zeroCopy && !havka::zerocopy::enable(fd)) {
+        state.SkipWithError("MSG_ZEROCOPY is not supported");
+        return;
+    }
+    int flags = zeroCopy ? havka::zerocopy::kSendFlag : 0;
+    std::string payload(state.range(0), 'x');
+    std::uint32_t sent = 0;
+    std::uint32_t completed = 0;
+    bool copied = false;
+
+    auto cpuStart = getThreadCpuNs();
+    for (auto _ : state) {
+        std::size_t offset = 0;
+        while (offset < payload.size()) {
+            auto length = send(fd, payload.data() + offset,
+                               payload.size() - offset, flags);
+            if (length < 0) {
+                state.SkipWithError("send failed");
+                return;
+            }
+            offset += length;
+            ++sent;
+        }
+        while (zeroCopy && completed != sent) {
+            pollfd events{fd, 0, 0};
+            poll(&events, 1, -1);
+            auto completions = havka::zerocopy::readCompletions(fd);
+            completed += completions.count;
+            copied = copied || completions.copied;
+        }
+    }
+    auto cpuNs = getThreadCpuNs() - cpuStart;
+
+    auto bytes = state.iterations() * state.range(0);
+    state.SetBytesProcessed(bytes);
+    state.counters["cpu_ms_per_GB"] =
+        bytes == 0 ? 0 : cpuNs / 1e6 / (static_cast<double>(bytes) / 1e9);
+    /// kernel copied data on delivery, numbers are not of real zerocopy
+    state.counters["copied"] = copied;
+}
+
+void BM_Send(benchmark::State& state) { sendPayloads(state, false); }
+
+void BM_SendZeroCopy(benchmark::State& state) { sendPayloads(state, true); }
+}  // namespace
+
+BENCHMARK(BM_Send)->RangeMultiplier(4)->Range(256 << 10, 4 << 20);
+BENCHMARK(BM_SendZeroCopy)->RangeMultiplier(4)->Range(256 << 10, 4 << 20);
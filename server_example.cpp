@@ -14,12 +14,12 @@ int main(int argc, char* argv[]) {
     /// Initializing ServerConfig object. Takes path to file.
     havka::ServerConfig config(config_path);
 
-    /// Initializing BrokerServer. Takes address, port, storage type,
+    /// Initializing BrokerServer. Takes config with address, port,
+    /// storage type, queue type, number of threads, timeout and other options.
+    /// There is also a constructor taking address, port, storage type,
     /// queue type, number of threads (default is -1, maximum)
     /// and timeout in seconds (default is -1, without timeout)
-    auto broker = std::make_unique<havka::BrokerServer>(
-        config.getAddress(), config.getPort(), config.getStorageType(),
-        config.getQueueType(), config.getThreadsNumber(), config.getTimeout());
+    auto broker = std::make_unique<havka::BrokerServer>(config);
 
     try {
         /// Running server. Blocking call.
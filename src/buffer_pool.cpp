@@ -0,0 +1,106 @@
+#include "buffer_pool.h"
+
+#include <cstring>
+#include <utility>
+
+namespace havka {
+
+BufferPool::~BufferPool() {
+    for (auto& sizeClass : classes_) {
+        for (auto data : sizeClass.free) {
+            delete[] data;
+        }
+    }
+}
+
+BufferPool& BufferPool::instance() {
+    static BufferPool pool;
+    return pool;
+}
+
+char* BufferPool::acquire(std::size_t& size) {
+    if (size > kMaxSize) {
+        return new char[size];
+    }
+    auto index = getClass_(size);
+    size = kMinSize << index;
+    auto& sizeClass = classes_[index];
+    {
+        std::lock_guard<std::mutex> lock(sizeClass.mutex);
+        if (!sizeClass.free.empty()) {
+            auto data = sizeClass.free.back();
+            sizeClass.free.pop_back();
+            freeBytes_.fetch_sub(size, std::memory_order_relaxed);
+            return data;
+        }
+    }
+    return new char[size];
+}
+
+void BufferPool::release(char* data, std::size_t size) {
+    if (size > kMaxSize) {
+        delete[] data;
+        return;
+    }
+    /// space is reserved first, so concurrent releases do not exceed limit
+    if (freeBytes_.fetch_add(size, std::memory_order_relaxed) + size >
+        kMaxFreeBytes) {
+        freeBytes_.fetch_sub(size, std::memory_order_relaxed);
+        delete[] data;
+        return;
+    }
+    auto& sizeClass = classes_[getClass_(size)];
+    std::lock_guard<std::mutex> lock(sizeClass.mutex);
+    sizeClass.free.push_back(data);
+}
+
+std::size_t BufferPool::getFreeBytes() {
+    return freeBytes_.load(std::memory_order_relaxed);
+}
+
+std::size_t BufferPool::getClass_(std::size_t size) {
+    std::size_t index = 0;
+    while ((kMinSize << index) < size) {
+        ++index;
+    }
+    return index;
+}
+
+PooledBuffer::PooledBuffer(PooledBuffer&& other) noexcept
+    : data_(std::exchange(other.data_, nullptr)),
+      capacity_(std::exchange(other.capacity_, 0)) {}
+
+PooledBuffer& PooledBuffer::operator=(PooledBuffer&& other) noexcept {
+    if (this != &other) {
+        release();
+        data_ = std::exchange(other.data_, nullptr);
+        capacity_ = std::exchange(other.capacity_, 0);
+    }
+    return *this;
+}
+
+PooledBuffer::~PooledBuffer() { release(); }
+
+void PooledBuffer::reserve(std::size_t size, std::size_t keep) {
+    if (size <= capacity_) {
+        return;
+    }
+    auto& pool = BufferPool::instance();
+    auto data = pool.acquire(size);
+    if (data_) {
+        std::memcpy(data, data_, keep);
+        pool.release(data_, capacity_);
+    }
+    data_ = data;
+    capacity_ = size;
+}
+
+void PooledBuffer::release() {
+    if (data_) {
+        BufferPool::instance().release(data_, capacity_);
+        data_ = nullptr;
+        capacity_ = 0;
+    }
+}
+
+}  // namespace havka
@@ -0,0 +1,123 @@
+#ifndef HAVKA_SRC_BUFFER_POOL_H_
+#define HAVKA_SRC_BUFFER_POOL_H_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+namespace havka {
+
+/// Process-wide pool of I/O buffers in power-of-two size classes
+/**
+ * Connections take a buffer only while they read or decode a frame and
+ * give it back when they wait for the next one, so idle connections hold
+ * no memory and a large frame costs memory only while it is handled.
+ * Free buffers of all classes are bounded by kMaxFreeBytes, so one large
+ * frame does not leave large buffers cached forever. Buffers larger than
+ * the largest class are not pooled.
+ */
+class BufferPool {
+public:
+    /// Size of the smallest class
+    static constexpr std::size_t kMinSize = 4096;
+    /// Size of the largest class
+    static constexpr std::size_t kMaxSize = 64 << 20;
+    /// Bytes of free buffers kept by the pool
+    static constexpr std::size_t kMaxFreeBytes = 16 << 20;
+
+    BufferPool() = default;
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    /**
+     * Frees cached buffers
+     */
+    ~BufferPool();
+
+    /**
+     * Returns pool shared by all connections of the process
+     * @return pool
+     */
+    static BufferPool& instance();
+
+    /**
+     * Takes buffer of at least given size
+     * @param size required size, rounded up to size of class
+     * @return buffer of size bytes
+     */
+    char* acquire(std::size_t& size);
+
+    /**
+     * Gives buffer back to the pool
+     * @param data buffer taken with acquire
+     * @param size size returned by acquire
+     */
+    void release(char* data, std::size_t size);
+
+    /**
+     * Returns number of bytes of free buffers kept by the pool
+     * @return bytes
+     */
+    std::size_t getFreeBytes();
+
+private:
+    static constexpr std::size_t kClasses = 15;
+    static_assert((kMinSize << (kClasses - 1)) == kMaxSize,
+                  "every power of two from kMinSize to kMaxSize has a class");
+
+    struct SizeClass {
+        std::mutex mutex;
+        std::vector<char*> free;
+    };
+
+    std::array<SizeClass, kClasses> classes_;
+    /// bytes of free buffers of all classes
+    std::atomic<std::size_t> freeBytes_{0};
+
+    static std::size_t getClass_(std::size_t size);
+};
+
+/// Growable buffer taken from BufferPool, given back on release
+class PooledBuffer {
+public:
+    PooledBuffer() = default;
+    PooledBuffer(const PooledBuffer&) = delete;
+    PooledBuffer& operator=(const PooledBuffer&) = delete;
+    PooledBuffer(PooledBuffer&& other) noexcept;
+    PooledBuffer& operator=(PooledBuffer&& other) noexcept;
+
+    ~PooledBuffer();
+
+    char* data() { return data_; }
+
+    const char* data() const { return data_; }
+
+    /**
+     * Returns size of buffer, 0 if it holds no memory
+     * @return size in bytes
+     */
+    std::size_t capacity() const { return capacity_; }
+
+    /**
+     * Grows buffer to at least size bytes
+     * @param size required size
+     * @param keep number of bytes at the start which are copied into the
+     * new buffer if it grows
+     */
+    void reserve(std::size_t size, std::size_t keep = 0);
+
+    /**
+     * Gives memory back to the pool
+     */
+    void release();
+
+private:
+    char* data_{nullptr};
+    std::size_t capacity_{0};
+};
+
+}  // namespace havka
+
+#endif  // HAVKA_SRC_BUFFER_POOL_H_
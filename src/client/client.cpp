@@ -1,33 +1,62 @@
 #include "client/client.h"
 
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#include "shm_ring.h"
+
 namespace havka {
 
 BrokerSyncClient::BrokerSyncClient(const net::ip::address &serverAddress,
                                    unsigned short serverPort,
                                    std::size_t maxBufferSize)
     : BrokerClient(serverAddress, serverPort),
-      endpoint_(serverAddress, serverPort),
       ioc_(std::make_shared<net::io_context>()),
-      resolver_(*ioc_),
+      endpoint_(tcp::endpoint(serverAddress, serverPort)),
+      socket_(*ioc_),
+      sharedMemory_(false),
+      bufSize_(0),
+      maxBufferSize_(maxBufferSize),
+      streamed_(false),
+      requestMessage_(nullptr),
+      isConnected_(false) {}
+
+BrokerSyncClient::BrokerSyncClient(const std::string &socketPath,
+                                   std::size_t maxBufferSize,
+                                   LocalTransport transport)
+    : BrokerClient(socketPath),
+      ioc_(std::make_shared<net::io_context>()),
+      endpoint_(net::local::stream_protocol::endpoint(socketPath)),
       socket_(*ioc_),
-      results_(resolver_.resolve(endpoint_)),
-      buffer_(new char[maxBufferSize]),
+      sharedMemory_(transport == LocalTransport::SharedMemory),
       bufSize_(0),
       maxBufferSize_(maxBufferSize),
+      streamed_(false),
+      requestMessage_(nullptr),
       isConnected_(false) {}
 
 BrokerSyncClient::~BrokerSyncClient() {
-    delete[] buffer_;
-    socket_.shutdown(tcp::socket::shutdown_both);
-    socket_.close();
+    if (shm_) {
+        shm_->close();
+    }
+    /// socket is not connected if connect failed
+    socket_.shutdown(stream_protocol::socket::shutdown_both, ec_);
+    socket_.close(ec_);
 }
 
 bool BrokerSyncClient::connect() {
-    net::connect(socket_, results_, ec_);
+    socket_.connect(endpoint_, ec_);
+    if (!ec_ && sharedMemory_ && !connectSharedMemory_()) {
+        ec_ = net::error::connection_refused;
+    }
     if (!ec_) {
         isConnected_ = true;
         return true;
     } else {
+        /// state of socket after failed connect is unspecified
+        boost::system::error_code ec;
+        socket_.close(ec);
         return false;
     }
 }
@@ -44,18 +73,13 @@ bool BrokerSyncClient::postMessage(const Message &message,
     } else {
         request_.type = postType;
     }
-    request_.message = message;
+    request_.message = std::nullopt;
     request_.topic = tag;
+    request_.group.clear();
+    request_.offset = std::nullopt;
 
-    serializeRequest_();
-    net::write(socket_, boost::asio::buffer(buffer_, bufSize_), ec_);
-    if (ec_) {
-        return false;
-    }
-
-    bufSize_ =
-        socket_.read_some(boost::asio::buffer(buffer_, maxBufferSize_), ec_);
-    if (ec_) {
+    serializeRequest_(&message);
+    if (!write_() || !read_()) {
         return false;
     }
     deserializeResponse_();
@@ -64,7 +88,8 @@ bool BrokerSyncClient::postMessage(const Message &message,
 }
 
 std::optional<Message> BrokerSyncClient::getMessage(const std::string &tag,
-                                                    RequestType getType) {
+                                                    RequestType getType,
+                                                    const std::string &group) {
     if (!isConnected_) {
         return std::nullopt;
     }
@@ -77,16 +102,11 @@ std::optional<Message> BrokerSyncClient::getMessage(const std::string &tag,
     }
     request_.message = std::nullopt;
     request_.topic = tag;
+    request_.group = group;
+    request_.offset = std::nullopt;
 
     serializeRequest_();
-    net::write(socket_, boost::asio::buffer(buffer_, bufSize_), ec_);
-    if (ec_) {
-        return std::nullopt;
-    }
-
-    bufSize_ =
-        socket_.read_some(boost::asio::buffer(buffer_, maxBufferSize_), ec_);
-    if (ec_) {
+    if (!write_() || !read_()) {
         return std::nullopt;
     }
     deserializeResponse_();
@@ -97,44 +117,225 @@ std::optional<Message> BrokerSyncClient::getMessage(const std::string &tag,
         request_.type = RequestType::DeliveryConfirmation;
 
         serializeRequest_();
-        net::write(socket_, boost::asio::buffer(buffer_, bufSize_), ec_);
-        if (ec_) {
+        if (!write_() || !read_(1)) {
             return std::nullopt;
         }
+        buffer_.release();
 
-        bufSize_ = net::read(socket_, boost::asio::buffer(buffer_, 1), ec_);
-        if (ec_) {
-            return std::nullopt;
-        }
-
-        return response_.message;
+        return std::move(response_.message);
     } else {  /// else send NOTHING and server will push task back to queue
         return std::nullopt;
     }
 }
 
-void BrokerSyncClient::serializeRequest_() {
-    std::stringstream oss;
-    {
-        cereal::BinaryOutputArchive oarchive(oss);
-        oarchive(request_);
-    }
-    std::string toBuf = oss.str();
-    memcpy(buffer_, toBuf.c_str(), toBuf.length());
-    bufSize_ = toBuf.length();
-
-    //    std::cout << bufSize_ << '\n';
-    //    for (int i = 0; i < bufSize_; ++i) {
-    //        std::cout << std::hex << +buffer_[i] << " ";
-    //    }
-    //    std::cout << '\n';
+std::optional<std::uint64_t> BrokerSyncClient::seek(const std::string &tag,
+                                                    const std::string &group,
+                                                    std::uint64_t offset) {
+    if (!isConnected_) {
+        return std::nullopt;
+    }
+
+    request_.type = RequestType::SeekOffset;
+    request_.message = std::nullopt;
+    request_.topic = tag;
+    request_.group = group;
+    request_.offset = offset;
+
+    serializeRequest_();
+    if (!write_() || !read_()) {
+        return std::nullopt;
+    }
+    deserializeResponse_();
+
+    if (response_.type != ResponseType::SeekSuccess) {
+        return std::nullopt;
+    }
+    return response_.offset;
+}
+
+const std::string &BrokerSyncClient::getLastMessageTopic() const {
+    return response_.topic;
+}
+
+std::optional<std::uint64_t> BrokerSyncClient::getLastMessageOffset() const {
+    return response_.offset;
+}
+
+std::optional<std::int64_t> BrokerSyncClient::getLastMessageEnqueueTime()
+    const {
+    return response_.enqueueTime;
+}
+
+bool BrokerSyncClient::connectSharedMemory_() {
+    /// server sends name of shared memory object and waits for one byte
+    /// when it is mapped
+    std::string line;
+    net::read_until(socket_, net::dynamic_buffer(line), '\n', ec_);
+    if (ec_) {
+        return false;
+    }
+    line.pop_back();
+    auto channel = std::make_unique<ShmChannel>(line);
+    if (!channel->good()) {
+        return false;
+    }
+    char ready = 1;
+    net::write(socket_, boost::asio::buffer(&ready, 1), ec_);
+    if (ec_) {
+        return false;
+    }
+    shm_ = std::move(channel);
+    return true;
+}
+
+bool BrokerSyncClient::write_() {
+    /// data of message is sent from the message itself
+    net::const_buffer data;
+    if (requestMessage_) {
+        data = net::buffer(requestMessage_->data);
+    }
+    if (!shm_) {
+        std::array<net::const_buffer, 3> buffers{
+            net::buffer(requestHead_), data, net::buffer(requestTail_)};
+        net::write(socket_, buffers, ec_);
+        return !ec_;
+    }
+    std::array<iovec, 3> parts{
+        iovec{requestHead_.data(), requestHead_.size()},
+        iovec{const_cast<void *>(data.data()), data.size()},
+        iovec{requestTail_.data(), requestTail_.size()}};
+    if (shm_->isClosed() ||
+        !shm_->getRequests().push(parts.data(), parts.size())) {
+        ec_ = net::error::broken_pipe;
+        return false;
+    }
+    return true;
+}
+
+bool BrokerSyncClient::read_(std::size_t size) {
+    streamed_ = false;
+    if (shm_) {
+        /// frames of shared memory transport are popped whole
+        auto &responses = shm_->getResponses();
+        buffer_.reserve(responses.getCapacity());
+        while (!responses.pop(buffer_.data(), buffer_.capacity(), bufSize_)) {
+            if (shm_->isClosed()) {
+                ec_ = net::error::eof;
+                return false;
+            }
+            responses.wait(std::chrono::milliseconds(100));
+        }
+        return true;
+    }
+    if (size != 0) {
+        buffer_.reserve(size);
+        bufSize_ =
+            net::read(socket_, boost::asio::buffer(buffer_.data(), size), ec_);
+        return !ec_;
+    }
+    /// small response is read with its header at once
+    buffer_.reserve(BufferPool::kMinSize);
+    bufSize_ = net::read(
+        socket_, boost::asio::buffer(buffer_.data(), buffer_.capacity()),
+        net::transfer_at_least(kFrameHeaderSize), ec_);
+    if (ec_) {
+        return false;
+    }
+    auto frameSize = kFrameHeaderSize + decodeFrameHeader(buffer_.data());
+    if (frameSize - kFrameHeaderSize > maxBufferSize_) {
+        ec_ = net::error::message_size;
+        return false;
+    }
+    if (frameSize > buffer_.capacity()) {
+        return readStreamed_(frameSize);
+    }
+    if (bufSize_ < frameSize) {
+        bufSize_ += net::read(
+            socket_,
+            boost::asio::buffer(buffer_.data() + bufSize_,
+                                frameSize - bufSize_),
+            ec_);
+    }
+    return !ec_;
+}
+
+bool BrokerSyncClient::readStreamed_(std::size_t frameSize) {
+    auto headEnd = kFrameHeaderSize + getMessageHeadSize();
+    if (bufSize_ < headEnd) {
+        bufSize_ += net::read(
+            socket_,
+            boost::asio::buffer(buffer_.data() + bufSize_, headEnd - bufSize_),
+            ec_);
+        if (ec_) {
+            return false;
+        }
+    }
+    MessageDataType dataType;
+    std::size_t dataSize = 0;
+    if (!decodeHead(buffer_.data() + kFrameHeaderSize, dataType, dataSize)) {
+        /// response without message is read whole
+        buffer_.reserve(frameSize, bufSize_);
+        bufSize_ += net::read(
+            socket_,
+            boost::asio::buffer(buffer_.data() + bufSize_,
+                                frameSize - bufSize_),
+            ec_);
+        return !ec_;
+    }
+    if (dataSize > frameSize - headEnd) {
+        ec_ = net::error::message_size;
+        return false;
+    }
+    response_.message = Message();
+    response_.message->dataType = dataType;
+    /// bytes after the head are data, then tail
+    auto copied = std::min(bufSize_ - headEnd, dataSize);
+    auto &data = response_.message->data;
+    data.assign(buffer_.data() + headEnd, copied);
+    while (data.size() < dataSize) {
+        auto received = data.size();
+        data.resize(received + std::min(dataSize - received, kStreamChunkSize));
+        net::read(socket_,
+                  boost::asio::buffer(data.data() + received,
+                                      data.size() - received),
+                  ec_);
+        if (ec_) {
+            return false;
+        }
+    }
+    /// tail is moved to the start of buffer
+    auto tailSize = frameSize - headEnd - dataSize;
+    auto buffered = bufSize_ - headEnd - copied;
+    std::memmove(buffer_.data(), buffer_.data() + headEnd + copied, buffered);
+    buffer_.reserve(tailSize, buffered);
+    net::read(socket_,
+              boost::asio::buffer(buffer_.data() + buffered,
+                                  tailSize - buffered),
+              ec_);
+    if (ec_) {
+        return false;
+    }
+    decodeTail(buffer_.data(), tailSize, response_);
+    streamed_ = true;
+    return true;
+}
+
+void BrokerSyncClient::serializeRequest_(const Message *message) {
+    requestMessage_ = message;
+    encode(request_, message, requestHead_, requestTail_);
+    auto size = requestHead_.size() + requestTail_.size();
+    if (message) {
+        size += message->data.size();
+    }
+    requestHead_.insert(0, encodeFrameHeader(size));
 }
 
 void BrokerSyncClient::deserializeResponse_() {
-    std::string buffer_str(buffer_, bufSize_);
-    std::stringstream iss(buffer_str);
-    cereal::BinaryInputArchive iarchive(iss);
-    iarchive(response_);
+    if (!streamed_) {
+        decode(buffer_.data() + kFrameHeaderSize, bufSize_ - kFrameHeaderSize,
+               response_);
+    }
+    buffer_.release();
 }
 
 }  // namespace havka
\ No newline at end of file
@@ -6,8 +6,11 @@
 #include <boost/beast/core/flat_buffer.hpp>
 #include <chrono>
 #include <iostream>
+#include <memory>
 
+#include "buffer_pool.h"
 #include "client/client_config.h"
+#include "codec.hpp"
 #include "message.hpp"
 #include "types.hpp"
 #include "util.h"
@@ -20,6 +23,21 @@ namespace net = boost::asio;
 /// from <boost/asio/ip/tcp.hpp>
 using tcp = boost::asio::ip::tcp;
 
+/// from <boost/asio/generic/stream_protocol.hpp>
+using stream_protocol = boost::asio::generic::stream_protocol;
+
+// Forward declaration. Defined in file src/shm_ring.h
+class ShmChannel;
+
+/// Transport of client to broker on the same host
+enum class LocalTransport {
+    /// requests and responses are sent through Unix domain socket
+    UnixSocket,
+    /// requests and responses are sent through rings in shared memory,
+    /// Unix domain socket (server's shm_socket_path) only sets them up
+    SharedMemory
+};
+
 /// Client interface for sending requests to the message broker server.
 /**
  * Code example for BrokerSyncClient:
@@ -48,11 +66,21 @@ public:
      * Constructs client for message broker.
      * @param serverAddress server's IP address
      * @param serverPort server's port
-     * @param maxBufferSize max size for buffer (aka max message size) in bytes
+     * @param maxBufferSize max size of response (aka max message size) in
+     * bytes
      */
     explicit BrokerClient(const net::ip::address& serverAddress,
                           unsigned short serverPort,
-                          std::size_t maxBufferSize = 65536){};
+                          std::size_t maxBufferSize = kMaxFrameSize){};
+
+    /**
+     * Constructs client for message broker on the same host.
+     * @param socketPath path of server's Unix domain socket
+     * @param maxBufferSize max size of response (aka max message size) in
+     * bytes
+     */
+    explicit BrokerClient(const std::string& socketPath,
+                          std::size_t maxBufferSize = kMaxFrameSize){};
 
     /**
      * Establishes connection between client and server.
@@ -75,12 +103,27 @@ public:
     /**
      * Sends the request to the message broker to get message with exact tag.
      * On success, server will delete the message
+     * (for log topics, server advances offset of consumer group)
      * @param tag Message topic
      * @param getType Type of getMessage request
+     * @param group Consumer group, used for log topics
      * @return returns message on success, std::nullopt on failure
      */
-    virtual std::optional<Message> getMessage(const std::string& tag,
-                                              RequestType getType) = 0;
+    virtual std::optional<Message> getMessage(
+        const std::string& tag, RequestType getType,
+        const std::string& group = "") = 0;
+
+    /**
+     * Sets offset of consumer group in log topic to replay or skip messages.
+     * @param tag Log topic
+     * @param group Consumer group
+     * @param offset New offset of consumer group
+     * @return returns offset which was set (it is clamped to offsets of
+     * retained messages) on success, std::nullopt on failure
+     */
+    virtual std::optional<std::uint64_t> seek(const std::string& tag,
+                                              const std::string& group,
+                                              std::uint64_t offset) = 0;
 };
 
 /// Implementation of interface for message broker client.
@@ -110,15 +153,31 @@ public:
      * Constructs client for message broker.
      * @param serverAddress server's IP address
      * @param serverPort server's port
-     * @param maxBufferSize max size for buffer
-     * (aka approximately max message size) in bytes
+     * @param maxBufferSize max size of response
+     * (aka approximately max message size) in bytes, buffer grows up to
+     * it only for large responses
      */
     explicit BrokerSyncClient(const net::ip::address& serverAddress,
                               unsigned short serverPort,
-                              std::size_t maxBufferSize = 65536);
+                              std::size_t maxBufferSize = kMaxFrameSize);
 
     /**
-     * Destructor for client. Frees buffer.
+     * Constructs client which connects to Unix domain socket of broker
+     * on the same host, requests are the same as over TCP.
+     * @param socketPath path of server's Unix domain socket
+     * @param maxBufferSize max size of response
+     * (aka approximately max message size) in bytes, buffer grows up to
+     * it only for large responses
+     * @param transport UnixSocket for unix_socket_path of server,
+     * SharedMemory for shm_socket_path
+     */
+    explicit BrokerSyncClient(
+        const std::string& socketPath,
+        std::size_t maxBufferSize = kMaxFrameSize,
+        LocalTransport transport = LocalTransport::UnixSocket);
+
+    /**
+     * Destructor for client. Closes connection.
      */
     ~BrokerSyncClient();
 
@@ -145,31 +204,118 @@ public:
      * Sends the request to the message broker to get message with exact tag.
      * On success, server will delete the message.
      * Blocking.
-     * @param tag Message topic
+     * @param tag Message topic or wildcard pattern ('*' matches one
+     * '.'-separated segment, '#' matches zero or more segments)
      * @param getType Type of getMessage request
+     * @param group Consumer group, used for log topics
      * @return returns message on success, std::nullopt on failure
      */
     std::optional<Message> getMessage(const std::string& tag,
-                                      RequestType getType) override;
+                                      RequestType getType,
+                                      const std::string& group = "") override;
+
+    /**
+     * Sets offset of consumer group in log topic to replay or skip messages.
+     * Blocking.
+     * @param tag Log topic
+     * @param group Consumer group
+     * @param offset New offset of consumer group
+     * @return returns offset which was set (it is clamped to offsets of
+     * retained messages) on success, std::nullopt on failure
+     */
+    std::optional<std::uint64_t> seek(const std::string& tag,
+                                      const std::string& group,
+                                      std::uint64_t offset) override;
+
+    /**
+     * Returns topic of the last message got with getMessage. Useful when
+     * message was requested with a wildcard pattern.
+     * @return topic of the last received message
+     */
+    const std::string& getLastMessageTopic() const;
+
+    /**
+     * Returns offset of the last message got with getMessage if it was
+     * read from a log topic.
+     * @return offset of the last received message or std::nullopt
+     */
+    std::optional<std::uint64_t> getLastMessageOffset() const;
+
+    /**
+     * Returns time when broker enqueued the last message got with getMessage,
+     * microseconds since Unix epoch. Returned only if server is configured
+     * with return_enqueue_time.
+     * @return enqueue time of the last received message or std::nullopt
+     */
+    std::optional<std::int64_t> getLastMessageEnqueueTime() const;
 
 private:
     std::shared_ptr<net::io_context> ioc_;
 
-    tcp::endpoint endpoint_;
-    tcp::resolver resolver_;
-    tcp::socket socket_;
-    const boost::asio::ip::basic_resolver_results<tcp> results_;
+    /// TCP or Unix domain endpoint of server
+    stream_protocol::endpoint endpoint_;
+    stream_protocol::socket socket_;
     boost::system::error_code ec_;
+    /// socket only sets up shared memory transport
+    bool sharedMemory_;
+    /// rings of shared memory transport (nullptr for sockets)
+    std::unique_ptr<ShmChannel> shm_;
 
-    char* buffer_;
+    /// frame of request_ around data of its message, head starts with
+    /// frame header
+    std::string requestHead_;
+    std::string requestTail_;
+    /// received response frame, taken from pool only while it is read
+    PooledBuffer buffer_;
     std::size_t bufSize_;
     std::size_t maxBufferSize_;
+    /// response_ was decoded while it was read
+    bool streamed_;
     Request request_;
     Response response_;
 
+    /// message of request_, not copied into the request
+    const Message* requestMessage_;
+
     bool isConnected_;
 
-    void serializeRequest_();
+    /**
+     * Establishes shared memory transport over connected socket
+     * @return true on success
+     */
+    bool connectSharedMemory_();
+
+    /**
+     * Sends frame of serialized request
+     * @return true on success
+     */
+    bool write_();
+
+    /**
+     * Receives response to buffer_, sets bufSize_. Data of message of
+     * response which does not fit into the first buffer is read straight
+     * into response_.message.
+     * @param size exact size of raw response, 0 to read response frame
+     * @return true on success, false also if frame is larger than
+     * maxBufferSize_
+     */
+    bool read_(std::size_t size = 0);
+
+    /**
+     * Reads the rest of response frame whose head is in buffer_, data of
+     * message is read straight into response_.message
+     * @param frameSize size of frame with header
+     * @return true on success
+     */
+    bool readStreamed_(std::size_t frameSize);
+
+    /**
+     * Serializes request_ with given message into requestHead_ and
+     * requestTail_
+     * @param message message of request, valid until it is written
+     * (nullptr if request has no message)
+     */
+    void serializeRequest_(const Message* message = nullptr);
 
     void deserializeResponse_();
 };
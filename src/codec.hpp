@@ -0,0 +1,215 @@
+#ifndef HAVKA_SRC_CODEC_HPP_
+#define HAVKA_SRC_CODEC_HPP_
+
+#include <cereal/archives/binary.hpp>
+#include <cstdint>
+#include <optional>
+#include <sstream>
+#include <string>
+
+#include "message.hpp"
+
+namespace havka {
+
+/**
+ * Serializes request or response into binary wire format.
+ * Used by server, client and benchmarks, so all of them share one codec.
+ * @tparam T type with cereal serialize function
+ * @param value value to serialize
+ * @return serialized bytes
+ */
+template <typename T>
+std::string encode(const T& value) {
+    std::stringstream oss;
+    {
+        cereal::BinaryOutputArchive oarchive(oss);
+        oarchive(value);
+    }
+    return oss.str();
+}
+
+/**
+ * Deserializes request or response from binary wire format
+ * @tparam T type with cereal serialize function
+ * @param data serialized bytes
+ * @param size number of bytes
+ * @param value deserialized value
+ */
+template <typename T>
+void decode(const char* data, std::size_t size, T& value) {
+    std::stringstream iss(std::string(data, size));
+    cereal::BinaryInputArchive iarchive(iss);
+    iarchive(value);
+}
+
+/// Size of header of every frame: size of frame body, u32 little-endian.
+/// Requests and responses are sent as frames, so the reading side knows
+/// how many bytes to wait for and how large buffer it needs.
+constexpr std::size_t kFrameHeaderSize = 4;
+
+/// Default limit of frame body size, larger frames close connection
+constexpr std::size_t kMaxFrameSize = 64 << 20;
+
+/// Streamed message data grows by at most this many bytes per read, so
+/// memory follows received bytes and not the size declared by the peer
+constexpr std::size_t kStreamChunkSize = 256 << 10;
+
+/**
+ * Encodes header of frame
+ * @param size size of frame body
+ * @return kFrameHeaderSize bytes
+ */
+inline std::string encodeFrameHeader(std::size_t size) {
+    std::string header(kFrameHeaderSize, '\0');
+    for (std::size_t i = 0; i < kFrameHeaderSize; ++i) {
+        header[i] = static_cast<char>((size >> (8 * i)) & 0xff);
+    }
+    return header;
+}
+
+/**
+ * Decodes header of frame
+ * @param data kFrameHeaderSize bytes
+ * @return size of frame body
+ */
+inline std::size_t decodeFrameHeader(const char* data) {
+    std::size_t size = 0;
+    for (std::size_t i = 0; i < kFrameHeaderSize; ++i) {
+        size |= static_cast<std::size_t>(static_cast<unsigned char>(data[i]))
+                << (8 * i);
+    }
+    return size;
+}
+
+/**
+ * Serializes request or response into frame: header and serialized bytes
+ * @tparam T type with cereal serialize function
+ * @param value value to serialize
+ * @return frame bytes
+ */
+template <typename T>
+std::string encodeFrame(const T& value) {
+    auto body = encode(value);
+    return encodeFrameHeader(body.size()) + body;
+}
+
+namespace detail {
+
+/// Encoded like Message, but without bytes of data
+struct MessageHeader {
+    MessageDataType dataType;
+    /// binary archives write size tag of string data as size_type
+    cereal::size_type size;
+
+    template <class Archive>
+    void serialize(Archive& ar) {
+        ar(dataType, size);
+    }
+};
+
+/// Fields of request after its message. Must follow Request::serialize.
+template <class Archive, class T>
+void serializeTail(Archive& ar, T& request, const Request* /* tag */) {
+    ar(request.topic, request.type, request.group, request.offset);
+}
+
+/// Fields of response after its message. Must follow Response::serialize.
+template <class Archive, class T>
+void serializeTail(Archive& ar, T& response, const Response* /* tag */) {
+    ar(response.type, response.topic, response.offset, response.enqueueTime);
+}
+
+}  // namespace detail
+
+/**
+ * Serializes request or response with given message around data of the
+ * message, so the data can be sent from the message itself without
+ * copying: head, message data and tail together are equal to encode of
+ * value with this message.
+ * @tparam T Request or Response
+ * @param value value to serialize, its own message is ignored
+ * @param message message of value (nullptr if there is no message)
+ * @param head serialized bytes before message data
+ * @param tail serialized bytes after message data
+ */
+template <typename T>
+void encode(const T& value, const Message* message, std::string& head,
+            std::string& tail) {
+    /// one stream for both parts, it is split after encoding
+    std::stringstream oss;
+    std::size_t headSize = 0;
+    {
+        std::optional<detail::MessageHeader> header;
+        if (message) {
+            header = detail::MessageHeader{message->dataType,
+                                           message->data.size()};
+        }
+        cereal::BinaryOutputArchive oarchive(oss);
+        oarchive(header);
+        headSize = oss.tellp();
+        detail::serializeTail(oarchive, value, &value);
+    }
+    auto bytes = oss.str();
+    head.assign(bytes, 0, headSize);
+    tail.assign(bytes, headSize, std::string::npos);
+}
+
+/**
+ * Serializes request or response around data of its message, head,
+ * message data and tail together are equal to encode(value)
+ * @tparam T Request or Response
+ * @param value value to serialize
+ * @param head serialized bytes before message data
+ * @param tail serialized bytes after message data
+ */
+template <typename T>
+void encode(const T& value, std::string& head, std::string& tail) {
+    encode(value, value.message ? &*value.message : nullptr, head, tail);
+}
+
+/**
+ * Returns size of head of request or response which has a message
+ * @return size in bytes
+ */
+inline std::size_t getMessageHeadSize() {
+    static const std::size_t size = encode(
+        std::optional<detail::MessageHeader>(detail::MessageHeader{})).size();
+    return size;
+}
+
+/**
+ * Deserializes head of request or response
+ * @param data at least getMessageHeadSize() bytes of head
+ * @param dataType type of data of message
+ * @param size size of data of message
+ * @return false if value has no message
+ */
+inline bool decodeHead(const char* data, MessageDataType& dataType,
+                       std::size_t& size) {
+    std::optional<detail::MessageHeader> header;
+    decode(data, getMessageHeadSize(), header);
+    if (!header) {
+        return false;
+    }
+    dataType = header->dataType;
+    size = header->size;
+    return true;
+}
+
+/**
+ * Deserializes fields of request or response after data of its message
+ * @tparam T Request or Response
+ * @param data serialized bytes of tail
+ * @param size number of bytes
+ * @param value value whose fields are set, message is not changed
+ */
+template <typename T>
+void decodeTail(const char* data, std::size_t size, T& value) {
+    std::stringstream iss(std::string(data, size));
+    cereal::BinaryInputArchive iarchive(iss);
+    detail::serializeTail(iarchive, value, &value);
+}
+
+}  // namespace havka
+
+#endif  // HAVKA_SRC_CODEC_HPP_
@@ -0,0 +1,109 @@
+#include "histogram.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace havka {
+
+namespace {
+constexpr std::uint64_t kHalfSubBuckets = Histogram::kSubBuckets / 2;
+constexpr int kHalfSubBucketsBits = 6;
+static_assert(std::uint64_t{1} << kHalfSubBucketsBits == kHalfSubBuckets);
+/// Last bucket holds values with the most significant bit 63
+constexpr std::size_t kBucketsNumber =
+    (64 - kHalfSubBucketsBits + 1) * kHalfSubBuckets;
+}  // namespace
+
+Histogram::Histogram() : counts_(kBucketsNumber, 0) { reset(); }
+
+void Histogram::record(std::uint64_t value) {
+    ++counts_[getBucket(value)];
+    ++count_;
+    min_ = std::min(min_, value);
+    max_ = std::max(max_, value);
+    sum_ += value;
+}
+
+void Histogram::merge(const Histogram& other) {
+    for (std::size_t i = 0; i < counts_.size(); ++i) {
+        counts_[i] += other.counts_[i];
+    }
+    count_ += other.count_;
+    min_ = std::min(min_, other.min_);
+    max_ = std::max(max_, other.max_);
+    sum_ += other.sum_;
+}
+
+void Histogram::addBucket(std::size_t bucket, std::uint64_t count) {
+    if (count == 0) {
+        return;
+    }
+    std::uint64_t value = getBucketLimit(bucket);
+    counts_[bucket] += count;
+    count_ += count;
+    min_ = std::min(min_, value);
+    max_ = std::max(max_, value);
+    sum_ += static_cast<long double>(value) * count;
+}
+
+void Histogram::reset() {
+    std::fill(counts_.begin(), counts_.end(), 0);
+    count_ = 0;
+    min_ = std::numeric_limits<std::uint64_t>::max();
+    max_ = 0;
+    sum_ = 0;
+}
+
+std::uint64_t Histogram::getCount() const { return count_; }
+
+std::uint64_t Histogram::getMin() const { return count_ == 0 ? 0 : min_; }
+
+std::uint64_t Histogram::getMax() const { return max_; }
+
+double Histogram::getMean() const {
+    return count_ == 0 ? 0 : static_cast<double>(sum_ / count_);
+}
+
+std::uint64_t Histogram::getPercentile(double percentile) const {
+    if (count_ == 0) {
+        return 0;
+    }
+    percentile = std::clamp(percentile, 0.0, 100.0);
+    auto rank = static_cast<std::uint64_t>(percentile / 100 * count_ + 0.5);
+    rank = std::clamp<std::uint64_t>(rank, 1, count_);
+
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < counts_.size(); ++i) {
+        seen += counts_[i];
+        if (seen >= rank) {
+            return std::min(getBucketLimit(i), max_);
+        }
+    }
+    return max_;
+}
+
+std::uint64_t Histogram::getBucketCount(std::size_t bucket) const {
+    return counts_[bucket];
+}
+
+std::size_t Histogram::getBucket(std::uint64_t value) {
+    if (value < kSubBuckets) {
+        return value;
+    }
+    /// value >> shift is in [kHalfSubBuckets, kSubBuckets)
+    int shift = 63 - __builtin_clzll(value) - kHalfSubBucketsBits;
+    return shift * kHalfSubBuckets + (value >> shift);
+}
+
+std::uint64_t Histogram::getBucketLimit(std::size_t bucket) {
+    if (bucket < kSubBuckets) {
+        return bucket;
+    }
+    std::size_t shift = bucket / kHalfSubBuckets - 1;
+    std::uint64_t mantissa = bucket - shift * kHalfSubBuckets;
+    return (mantissa << shift) + ((std::uint64_t{1} << shift) - 1);
+}
+
+std::size_t Histogram::getBucketsNumber() { return kBucketsNumber; }
+
+}  // namespace havka
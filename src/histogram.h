@@ -0,0 +1,120 @@
+#ifndef HAVKA_SRC_HISTOGRAM_H_
+#define HAVKA_SRC_HISTOGRAM_H_
+
+#include <cstdint>
+#include <vector>
+
+namespace havka {
+
+/// Log-linear histogram of non-negative integer values (HDR-style).
+/**
+ * Every power of two range is split into kSubBuckets / 2 linear buckets,
+ * so relative error of recorded values is below 2 / kSubBuckets (~1.6%)
+ * over the whole 64-bit range, and memory does not depend on number of
+ * samples. Values below kSubBuckets are recorded exactly.
+ * Not thread-safe: every thread records to its own histogram,
+ * then histograms are merged.
+ */
+class Histogram {
+public:
+    /// Number of linear buckets below the first power of two range
+    static constexpr std::uint64_t kSubBuckets = 128;
+
+    Histogram();
+
+    /**
+     * Records one value
+     * @param value value, for example latency in nanoseconds
+     */
+    void record(std::uint64_t value);
+
+    /**
+     * Adds all values recorded in other histogram
+     * @param other histogram to add
+     */
+    void merge(const Histogram& other);
+
+    /**
+     * Adds values counted in bucket of other histogram storage (for example
+     * sharded atomic counters). Values are taken as the highest value
+     * equivalent to the bucket.
+     * @param bucket index of bucket
+     * @param count number of values
+     */
+    void addBucket(std::size_t bucket, std::uint64_t count);
+
+    /**
+     * Removes all recorded values
+     */
+    void reset();
+
+    /**
+     * Returns number of recorded values
+     * @return number of values
+     */
+    std::uint64_t getCount() const;
+
+    /**
+     * Returns minimal recorded value (0 if histogram is empty)
+     * @return minimal value
+     */
+    std::uint64_t getMin() const;
+
+    /**
+     * Returns maximal recorded value (0 if histogram is empty)
+     * @return maximal value
+     */
+    std::uint64_t getMax() const;
+
+    /**
+     * Returns mean of recorded values (0 if histogram is empty)
+     * @return mean value
+     */
+    double getMean() const;
+
+    /**
+     * Returns value at given percentile. Result is the highest value
+     * equivalent to the bucket of percentile, but not more than maximum.
+     * @param percentile percentile in range [0, 100]
+     * @return value at percentile
+     */
+    std::uint64_t getPercentile(double percentile) const;
+
+    /**
+     * Returns number of values in bucket
+     * @param bucket index of bucket
+     * @return number of values
+     */
+    std::uint64_t getBucketCount(std::size_t bucket) const;
+
+    /**
+     * Returns index of bucket where value is counted
+     * @param value value
+     * @return index of bucket
+     */
+    static std::size_t getBucket(std::uint64_t value);
+
+    /**
+     * Returns the highest value equivalent to bucket
+     * @param bucket index of bucket
+     * @return upper limit of bucket
+     */
+    static std::uint64_t getBucketLimit(std::size_t bucket);
+
+    /**
+     * Returns number of buckets in every histogram
+     * @return number of buckets
+     */
+    static std::size_t getBucketsNumber();
+
+private:
+    std::vector<std::uint64_t> counts_;
+    std::uint64_t count_;
+    std::uint64_t min_;
+    std::uint64_t max_;
+    long double sum_;
+};
+
+}  // namespace havka
+
+#endif  // HAVKA_SRC_HISTOGRAM_H_
@@ -0,0 +1,279 @@
+#include "log.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace havka::log {
+
+namespace {
+
+std::atomic<Level> minLevel{Level::Info};
+std::atomic<std::uint32_t> rateLimit{0};
+
+/// Capacity of ring of one thread in bytes, power of two
+constexpr std::size_t kRingCapacity = 1 << 16;
+/// Interval of draining when writers do not wake drainer up
+constexpr auto kDrainInterval = std::chrono::milliseconds(10);
+
+/// Single-producer single-consumer ring of length-prefixed lines
+class Ring {
+public:
+    /**
+     * Puts line into ring, called only by owner thread
+     * @return false if there is no space for line
+     */
+    bool push(const std::string& line) {
+        auto length = static_cast<std::uint32_t>(line.size());
+        std::size_t head = head_.load(std::memory_order_relaxed);
+        std::size_t tail = tail_.load(std::memory_order_acquire);
+        if (kRingCapacity - (head - tail) < sizeof(length) + length) {
+            return false;
+        }
+        copyIn_(head, &length, sizeof(length));
+        copyIn_(head + sizeof(length), line.data(), length);
+        head_.store(head + sizeof(length) + length, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Appends all lines of ring to output, called only by drainer
+     */
+    void drain(std::string& output) {
+        std::size_t tail = tail_.load(std::memory_order_relaxed);
+        std::size_t head = head_.load(std::memory_order_acquire);
+        while (tail != head) {
+            std::uint32_t length;
+            copyOut_(tail, &length, sizeof(length));
+            std::size_t begin = output.size();
+            output.resize(begin + length);
+            copyOut_(tail + sizeof(length), output.data() + begin, length);
+            tail += sizeof(length) + length;
+        }
+        tail_.store(tail, std::memory_order_release);
+    }
+
+    /**
+     * Returns number of used bytes
+     */
+    std::size_t size() const {
+        return head_.load(std::memory_order_relaxed) -
+               tail_.load(std::memory_order_relaxed);
+    }
+
+private:
+    char data_[kRingCapacity];
+    /// head_ and tail_ grow infinitely, position is taken modulo capacity
+    alignas(64) std::atomic<std::size_t> head_{0};
+    alignas(64) std::atomic<std::size_t> tail_{0};
+
+    void copyIn_(std::size_t position, const void* source, std::size_t size) {
+        std::size_t offset = position % kRingCapacity;
+        std::size_t first = std::min(size, kRingCapacity - offset);
+        std::memcpy(data_ + offset, source, first);
+        std::memcpy(data_, static_cast<const char*>(source) + first,
+                    size - first);
+    }
+
+    void copyOut_(std::size_t position, void* target, std::size_t size) const {
+        std::size_t offset = position % kRingCapacity;
+        std::size_t first = std::min(size, kRingCapacity - offset);
+        std::memcpy(target, data_ + offset, first);
+        std::memcpy(static_cast<char*>(target) + first, data_, size - first);
+    }
+};
+
+/// Background thread draining rings of all threads
+/**
+ * Backend is never destroyed, its thread is detached, and remaining lines
+ * are drained at exit. Drains use timed locks, so they do not hang in a
+ * forked process (death tests) where the drainer thread does not exist.
+ */
+class Backend {
+public:
+    Backend() {
+        std::thread([this] { run_(); }).detach();
+        std::atexit([] { getBackend().drain(); });
+    }
+
+    std::shared_ptr<Ring> createRing() {
+        auto ring = std::make_shared<Ring>();
+        std::lock_guard<std::timed_mutex> lock(ringsMutex_);
+        rings_.push_back(ring);
+        return ring;
+    }
+
+    void wakeUp() { condition_.notify_one(); }
+
+    void countDropped() { dropped_.fetch_add(1, std::memory_order_relaxed); }
+
+    /**
+     * Drains all rings to stderr
+     */
+    void drain() {
+        std::unique_lock<std::timed_mutex> drainLock(drainMutex_,
+                                                     kLockTimeout);
+        if (!drainLock) {
+            return;
+        }
+        std::vector<std::shared_ptr<Ring>> rings;
+        {
+            std::unique_lock<std::timed_mutex> lock(ringsMutex_,
+                                                    kLockTimeout);
+            if (!lock) {
+                return;
+            }
+            rings = rings_;
+            /// ring of finished thread is referenced only by rings_ and
+            /// the copy, it is removed when it is empty
+            rings_.erase(std::remove_if(rings_.begin(), rings_.end(),
+                                        [](const auto& ring) {
+                                            return ring.use_count() == 2 &&
+                                                   ring->size() == 0;
+                                        }),
+                         rings_.end());
+        }
+
+        output_.clear();
+        for (const auto& ring : rings) {
+            ring->drain(output_);
+        }
+        if (auto dropped = dropped_.exchange(0, std::memory_order_relaxed)) {
+            output_ += "[WARNING] " + std::to_string(dropped) +
+                       " log lines were dropped, log rings were full\n";
+        }
+        if (!output_.empty()) {
+            std::fwrite(output_.data(), 1, output_.size(), stderr);
+            std::fflush(stderr);
+        }
+    }
+
+    static Backend& getBackend();
+
+private:
+    static constexpr auto kLockTimeout = std::chrono::milliseconds(100);
+
+    std::timed_mutex ringsMutex_;
+    std::vector<std::shared_ptr<Ring>> rings_;
+    std::atomic<std::uint64_t> dropped_{0};
+    std::timed_mutex drainMutex_;
+    std::string output_;
+    std::mutex wakeMutex_;
+    std::condition_variable condition_;
+
+    [[noreturn]] void run_() {
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(wakeMutex_);
+                condition_.wait_for(lock, kDrainInterval);
+            }
+            drain();
+        }
+    }
+};
+
+Backend& Backend::getBackend() {
+    static auto* backend = new Backend;
+    return *backend;
+}
+
+Backend& getBackend() { return Backend::getBackend(); }
+
+/// Stream buffer appending to string, keeps capacity between lines
+class LineBuffer : public std::streambuf {
+public:
+    std::string line;
+
+protected:
+    int_type overflow(int_type c) override {
+        if (c != traits_type::eof()) {
+            line.push_back(static_cast<char>(c));
+        }
+        return c;
+    }
+
+    std::streamsize xsputn(const char* s, std::streamsize n) override {
+        line.append(s, n);
+        return n;
+    }
+};
+
+/// Line buffer, stream and ring of one thread
+struct ThreadLog {
+    LineBuffer buffer;
+    std::ostream stream{&buffer};
+    std::shared_ptr<Ring> ring{getBackend().createRing()};
+};
+
+ThreadLog& getThreadLog() {
+    thread_local ThreadLog threadLog;
+    return threadLog;
+}
+
+}  // namespace
+
+void setLevel(Level level) { minLevel = level; }
+
+void setRateLimit(std::uint32_t linesPerSecond) { rateLimit = linesPerSecond; }
+
+bool isEnabled(Level level) {
+    return level >= minLevel.load(std::memory_order_relaxed);
+}
+
+std::ostream& getStream() {
+    auto& threadLog = getThreadLog();
+    threadLog.buffer.line.clear();
+    return threadLog.stream;
+}
+
+void commit(std::uint64_t suppressed) {
+    auto& threadLog = getThreadLog();
+    auto& line = threadLog.buffer.line;
+    if (suppressed > 0) {
+        line += " (" + std::to_string(suppressed) +
+                " similar lines were suppressed)";
+    }
+    line += '\n';
+
+    auto& backend = getBackend();
+    if (!threadLog.ring->push(line)) {
+        backend.countDropped();
+        backend.wakeUp();
+    } else if (threadLog.ring->size() > kRingCapacity / 2) {
+        backend.wakeUp();
+    }
+}
+
+void flush() { getBackend().drain(); }
+
+bool RateLimiter::allow(std::uint64_t& suppressed) {
+    std::uint32_t limit = rateLimit.load(std::memory_order_relaxed);
+    if (limit == 0) {
+        return true;
+    }
+    auto second = static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::steady_clock::now().time_since_epoch())
+            .count());
+    if (second_.load(std::memory_order_relaxed) != second) {
+        second_.store(second, std::memory_order_relaxed);
+        lines_.store(0, std::memory_order_relaxed);
+    }
+    if (lines_.fetch_add(1, std::memory_order_relaxed) >= limit) {
+        suppressed_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    suppressed = suppressed_.exchange(0, std::memory_order_relaxed);
+    return true;
+}
+
+}  // namespace havka::log
@@ -0,0 +1,91 @@
+#ifndef HAVKA_SRC_LOG_H_
+#define HAVKA_SRC_LOG_H_
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+
+/// Namespace with asynchronous logging backend used by LOG_* macros
+/**
+ * Every thread formats log lines into its own buffer and puts them into its
+ * own lock-free single-producer ring, a background thread drains rings to
+ * stderr. Logging never blocks: if a ring is full, the line is dropped and
+ * counted. Lines of different threads are not strictly ordered.
+ */
+namespace havka::log {
+
+/// Severity of log line
+enum class Level { Info, Warning, Error };
+
+/**
+ * Sets minimal level of written lines
+ * @param level minimal level
+ */
+void setLevel(Level level);
+
+/**
+ * Sets maximal number of lines per second from one LOG_* call site,
+ * other lines are suppressed and counted
+ * @param linesPerSecond limit, 0 means no limit
+ */
+void setRateLimit(std::uint32_t linesPerSecond);
+
+/**
+ * Checks if lines of given level are written
+ * @param level level of line
+ * @return true if level is enabled
+ */
+bool isEnabled(Level level);
+
+/**
+ * Returns stream of the current thread for the next line.
+ * Stream is empty, its buffer is reused between lines.
+ * @return stream of line
+ */
+std::ostream& getStream();
+
+/**
+ * Puts line formatted in getStream() into ring of the current thread
+ * @param suppressed number of lines suppressed by rate limit before it
+ */
+void commit(std::uint64_t suppressed);
+
+/**
+ * Writes lines which are already in rings to stderr in the calling thread.
+ * Waits for locks only for a short time, so it is safe to call in a forked
+ * process where the drainer thread does not exist.
+ */
+void flush();
+
+/// Rate limiter of one LOG_* call site
+class RateLimiter {
+public:
+    /**
+     * Checks if one more line is allowed in the current second
+     * @param suppressed number of lines suppressed since the last allowed one
+     * @return true if line should be written
+     */
+    bool allow(std::uint64_t& suppressed);
+
+private:
+    std::atomic<std::uint64_t> second_{0};
+    std::atomic<std::uint32_t> lines_{0};
+    std::atomic<std::uint64_t> suppressed_{0};
+};
+
+}  // namespace havka::log
+
+/// Writes line asynchronously if level is enabled and rate limit allows it
+#define HAVKA_LOG(level, prefix, msg)                                 \
+    do {                                                              \
+        if (::havka::log::isEnabled(level)) {                         \
+            static ::havka::log::RateLimiter havkaLogLimiter_;        \
+            std::uint64_t havkaLogSuppressed_ = 0;                    \
+            if (havkaLogLimiter_.allow(havkaLogSuppressed_)) {        \
+                ::havka::log::getStream() << prefix << msg;           \
+                ::havka::log::commit(havkaLogSuppressed_);            \
+            }                                                         \
+        }                                                             \
+    } while (0)
+
+#endif  // HAVKA_SRC_LOG_H_
@@ -6,6 +6,7 @@
 #include <cereal/types/string.hpp>
 #include <cereal/types/vector.hpp>
 #include <chrono>
+#include <cstdint>
 #include <optional>
 #include <string>
 
@@ -23,6 +24,15 @@ struct Message {
     /// Data of message. Can be readable or not.
     std::string data{0};
 
+    /// Time when broker enqueued message, nanoseconds of steady clock
+    /// (0 if message was not enqueued). Not serialized.
+    std::uint64_t enqueuedAt{0};
+
+    /// Wall clock time when broker enqueued message, microseconds since
+    /// Unix epoch (0 if message was not enqueued). Not serialized,
+    /// consumers get it in Response::enqueueTime if server is configured so.
+    std::int64_t enqueueTime{0};
+
     /**
      * Function to set data  to the message from char*
      * @param data_ data
@@ -72,6 +82,16 @@ struct Message {
     }
 };
 
+/// Information about message delivered from storage
+struct DeliveryInfo {
+    /// Topic of message. Differs from requested one if request was made
+    /// with a wildcard pattern.
+    std::string topic;
+
+    /// Offset of message if it was read from a log topic (TopicMode::Log)
+    std::optional<std::uint64_t> offset;
+};
+
 /// Enum for request type
 enum RequestType {
     /// Awaiting the confirmation from broker that
@@ -86,7 +106,10 @@ enum RequestType {
 
     /// Being sent to server after
     /// every response with Message
-    DeliveryConfirmation
+    DeliveryConfirmation,
+
+    /// Sets offset of consumer group in log topic (TopicMode::Log)
+    SeekOffset
 };
 
 /**
@@ -104,6 +127,8 @@ inline std::string getStringFromRequestType(RequestType requestType) {
             return "RequestType::GetMessageNonblocking";
         case DeliveryConfirmation:
             return "RequestType::DeliveryConfirmation";
+        case SeekOffset:
+            return "RequestType::SeekOffset";
         default:
             return "Unknown type";
     }
@@ -127,7 +152,10 @@ enum ResponseType {
     EmptyTopic,
 
     /// Unknown error
-    Error
+    Error,
+
+    /// Seek request was successfully processed
+    SeekSuccess
 };
 
 /// Structure of client request
@@ -140,12 +168,21 @@ struct Request {
     /// optional.
     std::optional<Message> message;
 
-    /// Topic. Not empty for PostMessage* and GetMessage* requests
+    /// Topic. Not empty for PostMessage* and GetMessage* requests.
+    /// GetMessage* requests can use wildcard patterns: segments are separated
+    /// by '.', '*' matches one segment and '#' matches zero or more segments.
     std::string topic;
 
     /// Request type corresponding to messaging protocol.
     RequestType type;
 
+    /// Consumer group. Used by GetMessage* and SeekOffset requests
+    /// to log topics (TopicMode::Log).
+    std::string group;
+
+    /// Offset in log topic. Not empty for SeekOffset requests.
+    std::optional<std::uint64_t> offset;
+
     /**
      * Technical function to use cereal library for packing Message into archive
      * @tparam Archive archive type
@@ -153,7 +190,7 @@ struct Request {
      */
     template <class Archive>
     void serialize(Archive& ar) {
-        ar(message, topic, type);
+        ar(message, topic, type, group, offset);
     }
 };
 
@@ -170,6 +207,19 @@ struct Response {
     /// Response main message corresponding to messaging protocol.
     ResponseType type{ResponseType::Error};
 
+    /// Topic of the message in response. Differs from requested topic if
+    /// request was made with a wildcard pattern.
+    std::string topic;
+
+    /// Offset of the message in response (or offset set by SeekOffset
+    /// request) if topic is a log topic (TopicMode::Log).
+    std::optional<std::uint64_t> offset;
+
+    /// Wall clock time when broker enqueued the message in response,
+    /// microseconds since Unix epoch. Set only if server returns enqueue
+    /// times.
+    std::optional<std::int64_t> enqueueTime;
+
     /**
      * Technical function to use cereal library for packing Message into archive
      * @tparam Archive archive type
@@ -177,7 +227,7 @@ struct Response {
      */
     template <class Archive>
     void serialize(Archive& ar) {
-        ar(message, type);
+        ar(message, type, topic, offset, enqueueTime);
     }
 };
 
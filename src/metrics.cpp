@@ -0,0 +1,189 @@
+#include "metrics.h"
+
+#include <algorithm>
+
+#include "util.h"
+
+namespace havka::metrics {
+
+std::size_t getShardIndex() {
+    static std::atomic<std::size_t> nextIndex{0};
+    thread_local std::size_t index = nextIndex++ % kShards;
+    return index;
+}
+
+std::uint64_t Counter::get() const {
+    std::uint64_t sum = 0;
+    for (const auto& shard : shards_) {
+        sum += shard.value.load(std::memory_order_relaxed);
+    }
+    return sum;
+}
+
+std::int64_t Gauge::get() const {
+    std::int64_t sum = 0;
+    for (const auto& shard : shards_) {
+        sum += shard.value.load(std::memory_order_relaxed);
+    }
+    return sum;
+}
+
+LatencyHistogram::~LatencyHistogram() {
+    for (auto& shard : shards_) {
+        delete[] shard.buckets.load();
+    }
+}
+
+void LatencyHistogram::record(std::uint64_t value) {
+    auto& shard = shards_[getShardIndex()];
+    auto* buckets = shard.buckets.load(std::memory_order_acquire);
+    if (!buckets) {
+        buckets = allocate_(shard);
+    }
+    buckets[Histogram::getBucket(value)].fetch_add(1,
+                                                   std::memory_order_relaxed);
+}
+
+void BucketHistogram::record(std::uint64_t value) {
+    auto bound = std::lower_bound(kBucketBoundsNs.begin(),
+                                  kBucketBoundsNs.end(), value);
+    ++counts[bound - kBucketBoundsNs.begin()];
+    sum += value;
+}
+
+std::uint64_t BucketHistogram::getCount() const {
+    std::uint64_t count = 0;
+    for (auto bucketCount : counts) {
+        count += bucketCount;
+    }
+    return count;
+}
+
+BucketHistogram BucketHistogram::fromHistogram(const Histogram& histogram) {
+    BucketHistogram result;
+    std::size_t bucket = 0;
+    for (std::size_t i = 0; i < kBucketBoundsNs.size(); ++i) {
+        while (bucket < Histogram::getBucketsNumber() &&
+               Histogram::getBucketLimit(bucket) <= kBucketBoundsNs[i]) {
+            result.counts[i] += histogram.getBucketCount(bucket);
+            ++bucket;
+        }
+    }
+    for (; bucket < Histogram::getBucketsNumber(); ++bucket) {
+        result.counts.back() += histogram.getBucketCount(bucket);
+    }
+    result.sum = static_cast<std::uint64_t>(histogram.getMean() *
+                                            histogram.getCount());
+    return result;
+}
+
+Histogram LatencyHistogram::get() const {
+    Histogram histogram;
+    for (const auto& shard : shards_) {
+        auto* buckets = shard.buckets.load(std::memory_order_acquire);
+        if (!buckets) {
+            continue;
+        }
+        for (std::size_t i = 0; i < Histogram::getBucketsNumber(); ++i) {
+            histogram.addBucket(i, buckets[i].load(std::memory_order_relaxed));
+        }
+    }
+    return histogram;
+}
+
+std::atomic<std::uint64_t>* LatencyHistogram::allocate_(Shard& shard) {
+    auto* buckets =
+        new std::atomic<std::uint64_t>[Histogram::getBucketsNumber()]();
+    std::atomic<std::uint64_t>* expected = nullptr;
+    /// other thread of the same shard could allocate buckets first
+    if (!shard.buckets.compare_exchange_strong(expected, buckets,
+                                               std::memory_order_acq_rel)) {
+        delete[] buckets;
+        return expected;
+    }
+    return buckets;
+}
+
+Registry& Registry::instance() {
+    static Registry registry;
+    return registry;
+}
+
+Counter& Registry::getCounter(const std::string& name, const std::string& help,
+                              const Labels& labels) {
+    auto& entry = getEntry_(name, help, labels, MetricType::Counter);
+    return *entry.counter;
+}
+
+Gauge& Registry::getGauge(const std::string& name, const std::string& help,
+                          const Labels& labels) {
+    auto& entry = getEntry_(name, help, labels, MetricType::Gauge);
+    return *entry.gauge;
+}
+
+LatencyHistogram& Registry::getHistogram(const std::string& name,
+                                         const std::string& help,
+                                         const Labels& labels) {
+    auto& entry = getEntry_(name, help, labels, MetricType::Histogram);
+    return *entry.histogram;
+}
+
+std::vector<Sample> Registry::collect() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<Sample> samples;
+    samples.reserve(entries_.size());
+    for (const auto& entry : entries_) {
+        auto& sample = samples.emplace_back();
+        sample.name = entry.name;
+        sample.help = entry.help;
+        sample.labels = entry.labels;
+        sample.type = entry.type;
+        switch (entry.type) {
+            case MetricType::Counter:
+                sample.value = entry.counter->get();
+                break;
+            case MetricType::Gauge:
+                sample.value = entry.gauge->get();
+                break;
+            case MetricType::Histogram:
+                sample.histogram = entry.histogram->get();
+                break;
+        }
+    }
+    return samples;
+}
+
+Registry::Entry& Registry::getEntry_(const std::string& name,
+                                     const std::string& help,
+                                     const Labels& labels, MetricType type) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& entry : entries_) {
+        if (entry.name == name && entry.labels == labels) {
+            if (entry.type != type) {
+                LOG_FATAL("Metric '" << name
+                                     << "' is registered with other type");
+            }
+            return entry;
+        }
+    }
+
+    auto& entry = entries_.emplace_back();
+    entry.name = name;
+    entry.help = help;
+    entry.labels = labels;
+    entry.type = type;
+    switch (type) {
+        case MetricType::Counter:
+            entry.counter = std::make_unique<Counter>();
+            break;
+        case MetricType::Gauge:
+            entry.gauge = std::make_unique<Gauge>();
+            break;
+        case MetricType::Histogram:
+            entry.histogram = std::make_unique<LatencyHistogram>();
+            break;
+    }
+    return entry;
+}
+
+}  // namespace havka::metrics
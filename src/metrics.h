@@ -0,0 +1,266 @@
+#ifndef HAVKA_SRC_METRICS_H_
+#define HAVKA_SRC_METRICS_H_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "histogram.h"
+
+/// Namespace with process-wide metrics of server
+/**
+ * Metrics are registered once (usually into function-local statics) and
+ * then updated from any thread without locks: every metric is split into
+ * kShards cache-line aligned shards, a thread always updates the same
+ * shard with relaxed atomics, and shards are merged only on read.
+ */
+namespace havka::metrics {
+
+/// Number of shards of every metric, threads are spread over shards
+constexpr std::size_t kShards = 16;
+
+/// Labels of metric, for example {{"type", "post"}}
+using Labels = std::vector<std::pair<std::string, std::string>>;
+
+/// Type of metric
+enum class MetricType { Counter, Gauge, Histogram };
+
+/**
+ * Returns shard index of the current thread
+ * @return index in [0, kShards)
+ */
+std::size_t getShardIndex();
+
+/**
+ * Returns current monotonic time in nanoseconds, used for latencies
+ * @return time in nanoseconds
+ */
+inline std::uint64_t getNowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+/// Monotonically increasing counter
+class Counter {
+public:
+    /**
+     * Increases counter
+     * @param value increment
+     */
+    void add(std::uint64_t value = 1) {
+        shards_[getShardIndex()].value.fetch_add(value,
+                                                 std::memory_order_relaxed);
+    }
+
+    /**
+     * Returns sum of all shards
+     * @return counter value
+     */
+    std::uint64_t get() const;
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<std::uint64_t> value{0};
+    };
+    std::array<Shard, kShards> shards_;
+};
+
+/// Value which can go up and down, for example number of queued messages
+class Gauge {
+public:
+    /**
+     * Changes gauge value
+     * @param value positive or negative difference
+     */
+    void add(std::int64_t value) {
+        shards_[getShardIndex()].value.fetch_add(value,
+                                                 std::memory_order_relaxed);
+    }
+
+    /**
+     * Returns sum of all shards
+     * @return gauge value
+     */
+    std::int64_t get() const;
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<std::int64_t> value{0};
+    };
+    std::array<Shard, kShards> shards_;
+};
+
+/// Log-linear histogram of latencies in nanoseconds
+/**
+ * Buckets of a shard are allocated on the first record to the shard,
+ * so unused shards do not take memory.
+ */
+class LatencyHistogram {
+public:
+    LatencyHistogram() = default;
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+    ~LatencyHistogram();
+
+    /**
+     * Records one value
+     * @param value latency in nanoseconds
+     */
+    void record(std::uint64_t value);
+
+    /**
+     * Merges all shards into one histogram
+     * @return histogram of recorded values
+     */
+    Histogram get() const;
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<std::atomic<std::uint64_t>*> buckets{nullptr};
+    };
+    std::array<Shard, kShards> shards_;
+
+    static std::atomic<std::uint64_t>* allocate_(Shard& shard);
+};
+
+/// Upper bounds of exported histogram buckets in nanoseconds, 10us to 10s
+constexpr std::array<std::uint64_t, 19> kBucketBoundsNs = {
+    10000,      25000,      50000,      100000,    250000,
+    500000,     1000000,    2500000,    5000000,   10000000,
+    25000000,   50000000,   100000000,  250000000, 500000000,
+    1000000000, 2500000000, 5000000000, 10000000000};
+
+/// Histogram with exported buckets only, small enough to be kept per topic.
+/**
+ * Not thread-safe, it is updated under lock of its owner.
+ */
+struct BucketHistogram {
+    /// counts[i] is number of values in (kBucketBoundsNs[i - 1],
+    /// kBucketBoundsNs[i]], the last one counts values above all bounds
+    std::array<std::uint64_t, kBucketBoundsNs.size() + 1> counts{};
+
+    /// Sum of recorded values
+    std::uint64_t sum{0};
+
+    /**
+     * Records one value
+     * @param value latency in nanoseconds
+     */
+    void record(std::uint64_t value);
+
+    /**
+     * Returns number of recorded values
+     * @return number of values
+     */
+    std::uint64_t getCount() const;
+
+    /**
+     * Converts log-linear histogram to exported buckets
+     * @param histogram histogram of latencies in nanoseconds
+     * @return histogram with exported buckets
+     */
+    static BucketHistogram fromHistogram(const Histogram& histogram);
+};
+
+/// Value of metric at the moment of collection
+struct Sample {
+    std::string name;
+    std::string help;
+    Labels labels;
+    MetricType type;
+
+    /// Value of counter or gauge
+    std::int64_t value{0};
+
+    /// Values of histogram, empty for counters and gauges
+    std::optional<Histogram> histogram;
+
+    /// Values of histogram kept with exported buckets only,
+    /// used instead of histogram if it is set
+    std::optional<BucketHistogram> buckets;
+};
+
+/// Registry of all metrics of the process
+class Registry {
+public:
+    Registry(const Registry&) = delete;
+    Registry& operator=(const Registry&) = delete;
+
+    /**
+     * Returns process-wide registry
+     * @return registry
+     */
+    static Registry& instance();
+
+    /**
+     * Returns counter with given name and labels, creates it if absent
+     * @param name metric name
+     * @param help description of metric
+     * @param labels labels of metric
+     * @return counter, valid until the end of the process
+     */
+    Counter& getCounter(const std::string& name, const std::string& help,
+                        const Labels& labels = {});
+
+    /**
+     * Returns gauge with given name and labels, creates it if absent
+     * @param name metric name
+     * @param help description of metric
+     * @param labels labels of metric
+     * @return gauge, valid until the end of the process
+     */
+    Gauge& getGauge(const std::string& name, const std::string& help,
+                    const Labels& labels = {});
+
+    /**
+     * Returns latency histogram with given name and labels,
+     * creates it if absent
+     * @param name metric name
+     * @param help description of metric
+     * @param labels labels of metric
+     * @return histogram, valid until the end of the process
+     */
+    LatencyHistogram& getHistogram(const std::string& name,
+                                   const std::string& help,
+                                   const Labels& labels = {});
+
+    /**
+     * Reads all metrics in order of registration
+     * @return current values of metrics
+     */
+    std::vector<Sample> collect() const;
+
+private:
+    struct Entry {
+        std::string name;
+        std::string help;
+        Labels labels;
+        MetricType type;
+        std::unique_ptr<Counter> counter;
+        std::unique_ptr<Gauge> gauge;
+        std::unique_ptr<LatencyHistogram> histogram;
+    };
+
+    mutable std::mutex mutex_;
+    /// deque keeps references to entries valid on insertion
+    std::deque<Entry> entries_;
+
+    Registry() = default;
+
+    Entry& getEntry_(const std::string& name, const std::string& help,
+                     const Labels& labels, MetricType type);
+};
+
+}  // namespace havka::metrics
+
+#endif  // HAVKA_SRC_METRICS_H_
@@ -0,0 +1,65 @@
+#include "profiled_mutex.h"
+
+#ifdef HAVKA_PROFILE_LOCKS
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+namespace havka {
+
+ProfiledMutex::ProfiledMutex(const char* site) : site_(getSite_(site)) {}
+
+void ProfiledMutex::lock() {
+    if (!mutex_.try_lock()) {
+        auto start = metrics::getNowNs();
+        mutex_.lock();
+        acquiredAt_ = metrics::getNowNs();
+        site_.contended.add();
+        site_.wait.record(acquiredAt_ - start);
+        return;
+    }
+    acquiredAt_ = metrics::getNowNs();
+    site_.wait.record(0);
+}
+
+bool ProfiledMutex::try_lock() {
+    if (!mutex_.try_lock()) {
+        return false;
+    }
+    acquiredAt_ = metrics::getNowNs();
+    site_.wait.record(0);
+    return true;
+}
+
+void ProfiledMutex::unlock() {
+    auto held = metrics::getNowNs() - acquiredAt_;
+    mutex_.unlock();
+    site_.hold.record(held);
+}
+
+ProfiledMutex::Site& ProfiledMutex::getSite_(const char* site) {
+    /// mutexes are created per topic, so sites are cached here
+    /// instead of being looked up in the registry every time
+    static std::mutex mutex;
+    static std::unordered_map<std::string, std::unique_ptr<Site>> sites;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto& entry = sites[site];
+    if (!entry) {
+        auto& registry = metrics::Registry::instance();
+        metrics::Labels labels = {{"lock", site}};
+        entry.reset(new Site{
+            registry.getCounter("havka_lock_contended_total",
+                                "Acquisitions which waited for lock", labels),
+            registry.getHistogram("havka_lock_wait_seconds",
+                                  "Time of waiting for lock", labels),
+            registry.getHistogram("havka_lock_hold_seconds",
+                                  "Time of holding lock", labels)});
+    }
+    return *entry;
+}
+
+}  // namespace havka
+
+#endif
@@ -0,0 +1,164 @@
+#include "server/capture.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include "metrics.h"
+#include "util.h"
+
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__,
+              "Capture format is little-endian");
+
+namespace havka {
+
+namespace {
+
+constexpr char kCaptureMagic[8] = {'H', 'V', 'K', 'C', 'A', 'P', 'T', '\0'};
+constexpr std::uint32_t kCaptureVersion = 1;
+constexpr std::size_t kHeaderSize = 24;
+/// Size of record without topic and group
+constexpr std::size_t kRecordSize = 25;
+/// Buffer is written to file when it is larger
+constexpr std::size_t kFlushSize = 1 << 16;
+
+template <typename T>
+void appendValue(std::string& buffer, T value) {
+    buffer.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T>
+T readValue(const char*& pos) {
+    T value;
+    std::memcpy(&value, pos, sizeof(value));
+    pos += sizeof(value);
+    return value;
+}
+
+}  // namespace
+
+CaptureWriter::CaptureWriter(const std::string& path)
+    : file_(std::fopen(path.c_str(), "wb")),
+      start_(metrics::getNowNs()),
+      good_(file_ != nullptr) {
+    if (!good_) {
+        LOG_ERROR("Can not open capture file '" << path << "'");
+        return;
+    }
+    std::uint64_t startTime =
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch())
+            .count();
+    buffer_.reserve(kFlushSize + 1024);
+    buffer_.append(kCaptureMagic, sizeof(kCaptureMagic));
+    appendValue(buffer_, kCaptureVersion);
+    appendValue(buffer_, std::uint32_t{0});
+    appendValue(buffer_, startTime);
+    flush_();
+}
+
+CaptureWriter::~CaptureWriter() {
+    if (file_) {
+        flush();
+        std::fclose(file_);
+    }
+}
+
+bool CaptureWriter::good() const { return good_; }
+
+void CaptureWriter::write(std::uint64_t connection, const Request& request) {
+    auto time = metrics::getNowNs() - start_;
+    std::uint32_t payloadSize =
+        request.message ? static_cast<std::uint32_t>(request.message->data.size())
+                        : 0;
+    auto topicSize = static_cast<std::uint16_t>(
+        std::min<std::size_t>(request.topic.size(), UINT16_MAX));
+    auto groupSize = static_cast<std::uint16_t>(
+        std::min<std::size_t>(request.group.size(), UINT16_MAX));
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!good_) {
+        return;
+    }
+    appendValue(buffer_, time);
+    appendValue(buffer_, connection);
+    appendValue(buffer_, static_cast<std::uint8_t>(request.type));
+    appendValue(buffer_, payloadSize);
+    appendValue(buffer_, topicSize);
+    appendValue(buffer_, groupSize);
+    buffer_.append(request.topic.data(), topicSize);
+    buffer_.append(request.group.data(), groupSize);
+    if (buffer_.size() >= kFlushSize) {
+        flush_();
+    }
+}
+
+void CaptureWriter::flush() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    flush_();
+    if (good_ && std::fflush(file_) != 0) {
+        good_ = false;
+    }
+}
+
+void CaptureWriter::flush_() {
+    if (good_ && !buffer_.empty() &&
+        std::fwrite(buffer_.data(), 1, buffer_.size(), file_) !=
+            buffer_.size()) {
+        LOG_ERROR("Can not write capture file, capture is stopped");
+        good_ = false;
+    }
+    buffer_.clear();
+}
+
+CaptureReader::CaptureReader(const std::string& path)
+    : file_(std::fopen(path.c_str(), "rb")), startTime_(0), good_(false) {
+    if (!file_) {
+        LOG_ERROR("Can not open capture file '" << path << "'");
+        return;
+    }
+    char header[kHeaderSize];
+    if (std::fread(header, 1, kHeaderSize, file_) != kHeaderSize ||
+        std::memcmp(header, kCaptureMagic, sizeof(kCaptureMagic)) != 0) {
+        LOG_ERROR("File '" << path << "' is not a capture");
+        return;
+    }
+    const char* pos = header + sizeof(kCaptureMagic);
+    if (readValue<std::uint32_t>(pos) != kCaptureVersion) {
+        LOG_ERROR("Capture '" << path << "' has unsupported version");
+        return;
+    }
+    pos += sizeof(std::uint32_t);
+    startTime_ = readValue<std::uint64_t>(pos);
+    good_ = true;
+}
+
+CaptureReader::~CaptureReader() {
+    if (file_) {
+        std::fclose(file_);
+    }
+}
+
+bool CaptureReader::good() const { return good_; }
+
+std::uint64_t CaptureReader::getStartTime() const { return startTime_; }
+
+bool CaptureReader::next(CaptureRecord& record) {
+    char fixed[kRecordSize];
+    if (!good_ || std::fread(fixed, 1, kRecordSize, file_) != kRecordSize) {
+        return false;
+    }
+    const char* pos = fixed;
+    record.time = readValue<std::uint64_t>(pos);
+    record.connection = readValue<std::uint64_t>(pos);
+    record.type = static_cast<RequestType>(readValue<std::uint8_t>(pos));
+    record.payloadSize = readValue<std::uint32_t>(pos);
+    auto topicSize = readValue<std::uint16_t>(pos);
+    auto groupSize = readValue<std::uint16_t>(pos);
+    record.topic.resize(topicSize);
+    record.group.resize(groupSize);
+    return std::fread(record.topic.data(), 1, topicSize, file_) == topicSize &&
+           std::fread(record.group.data(), 1, groupSize, file_) == groupSize;
+}
+
+}  // namespace havka
@@ -0,0 +1,131 @@
+#ifndef HAVKA_SRC_SERVER_CAPTURE_H_
+#define HAVKA_SRC_SERVER_CAPTURE_H_
+
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+
+#include "message.hpp"
+
+namespace havka {
+
+/// One captured request
+struct CaptureRecord {
+    /// Time of receiving in nanoseconds since the start of capture
+    std::uint64_t time{0};
+
+    /// Server-wide id of connection which sent request
+    std::uint64_t connection{0};
+
+    RequestType type{RequestType::PostMessageSafe};
+
+    /// Size of message data (0 if request has no message)
+    std::uint32_t payloadSize{0};
+
+    std::string topic;
+
+    /// Consumer group of request to log topic
+    std::string group;
+};
+
+/// Writes compact binary trace of incoming requests. Thread-safe.
+/**
+ * Trace format (all integers are little-endian):
+ * - header: magic "HVKCAPT" + '\0' (8 bytes), version (u32), reserved (u32),
+ *   wall clock time of start in microseconds since Unix epoch (u64);
+ * - records: time (u64), connection (u64), type (u8), payload size (u32),
+ *   topic length (u16), group length (u16), topic, group.
+ * Message data is not captured, only its size. Records are buffered and
+ * written by the thread which fills the buffer, records of different
+ * connections can be slightly out of time order.
+ */
+class CaptureWriter {
+public:
+    CaptureWriter() = delete;
+    CaptureWriter(const CaptureWriter&) = delete;
+    CaptureWriter& operator=(const CaptureWriter&) = delete;
+
+    /**
+     * Creates trace file and writes header
+     * @param path path to trace file
+     */
+    explicit CaptureWriter(const std::string& path);
+
+    /**
+     * Writes buffered records and closes file
+     */
+    ~CaptureWriter();
+
+    /**
+     * Checks if file was opened and all writes were successful
+     * @return true if there were no errors
+     */
+    bool good() const;
+
+    /**
+     * Adds record of request received now
+     * @param connection id of connection
+     * @param request received request
+     */
+    void write(std::uint64_t connection, const Request& request);
+
+    /**
+     * Writes buffered records to file
+     */
+    void flush();
+
+private:
+    std::FILE* file_;
+    std::uint64_t start_;
+    std::mutex mutex_;
+    std::string buffer_;
+    bool good_;
+
+    /// Writes buffer_ to file, must be called under mutex_
+    void flush_();
+};
+
+/// Reads trace written by CaptureWriter record by record
+class CaptureReader {
+public:
+    CaptureReader() = delete;
+    CaptureReader(const CaptureReader&) = delete;
+    CaptureReader& operator=(const CaptureReader&) = delete;
+
+    /**
+     * Opens trace file and checks header
+     * @param path path to trace file
+     */
+    explicit CaptureReader(const std::string& path);
+
+    ~CaptureReader();
+
+    /**
+     * Checks if file was opened and has valid header
+     * @return true if trace can be read
+     */
+    bool good() const;
+
+    /**
+     * Returns wall clock time of the start of capture
+     * @return microseconds since Unix epoch
+     */
+    std::uint64_t getStartTime() const;
+
+    /**
+     * Reads next record
+     * @param record record to fill
+     * @return false at the end of trace or on truncated record
+     */
+    bool next(CaptureRecord& record);
+
+private:
+    std::FILE* file_;
+    std::uint64_t startTime_;
+    bool good_;
+};
+
+}  // namespace havka
+
+#endif  // HAVKA_SRC_SERVER_CAPTURE_H_
@@ -0,0 +1,105 @@
+#include "server/message_log.h"
+
+#include <algorithm>
+
+namespace havka {
+
+MessageLog::MessageLog(LogRetention retention) : retention_(retention) {}
+
+std::uint64_t MessageLog::append(const Message &message) {
+    entries_.push_back({message, std::chrono::steady_clock::now()});
+    bytes_ += message.data.size();
+    std::uint64_t offset = getEndOffset() - 1;
+    evict_();
+    return offset;
+}
+
+std::optional<Message> MessageLog::read(std::uint64_t offset) {
+    evict_();
+    if (offset < beginOffset_ || offset >= getEndOffset()) {
+        return std::nullopt;
+    }
+    return entries_[offset - beginOffset_].message;
+}
+
+std::optional<Message> MessageLog::readNext(const std::string &group,
+                                            std::uint64_t *offset) {
+    evict_();
+    auto it = groupOffsets_.try_emplace(group, beginOffset_).first;
+    /// messages at group offset could be evicted
+    it->second = std::max(it->second, beginOffset_);
+    if (it->second >= getEndOffset()) {
+        return std::nullopt;
+    }
+    if (offset) {
+        *offset = it->second;
+    }
+    return entries_[it->second++ - beginOffset_].message;
+}
+
+std::uint64_t MessageLog::seek(const std::string &group,
+                               std::uint64_t offset) {
+    evict_();
+    offset = std::clamp(offset, beginOffset_, getEndOffset());
+    groupOffsets_[group] = offset;
+    return offset;
+}
+
+void MessageLog::trim() { evict_(); }
+
+std::uint64_t MessageLog::getBeginOffset() {
+    evict_();
+    return beginOffset_;
+}
+
+std::uint64_t MessageLog::getEndOffset() const {
+    return beginOffset_ + entries_.size();
+}
+
+std::size_t MessageLog::getBytes() const { return bytes_; }
+
+std::vector<Message> MessageLog::getMessages() const {
+    std::vector<Message> messages;
+    messages.reserve(entries_.size());
+    for (const auto &entry : entries_) {
+        messages.push_back(entry.message);
+    }
+    return messages;
+}
+
+const std::unordered_map<std::string, std::uint64_t> &
+MessageLog::getGroupOffsets() const {
+    return groupOffsets_;
+}
+
+void MessageLog::restore(
+    std::uint64_t beginOffset, std::vector<Message> messages,
+    std::unordered_map<std::string, std::uint64_t> groupOffsets) {
+    auto now = std::chrono::steady_clock::now();
+    entries_.clear();
+    bytes_ = 0;
+    for (auto &message : messages) {
+        bytes_ += message.data.size();
+        entries_.push_back({std::move(message), now});
+    }
+    beginOffset_ = beginOffset;
+    groupOffsets_ = std::move(groupOffsets);
+    evict_();
+}
+
+void MessageLog::evict_() {
+    auto now = std::chrono::steady_clock::now();
+    while (!entries_.empty()) {
+        bool tooLarge = retention_.maxBytes > 0 && bytes_ > retention_.maxBytes;
+        bool tooOld = retention_.maxAge.count() > 0 &&
+                      now - entries_.front().time > retention_.maxAge;
+        if (!tooLarge && !tooOld) {
+            return;
+        }
+        bytes_ -= entries_.front().message.data.size();
+        entries_.pop_front();
+        ++beginOffset_;
+    }
+}
+
+}  // namespace havka
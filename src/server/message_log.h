@@ -0,0 +1,144 @@
+#ifndef HAVKA_SRC_SERVER_MESSAGE_LOG_H_
+#define HAVKA_SRC_SERVER_MESSAGE_LOG_H_
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "message.hpp"
+
+namespace havka {
+
+/// Retention limits of a message log. Zero means no limit.
+struct LogRetention {
+    /// Maximum total size of retained message data in bytes
+    std::size_t maxBytes{0};
+
+    /// Maximum age of retained messages
+    std::chrono::seconds maxAge{0};
+};
+
+/// Retained log of messages of one topic with consumer group offsets.
+/**
+ * Class MessageLog appends messages to a log instead of a queue, so reading
+ * is not destructive: every consumer group has its own offset, different
+ * groups read the same messages independently and a group can seek back
+ * to replay. Old messages are evicted by size and age limits.
+ * Offsets are increasing from 0 and never reused.
+ * Not thread-safe.
+ */
+class MessageLog {
+public:
+    /**
+     * Constructs empty log
+     * @param retention size and age limits of the log
+     */
+    explicit MessageLog(LogRetention retention = {});
+
+    /**
+     * Appends message to the end of the log, then evicts old messages
+     * if retention limits are exceeded
+     * @param message message to append
+     * @return offset of appended message
+     */
+    std::uint64_t append(const Message& message);
+
+    /**
+     * Reads message with given offset
+     * @param offset offset of message
+     * @return message or std::nullopt if it is evicted or not written yet
+     */
+    std::optional<Message> read(std::uint64_t offset);
+
+    /**
+     * Reads message at offset of consumer group and advances the offset,
+     * so the message is delivered to the group at most once.
+     * New group starts from the oldest retained message.
+     * @param group consumer group name
+     * @param offset if not null, receives offset of returned message
+     * @return message or std::nullopt if group has read the whole log
+     */
+    std::optional<Message> readNext(const std::string& group,
+                                    std::uint64_t* offset = nullptr);
+
+    /**
+     * Sets offset of consumer group. Offset is clamped to
+     * [getBeginOffset(), getEndOffset()].
+     * @param group consumer group name
+     * @param offset new offset of group
+     * @return offset which was set
+     */
+    std::uint64_t seek(const std::string& group, std::uint64_t offset);
+
+    /**
+     * Evicts messages exceeding retention limits. Other calls evict them
+     * too, so it is needed only to apply age limit to idle logs.
+     */
+    void trim();
+
+    /**
+     * Returns offset of the oldest retained message
+     * @return begin offset
+     */
+    std::uint64_t getBeginOffset();
+
+    /**
+     * Returns offset which the next appended message will get
+     * @return end offset
+     */
+    std::uint64_t getEndOffset() const;
+
+    /**
+     * Returns total size of retained message data in bytes
+     * @return size in bytes
+     */
+    std::size_t getBytes() const;
+
+    /**
+     * Returns copies of retained messages in offset order
+     * @return messages starting from getBeginOffset()
+     */
+    std::vector<Message> getMessages() const;
+
+    /**
+     * Returns offsets of all consumer groups
+     * @return offsets by group name
+     */
+    const std::unordered_map<std::string, std::uint64_t>& getGroupOffsets()
+        const;
+
+    /**
+     * Replaces content of the log, used to load it from snapshot.
+     * Age of restored messages is counted from the call.
+     * @param beginOffset offset of the first message
+     * @param messages messages in offset order
+     * @param groupOffsets offsets of consumer groups
+     */
+    void restore(std::uint64_t beginOffset, std::vector<Message> messages,
+                 std::unordered_map<std::string, std::uint64_t> groupOffsets);
+
+private:
+    struct Entry {
+        Message message;
+        std::chrono::steady_clock::time_point time;
+    };
+
+    LogRetention retention_;
+    std::deque<Entry> entries_;
+    std::uint64_t beginOffset_{0};
+    std::size_t bytes_{0};
+    std::unordered_map<std::string, std::uint64_t> groupOffsets_;
+
+    /**
+     * Evicts messages exceeding retention limits
+     */
+    void evict_();
+};
+
+}  // namespace havka
+
+#endif  // HAVKA_SRC_SERVER_MESSAGE_LOG_H_
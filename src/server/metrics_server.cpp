@@ -0,0 +1,220 @@
+#include "server/metrics_server.h"
+
+#include <algorithm>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <functional>
+#include <sstream>
+
+namespace havka {
+
+namespace {
+
+namespace beast = boost::beast;
+namespace http = boost::beast::http;
+
+std::string escapeLabelValue(const std::string& value) {
+    std::string escaped;
+    escaped.reserve(value.size());
+    for (char c : value) {
+        if (c == '\\' || c == '"') {
+            escaped += '\\';
+            escaped += c;
+        } else if (c == '\n') {
+            escaped += "\\n";
+        } else {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+/// Writes labels with optional extra label, e.g. {type="post",le="0.1"}
+void writeLabels(std::ostream& out, const metrics::Labels& labels,
+                 const std::string& extraName = "",
+                 const std::string& extraValue = "") {
+    if (labels.empty() && extraName.empty()) {
+        return;
+    }
+    out << '{';
+    bool first = true;
+    for (const auto& [name, value] : labels) {
+        out << (first ? "" : ",") << name << "=\"" << escapeLabelValue(value)
+            << '"';
+        first = false;
+    }
+    if (!extraName.empty()) {
+        out << (first ? "" : ",") << extraName << "=\"" << extraValue << '"';
+    }
+    out << '}';
+}
+
+void writeHistogram(std::ostream& out, const metrics::Sample& sample) {
+    auto histogram =
+        sample.buckets
+            ? *sample.buckets
+            : metrics::BucketHistogram::fromHistogram(*sample.histogram);
+    std::uint64_t cumulative = 0;
+    for (std::size_t i = 0; i < metrics::kBucketBoundsNs.size(); ++i) {
+        cumulative += histogram.counts[i];
+        std::ostringstream le;
+        le << metrics::kBucketBoundsNs[i] / 1e9;
+        out << sample.name << "_bucket";
+        writeLabels(out, sample.labels, "le", le.str());
+        out << ' ' << cumulative << '\n';
+    }
+    auto count = cumulative + histogram.counts.back();
+    out << sample.name << "_bucket";
+    writeLabels(out, sample.labels, "le", "+Inf");
+    out << ' ' << count << '\n';
+    out << sample.name << "_sum";
+    writeLabels(out, sample.labels);
+    out << ' ' << histogram.sum / 1e9 << '\n';
+    out << sample.name << "_count";
+    writeLabels(out, sample.labels);
+    out << ' ' << count << '\n';
+}
+
+const char* getTypeName(metrics::MetricType type) {
+    switch (type) {
+        case metrics::MetricType::Counter:
+            return "counter";
+        case metrics::MetricType::Gauge:
+            return "gauge";
+        case metrics::MetricType::Histogram:
+            return "histogram";
+    }
+    return "untyped";
+}
+
+/// One HTTP connection of metrics endpoint
+class MetricsSession : public std::enable_shared_from_this<MetricsSession> {
+public:
+    MetricsSession(tcp::socket socket, std::function<std::string()> render)
+        : socket_(std::move(socket)), render_(std::move(render)) {}
+
+    void start() {
+        request_ = {};
+        auto self = shared_from_this();
+        http::async_read(socket_, buffer_, request_,
+                         [self](beast::error_code ec, std::size_t) {
+                             if (!ec) {
+                                 self->writeResponse_();
+                             }
+                         });
+    }
+
+private:
+    tcp::socket socket_;
+    beast::flat_buffer buffer_;
+    http::request<http::string_body> request_;
+    http::response<http::string_body> response_;
+    std::function<std::string()> render_;
+
+    void writeResponse_() {
+        response_ = {};
+        response_.version(request_.version());
+        response_.keep_alive(request_.keep_alive());
+        if (request_.method() == http::verb::get &&
+            request_.target() == "/metrics") {
+            response_.result(http::status::ok);
+            response_.set(http::field::content_type,
+                          "text/plain; version=0.0.4");
+            response_.body() = render_();
+        } else {
+            response_.result(http::status::not_found);
+            response_.set(http::field::content_type, "text/plain");
+            response_.body() = "Not found\n";
+        }
+        response_.prepare_payload();
+
+        auto self = shared_from_this();
+        http::async_write(socket_, response_,
+                          [self](beast::error_code ec, std::size_t) {
+                              if (!ec && self->response_.keep_alive()) {
+                                  self->start();
+                              } else {
+                                  self->socket_.shutdown(
+                                      tcp::socket::shutdown_send, ec);
+                              }
+                          });
+    }
+};
+
+}  // namespace
+
+std::string formatPrometheus(std::vector<metrics::Sample> samples) {
+    /// all samples of one metric family must be adjacent
+    std::stable_sort(samples.begin(), samples.end(),
+                     [](const auto& lhs, const auto& rhs) {
+                         return lhs.name < rhs.name;
+                     });
+
+    std::ostringstream out;
+    for (std::size_t i = 0; i < samples.size(); ++i) {
+        const auto& sample = samples[i];
+        if (i == 0 || samples[i - 1].name != sample.name) {
+            out << "# HELP " << sample.name << ' ' << sample.help << '\n';
+            out << "# TYPE " << sample.name << ' ' << getTypeName(sample.type)
+                << '\n';
+        }
+        if (sample.type == metrics::MetricType::Histogram) {
+            writeHistogram(out, sample);
+        } else {
+            out << sample.name;
+            writeLabels(out, sample.labels);
+            out << ' ' << sample.value << '\n';
+        }
+    }
+    return out.str();
+}
+
+MetricsServer::MetricsServer(net::io_context& ioc,
+                             const tcp::endpoint& endpoint,
+                             std::shared_ptr<IMessageStorage> storage)
+    : acceptor_(ioc, endpoint), storage_(std::move(storage)) {}
+
+void MetricsServer::start() { acceptLoop_(); }
+
+void MetricsServer::acceptLoop_() {
+    acceptor_.async_accept([this](boost::system::error_code ec,
+                                  tcp::socket socket) {
+        if (!ec) {
+            std::make_shared<MetricsSession>(std::move(socket),
+                                             [this] { return render_(); })
+                ->start();
+        }
+        acceptLoop_();
+    });
+}
+
+std::string MetricsServer::render_() const {
+    auto samples = metrics::Registry::instance().collect();
+    for (auto& stats : storage_->getTopicStats()) {
+        metrics::Labels labels = {{"topic", std::move(stats.topic)}};
+
+        auto& depth = samples.emplace_back();
+        depth.name = "havka_topic_messages";
+        depth.help = "Messages stored in queue topic";
+        depth.labels = labels;
+        depth.type = metrics::MetricType::Gauge;
+        depth.value = static_cast<std::int64_t>(stats.depth);
+
+        auto& age = samples.emplace_back();
+        age.name = "havka_topic_oldest_message_age_milliseconds";
+        age.help = "Time spent in queue topic by its oldest message";
+        age.labels = labels;
+        age.type = metrics::MetricType::Gauge;
+        age.value = static_cast<std::int64_t>(stats.oldestAge / 1000000);
+
+        auto& queueTime = samples.emplace_back();
+        queueTime.name = "havka_topic_queue_time_seconds";
+        queueTime.help = "Time spent in queue topic by delivered messages";
+        queueTime.labels = std::move(labels);
+        queueTime.type = metrics::MetricType::Histogram;
+        queueTime.buckets = stats.queueTime;
+    }
+    return formatPrometheus(std::move(samples));
+}
+
+}  // namespace havka
@@ -0,0 +1,65 @@
+#ifndef HAVKA_SRC_SERVER_METRICS_SERVER_H_
+#define HAVKA_SRC_SERVER_METRICS_SERVER_H_
+
+#include <boost/asio.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "metrics.h"
+#include "server/storage.h"
+
+namespace havka {
+
+/**
+ * Formats metrics in Prometheus text exposition format. Latency histograms
+ * are written in seconds with fixed buckets from 10us to 10s.
+ * @param samples metrics to format, samples with equal names are grouped
+ * @return text of metrics
+ */
+std::string formatPrometheus(std::vector<metrics::Sample> samples);
+
+/// HTTP endpoint which serves metrics in Prometheus format on GET /metrics.
+/**
+ * Endpoint runs on the io_context of server, so it does not need own
+ * threads. Besides registered metrics it reports number of messages,
+ * age of the oldest message and time in queue of delivered messages
+ * for every topic of storage.
+ */
+class MetricsServer {
+public:
+    MetricsServer() = delete;
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+
+    /**
+     * Opens acceptor of metrics endpoint
+     * @param ioc io_context of server
+     * @param endpoint address and port of metrics endpoint
+     * @param storage storage to report topic depths
+     */
+    MetricsServer(net::io_context& ioc, const tcp::endpoint& endpoint,
+                  std::shared_ptr<IMessageStorage> storage);
+
+    /**
+     * Creates callback on new HTTP connection.
+     * Non-blocking
+     */
+    void start();
+
+private:
+    tcp::acceptor acceptor_;
+    std::shared_ptr<IMessageStorage> storage_;
+
+    void acceptLoop_();
+
+    /**
+     * Collects all metrics and formats them
+     * @return body of response
+     */
+    std::string render_() const;
+};
+
+}  // namespace havka
+
+#endif  // HAVKA_SRC_SERVER_METRICS_SERVER_H_
@@ -4,115 +4,821 @@
 
 #include "server/net.h"
 
+#include <sys/uio.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
 #include <utility>
 
+#include "codec.hpp"
+#include "metrics.h"
+#include "server/probes.h"
+#include "server/trace.h"
+#include "server/zerocopy.h"
+
 namespace havka {
 
-Connection::Connection(tcp::socket socket,
+namespace {
+
+/// Metrics of all connections, registered on the first use
+struct ConnectionMetrics {
+    /// Requests per RequestType
+    std::array<metrics::Counter *, 5> requests;
+    metrics::Counter &bytesReceived;
+    metrics::Counter &bytesSent;
+    metrics::Gauge &connections;
+    metrics::LatencyHistogram &decodeLatency;
+    metrics::LatencyHistogram &storageLatency;
+    metrics::LatencyHistogram &lockWaitLatency;
+    metrics::LatencyHistogram &encodeLatency;
+    metrics::LatencyHistogram &writeLatency;
+    metrics::Counter &writes;
+    metrics::Counter &zeroCopySends;
+    metrics::Counter &zeroCopyCopied;
+    metrics::Counter &streamedRequests;
+};
+
+metrics::LatencyHistogram &getStageHistogram(const std::string &stage) {
+    return metrics::Registry::instance().getHistogram(
+        "havka_request_stage_seconds", "Latency of request processing stages",
+        {{"stage", stage}});
+}
+
+ConnectionMetrics &getMetrics() {
+    static ConnectionMetrics connectionMetrics = [] {
+        auto &registry = metrics::Registry::instance();
+        const char *types[] = {"post", "get_blocking", "get_nonblocking",
+                               "confirmation", "seek"};
+        std::array<metrics::Counter *, 5> requests{};
+        for (std::size_t i = 0; i < requests.size(); ++i) {
+            requests[i] = &registry.getCounter("havka_requests_total",
+                                               "Requests received by type",
+                                               {{"type", types[i]}});
+        }
+        return ConnectionMetrics{
+            requests,
+            registry.getCounter("havka_received_bytes_total",
+                                "Bytes received from clients"),
+            registry.getCounter("havka_sent_bytes_total",
+                                "Bytes sent to clients"),
+            registry.getGauge("havka_connections", "Open client connections"),
+            getStageHistogram("decode"),
+            getStageHistogram("storage"),
+            getStageHistogram("lock_wait"),
+            getStageHistogram("encode"),
+            getStageHistogram("write"),
+            registry.getCounter("havka_writes_total",
+                                "Gathered writes of responses to clients"),
+            registry.getCounter("havka_zerocopy_sends_total",
+                                "Sends to clients with MSG_ZEROCOPY"),
+            registry.getCounter(
+                "havka_zerocopy_copied_total",
+                "Connections where kernel copied zerocopy sends"),
+            registry.getCounter(
+                "havka_streamed_requests_total",
+                "Requests whose message was read straight into storage")};
+    }();
+    return connectionMetrics;
+}
+
+void countRequest(RequestType type) {
+    auto &requests = getMetrics().requests;
+    if (static_cast<std::size_t>(type) < requests.size()) {
+        requests[type]->add();
+    }
+}
+
+std::atomic<bool> enqueueTimeReturned{false};
+
+std::atomic<std::size_t> writeBatchSize{256 * 1024};
+
+/// Maximal number of buffers of one gathered write (writev limit)
+constexpr std::size_t kMaxWriteBuffers = IOV_MAX;
+
+std::atomic<std::size_t> zeroCopyThreshold{0};
+
+std::atomic<std::size_t> streamThreshold{64 * 1024};
+
+/// Reply to delivery confirmation
+const char kAcceptReply = 1;
+
+/// Drops first size bytes of buffers
+void consumeBuffers(std::vector<net::const_buffer> &buffers,
+                    std::size_t size) {
+    auto it = buffers.begin();
+    while (it != buffers.end() && size >= it->size()) {
+        size -= it->size();
+        ++it;
+    }
+    buffers.erase(buffers.begin(), it);
+    if (size != 0) {
+        buffers.front() += size;
+    }
+}
+
+std::atomic<std::uint64_t> lastConnectionId{0};
+
+/// Returns enqueue time for response with message if it is returned
+std::optional<std::int64_t> getEnqueueTime(
+    const std::optional<Message> &message) {
+    if (!message || message->enqueueTime == 0 ||
+        !enqueueTimeReturned.load(std::memory_order_relaxed)) {
+        return std::nullopt;
+    }
+    return message->enqueueTime;
+}
+
+/// Records finished write started at given time
+void countWrite(std::uint64_t start, std::size_t length) {
+    getMetrics().writeLatency.record(metrics::getNowNs() - start);
+    getMetrics().bytesSent.add(length);
+}
+
+}  // namespace
+
+Connection::Connection(stream_socket socket,
                        std::shared_ptr<IMessageStorage> storage,
-                       std::size_t maxBufferSize)
+                       std::shared_ptr<CaptureWriter> capture,
+                       std::shared_ptr<ShardExecutor> shards,
+                       std::size_t maxMessageSize)
     : socket_(std::move(socket)),
       storage_(std::move(storage)),
-      buffer_(new char[maxBufferSize]),
       bufSize_(0),
-      maxBufSize_(maxBufferSize),
+      frameSize_(0),
+      streamed_(false),
+      maxMessageSize_(maxMessageSize),
       waitingAccept_(false),
-      getBlock_(false) {}
+      capture_(std::move(capture)),
+      shards_(std::move(shards)),
+      id_(++lastConnectionId),
+      writing_(false),
+      zeroCopyChecked_(false),
+      zeroCopy_(false),
+      zeroCopySent_(0),
+      zeroCopyCompleted_(0),
+      zeroCopyWaits_(0) {
+    /// readFrame_ tries to read the next request before waiting for it
+    boost::system::error_code ec;
+    socket_->non_blocking(true, ec);
+    getMetrics().connections.add(1);
+}
+
+Connection::Connection(std::shared_ptr<ShmStream> stream,
+                       std::shared_ptr<IMessageStorage> storage,
+                       std::shared_ptr<CaptureWriter> capture,
+                       std::shared_ptr<ShardExecutor> shards,
+                       std::size_t maxMessageSize)
+    : shm_(std::move(stream)),
+      storage_(std::move(storage)),
+      bufSize_(0),
+      frameSize_(0),
+      streamed_(false),
+      maxMessageSize_(maxMessageSize),
+      waitingAccept_(false),
+      capture_(std::move(capture)),
+      shards_(std::move(shards)),
+      id_(++lastConnectionId),
+      writing_(false),
+      zeroCopyChecked_(false),
+      zeroCopy_(false),
+      zeroCopySent_(0),
+      zeroCopyCompleted_(0),
+      zeroCopyWaits_(0) {
+    getMetrics().connections.add(1);
+}
 
 Connection::~Connection() {
-    if (waitingAccept_) {
+    /// messages from logs and broadcast topics are not returned,
+    /// log consumers can seek back to replay them
+    if (waitingAccept_ && response_.message && !response_.offset) {
         LOG_INFO("Accept was not received\n");
-        storage_->postMessage(*response_.message, request_.topic);
+        storage_->postMessage(std::move(*response_.message), response_.topic);
+    }
+    /// client of shared memory waits until the channel is closed
+    if (shm_) {
+        shm_->close();
+    }
+    getMetrics().connections.add(-1);
+}
+
+void Connection::setEnqueueTimeReturned(bool returned) {
+    enqueueTimeReturned = returned;
+}
+
+void Connection::setWriteBatchSize(std::size_t size) {
+    writeBatchSize = size;
+}
+
+void Connection::setZeroCopyThreshold(std::size_t size) {
+    zeroCopyThreshold = size;
+}
+
+void Connection::setStreamThreshold(std::size_t size) {
+    streamThreshold = size;
+}
+
+template <typename Handler>
+void Connection::readSome_(net::mutable_buffer buffer, Handler &&handler) {
+    if (shm_) {
+        shm_->asyncReadSome(buffer, std::forward<Handler>(handler));
+    } else {
+        socket_->async_read_some(buffer, std::forward<Handler>(handler));
+    }
+}
+
+template <typename Buffers, typename Handler>
+void Connection::write_(const Buffers &buffers, Handler &&handler) {
+    if (shm_) {
+        shm_->write({net::buffer_sequence_begin(buffers),
+                     net::buffer_sequence_end(buffers)},
+                    std::forward<Handler>(handler));
+    } else {
+        net::async_write(*socket_, buffers, std::forward<Handler>(handler));
+    }
+}
+
+template <typename Handler>
+void Connection::send_(std::array<net::const_buffer, 3> buffers,
+                       Handler &&handler) {
+    auto size = net::buffer_size(buffers);
+    auto threshold = zeroCopyThreshold.load(std::memory_order_relaxed);
+    bool direct = threshold == 0 || size < threshold;
+    {
+        std::lock_guard<std::mutex> lock(outboundMutex_);
+        if (writing_ || !direct) {
+            outbound_.push_back(
+                {buffers, WriteHandler(std::forward<Handler>(handler))});
+            if (writing_) {
+                return;
+            }
+        }
+        writing_ = true;
+    }
+    if (!direct) {
+        flushOutbound_();
+        return;
+    }
+
+    /// the only item is written without queue and type-erased handler
+    getMetrics().writes.add();
+    auto self = shared_from_this();
+    write_(buffers, [self, handler = std::forward<Handler>(handler)](
+                        boost::system::error_code ec,
+                        std::size_t length) mutable {
+        handler(ec, length);
+        self->finishWrite_(ec);
+    });
+}
+
+void Connection::flushOutbound_() {
+    std::vector<OutboundItem> batch;
+    std::vector<net::const_buffer> buffers;
+    std::size_t size = 0;
+    bool zeroCopy = false;
+    {
+        std::lock_guard<std::mutex> lock(outboundMutex_);
+        auto budget = writeBatchSize.load(std::memory_order_relaxed);
+        /// the first item is written even if it exceeds the budget
+        while (!outbound_.empty() &&
+               (batch.empty() ||
+                (size + net::buffer_size(outbound_.front().buffers) <=
+                     budget &&
+                 buffers.size() + 3 <= kMaxWriteBuffers))) {
+            auto &item = outbound_.front();
+            size += net::buffer_size(item.buffers);
+            for (const auto &buffer : item.buffers) {
+                if (buffer.size() != 0) {
+                    buffers.push_back(buffer);
+                }
+            }
+            batch.push_back(std::move(item));
+            outbound_.pop_front();
+        }
+        auto threshold = zeroCopyThreshold.load(std::memory_order_relaxed);
+        zeroCopy = threshold != 0 && size >= threshold && useZeroCopy_();
+    }
+    getMetrics().writes.add();
+
+    auto self = shared_from_this();
+    auto onWritten = [self, batch = std::move(batch)](
+                         boost::system::error_code ec,
+                         std::size_t /* length */) {
+        for (const auto &item : batch) {
+            item.handler(ec, ec ? 0 : net::buffer_size(item.buffers));
+        }
+        self->finishWrite_(ec);
+    };
+    if (zeroCopy) {
+        sendZeroCopy_(std::move(buffers), 0, std::move(onWritten));
+    } else {
+        write_(buffers, std::move(onWritten));
+    }
+}
+
+void Connection::finishWrite_(boost::system::error_code ec) {
+    bool pending;
+    std::deque<OutboundItem> failed;
+    {
+        std::lock_guard<std::mutex> lock(outboundMutex_);
+        if (ec) {
+            failed.swap(outbound_);
+        }
+        pending = !outbound_.empty();
+        writing_ = pending;
+    }
+    for (const auto &item : failed) {
+        item.handler(ec, 0);
+    }
+    /// items queued during the write are gathered into the next one
+    if (pending) {
+        flushOutbound_();
+    }
+}
+
+bool Connection::useZeroCopy_() {
+    if (!socket_) {
+        return false;
+    }
+    if (!zeroCopyChecked_) {
+        zeroCopyChecked_ = true;
+        boost::system::error_code ec;
+        auto family = socket_->local_endpoint(ec).protocol().family();
+        zeroCopy_ = !ec && (family == AF_INET || family == AF_INET6) &&
+                    zerocopy::enable(socket_->native_handle());
+    }
+    return zeroCopy_;
+}
+
+void Connection::sendZeroCopy_(std::vector<net::const_buffer> buffers,
+                               std::size_t written, WriteHandler handler) {
+    auto self = shared_from_this();
+    socket_->async_send(
+        buffers, zerocopy::kSendFlag,
+        [self, buffers, written, handler = std::move(handler)](
+            boost::system::error_code ec, std::size_t length) mutable {
+            if (ec == net::error::no_buffer_space) {
+                /// out of memory for pinned pages, the rest is copied
+                net::async_write(
+                    *self->socket_, buffers,
+                    [self, written, handler = std::move(handler)](
+                        boost::system::error_code ec, std::size_t length) {
+                        if (ec) {
+                            handler(ec, written + length);
+                            return;
+                        }
+                        self->awaitZeroCopy_(written + length, handler);
+                    });
+                return;
+            }
+            if (ec) {
+                handler(ec, written);
+                return;
+            }
+            {
+                std::lock_guard<std::mutex> lock(self->outboundMutex_);
+                ++self->zeroCopySent_;
+            }
+            getMetrics().zeroCopySends.add();
+            written += length;
+            consumeBuffers(buffers, length);
+            if (buffers.empty()) {
+                self->awaitZeroCopy_(written, std::move(handler));
+            } else {
+                self->sendZeroCopy_(std::move(buffers), written,
+                                    std::move(handler));
+            }
+        });
+}
+
+void Connection::awaitZeroCopy_(std::size_t length, WriteHandler handler) {
+    bool wait;
+    {
+        std::lock_guard<std::mutex> lock(outboundMutex_);
+        zeroCopyDone_ = [handler = std::move(handler), length] {
+            handler({}, length);
+        };
+        wait = zeroCopyWaits_ == 0;
+        if (wait) {
+            ++zeroCopyWaits_;
+        }
+    }
+    /// wait is started before reading the queue, so no completion is missed
+    if (wait) {
+        waitZeroCopy_();
+    }
+    checkZeroCopy_();
+}
+
+void Connection::waitZeroCopy_() {
+    /// a wait left after the last completion must not keep the connection
+    std::weak_ptr<Connection> weak = shared_from_this();
+    socket_->async_wait(
+        net::socket_base::wait_error, [weak](boost::system::error_code ec) {
+            auto self = weak.lock();
+            if (!self) {
+                return;
+            }
+            bool wait;
+            {
+                std::lock_guard<std::mutex> lock(self->outboundMutex_);
+                --self->zeroCopyWaits_;
+                wait = !ec && self->zeroCopyDone_ && self->zeroCopyWaits_ == 0;
+                if (wait) {
+                    ++self->zeroCopyWaits_;
+                }
+            }
+            if (ec) {
+                return;
+            }
+            if (wait) {
+                self->waitZeroCopy_();
+            }
+            self->checkZeroCopy_();
+        });
+}
+
+void Connection::checkZeroCopy_() {
+    std::function<void()> done;
+    {
+        std::lock_guard<std::mutex> lock(outboundMutex_);
+        auto completions = zerocopy::readCompletions(socket_->native_handle());
+        zeroCopyCompleted_ += completions.count;
+        if (completions.copied && zeroCopy_) {
+            /// e.g. loopback, pinning pages costs more than copying them
+            LOG_INFO("Zerocopy sends are copied by kernel, disabled");
+            getMetrics().zeroCopyCopied.add();
+            zeroCopy_ = false;
+        }
+        if (zeroCopyDone_ && zeroCopyCompleted_ == zeroCopySent_) {
+            done.swap(zeroCopyDone_);
+        }
+    }
+    if (done) {
+        done();
     }
-    delete[] buffer_;
 }
 
 void Connection::start() {
-    waitingAccept_ = getBlock_ = false;
+    waitingAccept_ = false;
     readRequest_();
 }
 
-void Connection::sendEmergedMessage(const Message &message) {
-    response_.message = message;
+void Connection::sendEmergedMessage(Message message,
+                                    const std::string &topic,
+                                    std::optional<std::uint64_t> offset) {
+    response_.message = std::move(message);
     response_.type = ResponseType::GetSuccess;
+    response_.topic = topic;
+    response_.offset = offset;
     serializeResponse_();
 
     auto self = shared_from_this();
+    auto start = metrics::getNowNs();
 
-    socket_.async_write_some(
-        boost::asio::buffer(buffer_, bufSize_),
-        [self](boost::system::error_code ec, std::size_t len) {
+    /// message goes back to storage if it is not written
+    waitingAccept_ = true;
+    send_(
+        getResponseBuffers_(),
+        [self, start](boost::system::error_code ec, std::size_t len) {
             if (!ec) {
+                countWrite(start, len);
                 self->waitAccept_();
             }
         });
 }
 
-void Connection::deserializeRequest_() {
-    //    for (int i = 0; i < bufSize_; ++i) {
-    //        std::cout << std::hex << +buffer_[i] << " ";
-    //    }
-    //    std::cout << '\n';
-    //    std::cout << bufSize_ << '\n';
+void Connection::sendBroadcastMessage(
+    const std::vector<std::shared_ptr<Connection>> &subscribers,
+    const Message &message, const std::string &topic) {
+    Response response;
+    response.message = message;
+    response.type = ResponseType::GetSuccess;
+    response.topic = topic;
+    response.enqueueTime = getEnqueueTime(response.message);
+
+    auto frame = std::make_shared<const std::string>(encodeFrame(response));
+
+    for (const auto &subscriber : subscribers) {
+        HAVKA_PROBE3(waiter_wakeup, topic.c_str(), subscriber.get(),
+                     message.data.size());
+        subscriber->sendSharedResponse_(frame, topic);
+    }
+}
 
-    std::string buffer_str(buffer_, bufSize_);
-    std::stringstream iss(buffer_str);
-    cereal::BinaryInputArchive iarchive(iss);
-    iarchive(request_);
+void Connection::sendSharedResponse_(std::shared_ptr<const std::string> frame,
+                                     const std::string &topic) {
+    /// nothing to return to the storage if delivery is not confirmed
+    response_.message = std::nullopt;
+    response_.offset = std::nullopt;
+    response_.topic = topic;
+
+    auto self = shared_from_this();
+    auto start = metrics::getNowNs();
+    auto buffer = boost::asio::buffer(*frame);
+    send_(
+        {buffer},
+        [self, start, frame = std::move(frame)](boost::system::error_code ec,
+                                                std::size_t length) {
+            if (!ec) {
+                countWrite(start, length);
+                self->waitAccept_();
+            }
+        });
 }
 
-void Connection::serializeResponse_() {
-    std::stringstream oss;
-    {
-        cereal::BinaryOutputArchive oarchive(oss);
-        oarchive(response_);
+void Connection::readFrame_(std::function<void()> onFrame) {
+    if (bufSize_ != 0 || !socket_) {
+        readFrameBytes_(std::move(onFrame));
+        return;
     }
-    std::string toBuf = oss.str();
-    memcpy(buffer_, toBuf.c_str(), toBuf.length());
-    bufSize_ = toBuf.length();
+    /// under load the next request is often in the socket already, so it
+    /// is read at once and readiness is awaited only if there is nothing
+    buffer_.reserve(BufferPool::kMinSize);
+    boost::system::error_code ec;
+    auto length = socket_->read_some(
+        net::buffer(buffer_.data(), buffer_.capacity()), ec);
+    if (!ec) {
+        getMetrics().bytesReceived.add(length);
+        bufSize_ = length;
+        readFrameBytes_(std::move(onFrame));
+        return;
+    }
+    buffer_.release();
+    if (ec != net::error::would_block && ec != net::error::try_again) {
+        return;
+    }
+    auto self = shared_from_this();
+    socket_->async_wait(
+        stream_socket::wait_read,
+        [self, onFrame = std::move(onFrame)](boost::system::error_code ec) {
+            if (!ec) {
+                self->readFrameBytes_(onFrame);
+            }
+        });
 }
 
-void Connection::readRequest_() {
+void Connection::readFrameBytes_(std::function<void()> onFrame) {
     auto self = shared_from_this();
+    if (bufSize_ >= kFrameHeaderSize) {
+        auto bodySize = decodeFrameHeader(buffer_.data());
+        if (bodySize > maxMessageSize_) {
+            LOG_WARNING("Frame of " << bodySize
+                                    << " bytes is larger than maximum "
+                                    << maxMessageSize_ << ", closing");
+            return;
+        }
+        auto size = kFrameHeaderSize + bodySize;
+        if (bufSize_ >= size) {
+            frameSize_ = size;
+            onFrame();
+            return;
+        }
+        if (shm_) {
+            LOG_WARNING("Frame of shared memory transport is truncated");
+            return;
+        }
+        if (bodySize > streamThreshold.load(std::memory_order_relaxed)) {
+            auto headEnd = kFrameHeaderSize + getMessageHeadSize();
+            if (bufSize_ < headEnd) {
+                net::async_read(
+                    *socket_,
+                    net::buffer(buffer_.data() + bufSize_, headEnd - bufSize_),
+                    [self, onFrame = std::move(onFrame)](
+                        boost::system::error_code ec, std::size_t length) {
+                        if (!ec) {
+                            getMetrics().bytesReceived.add(length);
+                            self->bufSize_ += length;
+                            self->readFrameBytes_(onFrame);
+                        }
+                    });
+                return;
+            }
+            MessageDataType dataType;
+            std::size_t dataSize = 0;
+            /// requests without message are small, they are read whole
+            if (decodeHead(buffer_.data() + kFrameHeaderSize, dataType,
+                           dataSize)) {
+                streamFrame_(size, dataType, dataSize, std::move(onFrame));
+                return;
+            }
+        }
+        /// large frame grows the buffer only after its header is read
+        buffer_.reserve(size, bufSize_);
+        net::async_read(
+            *socket_,
+            net::buffer(buffer_.data() + bufSize_, size - bufSize_),
+            [self, size, onFrame = std::move(onFrame)](
+                boost::system::error_code ec, std::size_t length) {
+                if (!ec) {
+                    getMetrics().bytesReceived.add(length);
+                    self->bufSize_ += length;
+                    self->frameSize_ = size;
+                    onFrame();
+                }
+            });
+        return;
+    }
+    /// frames of shared memory transport are read whole
+    buffer_.reserve(shm_ ? shm_->getMaxFrameSize() : BufferPool::kMinSize,
+                    bufSize_);
+    readSome_(net::buffer(buffer_.data() + bufSize_,
+                          buffer_.capacity() - bufSize_),
+              [self, onFrame = std::move(onFrame)](
+                  boost::system::error_code ec, std::size_t length) {
+                  if (!ec) {
+                      getMetrics().bytesReceived.add(length);
+                      self->bufSize_ += length;
+                      self->readFrameBytes_(onFrame);
+                  }
+              });
+}
+
+void Connection::streamFrame_(std::size_t size, MessageDataType dataType,
+                              std::size_t dataSize,
+                              std::function<void()> onFrame) {
+    auto headEnd = kFrameHeaderSize + getMessageHeadSize();
+    if (dataSize > size - headEnd) {
+        LOG_WARNING("Message of " << dataSize << " bytes does not fit into "
+                                  << "frame of " << size << " bytes, closing");
+        return;
+    }
+    getMetrics().streamedRequests.add();
+    request_.message = Message();
+    request_.message->dataType = dataType;
+    /// bytes after the head are data, then tail
+    auto copied = std::min(bufSize_ - headEnd, dataSize);
+    request_.message->data.assign(buffer_.data() + headEnd, copied);
+    consumeBuffer_(headEnd + copied);
+    readData_(size, dataSize, std::move(onFrame));
+}
 
-    socket_.async_read_some(
-        boost::asio::buffer(buffer_, maxBufSize_),
-        [self](boost::system::error_code ec, std::size_t length) {
+void Connection::readData_(std::size_t size, std::size_t dataSize,
+                           std::function<void()> onFrame) {
+    auto &data = request_.message->data;
+    auto received = data.size();
+    if (received == dataSize) {
+        auto tailSize =
+            size - kFrameHeaderSize - getMessageHeadSize() - dataSize;
+        readTail_(size, tailSize, std::move(onFrame));
+        return;
+    }
+    /// data grows as it arrives, buffer is empty and given back meanwhile
+    data.resize(received + std::min(dataSize - received, kStreamChunkSize));
+    auto self = shared_from_this();
+    net::async_read(
+        *socket_, net::buffer(data.data() + received, data.size() - received),
+        [self, size, dataSize, onFrame = std::move(onFrame)](
+            boost::system::error_code ec, std::size_t length) {
             if (!ec) {
-                self->bufSize_ = length;
-                self->processRequest_();
+                getMetrics().bytesReceived.add(length);
+                self->readData_(size, dataSize, onFrame);
             }
         });
 }
 
+void Connection::readTail_(std::size_t size, std::size_t tailSize,
+                           std::function<void()> onFrame) {
+    if (bufSize_ >= tailSize) {
+        decodeTail(buffer_.data(), tailSize, request_);
+        consumeBuffer_(tailSize);
+        streamed_ = true;
+        frameSize_ = size;
+        onFrame();
+        return;
+    }
+    auto self = shared_from_this();
+    buffer_.reserve(tailSize, bufSize_);
+    net::async_read(
+        *socket_,
+        net::buffer(buffer_.data() + bufSize_, tailSize - bufSize_),
+        [self, size, tailSize, onFrame = std::move(onFrame)](
+            boost::system::error_code ec, std::size_t length) {
+            if (!ec) {
+                getMetrics().bytesReceived.add(length);
+                self->bufSize_ += length;
+                self->readTail_(size, tailSize, onFrame);
+            }
+        });
+}
+
+void Connection::consumeBuffer_(std::size_t size) {
+    /// bytes after them belong to the next frame
+    bufSize_ -= size;
+    if (bufSize_ != 0) {
+        std::memmove(buffer_.data(), buffer_.data() + size, bufSize_);
+    } else {
+        buffer_.release();
+    }
+}
+
+void Connection::deserializeRequest_() {
+    if (!streamed_) {
+        decode(buffer_.data() + kFrameHeaderSize,
+               frameSize_ - kFrameHeaderSize, request_);
+        consumeBuffer_(frameSize_);
+    }
+    streamed_ = false;
+    frameSize_ = 0;
+}
+
+void Connection::serializeResponse_() {
+    response_.enqueueTime = getEnqueueTime(response_.message);
+    encode(response_, responseHead_, responseTail_);
+    auto size = responseHead_.size() + responseTail_.size();
+    if (response_.message) {
+        size += response_.message->data.size();
+    }
+    responseHead_.insert(0, encodeFrameHeader(size));
+}
+
+std::array<net::const_buffer, 3> Connection::getResponseBuffers_() const {
+    net::const_buffer data;
+    if (response_.message) {
+        data = net::buffer(response_.message->data);
+    }
+    return {net::buffer(responseHead_), data, net::buffer(responseTail_)};
+}
+
+void Connection::readRequest_() {
+    auto self = shared_from_this();
+
+    readFrame_([self] {
+        self->trace_.received = metrics::getNowNs();
+        self->processRequest_();
+    });
+}
+
 void Connection::processRequest_() {
+    auto &connectionMetrics = getMetrics();
+
     /// deserialize request from buffer_ to request_
+    auto size = frameSize_;
     deserializeRequest_();
+    HAVKA_PROBE3(request_receive, static_cast<int>(request_.type),
+                 request_.topic.c_str(), size);
+    if (capture_) {
+        capture_->write(id_, request_);
+    }
+
+    trace_.type = request_.type;
+    trace_.decoded = metrics::getNowNs();
+    connectionMetrics.decodeLatency.record(trace_.decoded - trace_.received);
+    countRequest(request_.type);
 
     LOG_INFO("New request:\n"
              << "...... type: " << getStringFromRequestType(request_.type));
 
+    /// patterns are not owned by one shard, they are run on this thread
+    if (shards_ && !isTopicPattern(request_.topic)) {
+        shards_->dispatch(getTopicShard(request_.topic, shards_->size()),
+                          [self = shared_from_this()] {
+                              self->executeRequest_();
+                          });
+        return;
+    }
+    executeRequest_();
+}
+
+void Connection::executeRequest_() {
+    auto &connectionMetrics = getMetrics();
+    /// drop lock waits of work done by the thread between requests
+    trace::takeLockWait();
+
     if (request_.type == RequestType::PostMessageSafe) {
         createPostResponse_();
     } else if (request_.type == RequestType::GetMessageNonblocking ||
                request_.type == RequestType::GetMessageBlocking) {
-        createGetResponse_();
-        if (getBlock_) {
+        auto decoded = trace_.decoded;
+        if (createGetResponse_()) {
+            connectionMetrics.storageLatency.record(metrics::getNowNs() -
+                                                    decoded);
             LOG_INFO("Connection is blocked");
             return;
         }
+    } else if (request_.type == RequestType::SeekOffset) {
+        createSeekResponse_();
     } else {
         createFailureResponse_();
     }
+    trace_.processed = metrics::getNowNs();
+    trace_.lockWait = trace::takeLockWait();
+    connectionMetrics.storageLatency.record(trace_.processed - trace_.decoded);
+
     /// serialize response from response_ to buffer_
     serializeResponse_();
+    trace_.encoded = metrics::getNowNs();
+    connectionMetrics.encodeLatency.record(trace_.encoded - trace_.processed);
 
     writeResponse_();
 }
 
-void Connection::createGetResponse_() {
+bool Connection::createGetResponse_() {
+    DeliveryInfo info;
     if (request_.type == RequestType::GetMessageNonblocking) {
-        auto message = storage_->getMessageNonblocking(request_.topic);
+        auto message = storage_->getMessageNonblocking(request_.topic,
+                                                       request_.group, &info);
         if (message == std::nullopt) {
             response_.type = ResponseType::EmptyTopic;
         } else {
@@ -120,16 +826,33 @@ void Connection::createGetResponse_() {
         }
         response_.message = message;
     } else {  /// request_.type == RequestType::GetMessageBlocking
-        auto message =
-            storage_->getMessageBlocking(request_.topic, shared_from_this());
+        auto message = storage_->getMessageBlocking(
+            request_.topic, shared_from_this(), request_.group, &info);
         if (message == std::nullopt) {
             /// block
-            getBlock_ = true;
+            return true;
         } else {
             response_.message = message;
             response_.type = ResponseType::GetSuccess;
         }
     }
+    response_.topic = std::move(info.topic);
+    response_.offset = info.offset;
+    return false;
+}
+
+void Connection::createSeekResponse_() {
+    response_.message = std::nullopt;
+    response_.topic = request_.topic;
+    response_.offset = std::nullopt;
+    if (request_.offset == std::nullopt) {
+        createFailureResponse_();
+        return;
+    }
+    response_.offset =
+        storage_->seekLog(request_.topic, request_.group, *request_.offset);
+    response_.type = response_.offset ? ResponseType::SeekSuccess
+                                      : ResponseType::Error;
 }
 
 void Connection::createPostResponse_() {
@@ -138,10 +861,18 @@ void Connection::createPostResponse_() {
         LOG_INFO("Message in request is empty, shutdown connection??");
         return;
     }
-    storage_->postMessage(*request_.message, request_.topic);
+    response_.message = std::nullopt;
+    response_.topic = request_.topic;
+    response_.offset = std::nullopt;
+    if (isTopicPattern(request_.topic)) {
+        LOG_WARNING("Posting to wildcard pattern '" << request_.topic
+                                                    << "' is not allowed");
+        response_.type = ResponseType::ErrorWhilePosting;
+        return;
+    }
+    storage_->postMessage(std::move(*request_.message), request_.topic);
 
     response_.type = ResponseType::PostSuccess;
-    response_.message = std::nullopt;
 }
 
 void Connection::createFailureResponse_() {
@@ -151,31 +882,35 @@ void Connection::createFailureResponse_() {
 void Connection::writeResponse_() {
     auto self = shared_from_this();
 
-    auto loop_handler = [self](boost::system::error_code ec, std::size_t) {
+    auto loop_handler = [self](boost::system::error_code ec,
+                               std::size_t length) {
         if (!ec) {
+            self->finishTrace_(length);
             self->start();
         }
     };
 
-    auto accept_handler = [self](boost::system::error_code ec, std::size_t) {
+    auto accept_handler = [self](boost::system::error_code ec,
+                                 std::size_t length) {
         if (!ec) {
+            self->finishTrace_(length);
             self->waitAccept_();
         }
     };
 
-    if (request_.type == RequestType::PostMessageSafe) {
-        socket_.async_write_some(boost::asio::buffer(buffer_, bufSize_),
-                                 loop_handler);
+    if (request_.type == RequestType::PostMessageSafe ||
+        request_.type == RequestType::SeekOffset) {
+        send_(getResponseBuffers_(), loop_handler);
 
     } else if (response_.type == ResponseType::GetSuccess) {
-        socket_.async_write_some(boost::asio::buffer(buffer_, bufSize_),
-                                 accept_handler);
+        /// message goes back to storage if it is not written
+        waitingAccept_ = true;
+        send_(getResponseBuffers_(), accept_handler);
 
     } else if (request_.type == RequestType::GetMessageNonblocking) {
         /// and response_.type == ResponseType::EmptyTopic
 
-        socket_.async_write_some(boost::asio::buffer(buffer_, bufSize_),
-                                 loop_handler);
+        send_(getResponseBuffers_(), loop_handler);
 
     } else {  /// response type is "EmptyTopic" and
               /// request type is "GetMessageBlocking"
@@ -183,29 +918,41 @@ void Connection::writeResponse_() {
     }
 }
 
+void Connection::finishTrace_(std::size_t length) {
+    auto &connectionMetrics = getMetrics();
+    trace_.written = metrics::getNowNs();
+    connectionMetrics.writeLatency.record(trace_.written - trace_.encoded);
+    connectionMetrics.bytesSent.add(length);
+
+    if (trace::isEnabled()) {
+        connectionMetrics.lockWaitLatency.record(trace_.lockWait);
+        if (trace::shouldLog(trace_)) {
+            LOG_WARNING("Slow request: " << trace::format(trace_,
+                                                          request_.topic));
+        }
+    }
+}
+
 void Connection::waitAccept_() {
     auto self = shared_from_this();
 
     waitingAccept_ = true;
-    socket_.async_read_some(
-        boost::asio::buffer(buffer_, maxBufSize_),
-        [self](boost::system::error_code ec, std::size_t length) {
-            if (!ec) {
-                self->waitingAccept_ = false;
-                self->bufSize_ = length;
-                self->deserializeRequest_();
-                LOG_INFO("Accept:\n"
-                         << "...... "
-                         << getStringFromRequestType(self->request_.type)
-                         << '\n');
-
-                self->socket_.async_write_some(
-                    boost::asio::buffer(self->buffer_, 1),
+    readFrame_([self] {
+        self->waitingAccept_ = false;
+        self->deserializeRequest_();
+        HAVKA_PROBE2(ack_receive, self->response_.topic.c_str(), self.get());
+        countRequest(self->request_.type);
+        LOG_INFO("Accept:\n"
+                 << "...... " << getStringFromRequestType(self->request_.type)
+                 << '\n');
+
+        /// confirmation is answered with one byte, not with a frame
+        self->send_({boost::asio::buffer(&kAcceptReply, 1)},
                     [self](boost::system::error_code ec, std::size_t length) {
+                        getMetrics().bytesSent.add(length);
                         self->start();
                     });
-            }
-        });
+    });
 }
 
 }  // namespace havka
\ No newline at end of file
@@ -1,14 +1,25 @@
 #ifndef HAVKA_SRC_SERVER_NET_H_
 #define HAVKA_SRC_SERVER_NET_H_
 
+#include <array>
 #include <boost/asio.hpp>
 #include <boost/asio/thread_pool.hpp>
+#include <deque>
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <sstream>
+#include <vector>
 
+#include "buffer_pool.h"
+#include "codec.hpp"
 #include "message.hpp"
+#include "server/capture.h"
 #include "server/server_config.h"
+#include "server/shards.h"
+#include "server/shm.h"
 #include "server/storage.h"
+#include "server/trace.h"
 
 namespace havka {
 
@@ -18,6 +29,19 @@ namespace net = boost::asio;
 /// from <boost/asio/ip/tcp.hpp>
 using tcp = boost::asio::ip::tcp;
 
+/// from <boost/asio/local/stream_protocol.hpp>
+using local_stream = boost::asio::local::stream_protocol;
+
+/// Socket of any stream protocol, TCP or Unix domain
+using stream_socket = boost::asio::generic::stream_protocol::socket;
+
+/// Name of the reactor of sockets, see HAVKA_IO_URING in CMakeLists.txt
+#if defined(BOOST_ASIO_HAS_IO_URING) && defined(BOOST_ASIO_DISABLE_EPOLL)
+constexpr const char* kNetworkBackend = "io_uring";
+#else
+constexpr const char* kNetworkBackend = "epoll";
+#endif
+
 // Forward declaration. Defined in file src/server/storage.h
 class IMessageStorage;
 
@@ -31,13 +55,35 @@ class Connection : public std::enable_shared_from_this<Connection> {
 public:
     /**
      * Constructs new connection, gets socket and storage pointer from server
-     * @param socket Connection socket
+     * @param socket Connection socket (TCP or Unix domain)
+     * @param storage Pointer to message storage
+     * @param capture Writer of traffic capture (nullptr if capture is off)
+     * @param shards Executor of storage shards, requests are run on
+     * the owner of their topic (nullptr if storage is not sharded)
+     * @param maxMessageSize maximum size of request frame, connection is
+     * closed on larger frames
+     */
+    explicit Connection(stream_socket socket,
+                        std::shared_ptr<IMessageStorage> storage,
+                        std::shared_ptr<CaptureWriter> capture = nullptr,
+                        std::shared_ptr<ShardExecutor> shards = nullptr,
+                        std::size_t maxMessageSize = kMaxFrameSize);
+
+    /**
+     * Constructs new connection of shared memory transport
+     * @param stream Shared memory stream of client
      * @param storage Pointer to message storage
-     * @param maxBufferSize maximum of bytes to be sent and received at once
+     * @param capture Writer of traffic capture (nullptr if capture is off)
+     * @param shards Executor of storage shards (nullptr if storage is not
+     * sharded)
+     * @param maxMessageSize maximum size of request frame, frames are also
+     * limited by size of rings
      */
-    explicit Connection(tcp::socket socket,
+    explicit Connection(std::shared_ptr<ShmStream> stream,
                         std::shared_ptr<IMessageStorage> storage,
-                        std::size_t maxBufferSize = 65536);
+                        std::shared_ptr<CaptureWriter> capture = nullptr,
+                        std::shared_ptr<ShardExecutor> shards = nullptr,
+                        std::size_t maxMessageSize = kMaxFrameSize);
 
     /**
      * Destructs connection. If there was GET-request and client
@@ -54,24 +100,257 @@ public:
     /**
      * Function used from Storage, when there are waiting clients and
      * somebody posts message
+     * @param message posted message, moved into the response
+     * @param topic topic of posted message
+     * @param offset offset of message if topic is a log topic
+     */
+    void sendEmergedMessage(
+        Message message, const std::string& topic,
+        std::optional<std::uint64_t> offset = std::nullopt);
+
+    /**
+     * Function used from Storage to fan out message of broadcast topic.
+     * Response is serialized once and its buffer is shared between writes
+     * to all subscribers. Message is not returned to storage if some
+     * subscriber does not confirm delivery.
+     * @param subscribers waiting connections
+     * @param message posted message
+     * @param topic topic of posted message
+     */
+    static void sendBroadcastMessage(
+        const std::vector<std::shared_ptr<Connection>>& subscribers,
+        const Message& message, const std::string& topic);
+
+    /**
+     * Sets if responses with messages contain time when broker enqueued
+     * the message (Response::enqueueTime). Applies to all connections.
+     * @param returned true to return enqueue time
+     */
+    static void setEnqueueTimeReturned(bool returned);
+
+    /**
+     * Sets maximal number of bytes gathered into one write when a
+     * connection has several pending outbound items. An item larger than
+     * the budget is still written alone. Applies to all connections.
+     * @param size budget in bytes
+     */
+    static void setWriteBatchSize(std::size_t size);
+
+    /**
+     * Sets size of writes sent with MSG_ZEROCOPY on TCP connections.
+     * Applies to all connections.
+     * @param size writes of at least this number of bytes are sent without
+     * copying into the kernel, 0 disables zerocopy sends
+     */
+    static void setZeroCopyThreshold(std::size_t size);
+
+    /**
+     * Sets size of requests whose message data is read from socket
+     * straight into the message. Applies to all connections.
+     * @param size requests with larger frames are streamed, so buffer of
+     * connection does not grow to size of message
      */
-    void sendEmergedMessage(const Message& message);
+    static void setStreamThreshold(std::size_t size);
 
 private:
+    using WriteHandler =
+        std::function<void(boost::system::error_code, std::size_t)>;
+
+    /// Bytes waiting in outbound queue and callback on writing them
+    struct OutboundItem {
+        /// bytes of item, valid until handler is called
+        std::array<net::const_buffer, 3> buffers;
+        /// called with error and number of bytes of item
+        WriteHandler handler;
+    };
+
     std::shared_ptr<IMessageStorage> storage_;
-    tcp::socket socket_;
-    char* buffer_;
+    /// socket of connection (empty for shared memory connections)
+    std::optional<stream_socket> socket_;
+    /// shared memory transport of connection (nullptr for sockets)
+    std::shared_ptr<ShmStream> shm_;
+    /// received bytes, taken from pool only while a frame is read
+    PooledBuffer buffer_;
+    /// number of received bytes in buffer_
     std::size_t bufSize_;
-    std::size_t maxBufSize_;
+    /// size of received frame with header, 0 while it is read
+    std::size_t frameSize_;
+    /// request_ of received frame was decoded while it was read
+    bool streamed_;
+    std::size_t maxMessageSize_;
     Request request_;
     Response response_;
+    /// frame of response_ around data of its message, head starts with
+    /// frame header
+    std::string responseHead_;
+    std::string responseTail_;
+    /// message of response_ is being written or waits for accept, it is
+    /// returned to storage if connection is closed
     bool waitingAccept_;
-    bool getBlock_;
+    trace::RequestTrace trace_;
+    std::shared_ptr<CaptureWriter> capture_;
+    std::shared_ptr<ShardExecutor> shards_;
+    /// server-wide id of connection, used in traffic capture
+    std::uint64_t id_;
+    /// items are pushed by any thread which sends to the connection
+    std::mutex outboundMutex_;
+    std::deque<OutboundItem> outbound_;
+    /// gathered write of outbound items is in progress
+    bool writing_;
+    /// zerocopy sends were enabled on the socket (or it was tried)
+    bool zeroCopyChecked_;
+    bool zeroCopy_;
+    /// zerocopy sends made and completed by the kernel
+    std::uint32_t zeroCopySent_;
+    std::uint32_t zeroCopyCompleted_;
+    /// number of waits for completions in error queue of the socket
+    std::size_t zeroCopyWaits_;
+    /// finishes the write waiting for zerocopy completions
+    std::function<void()> zeroCopyDone_;
+
+    /**
+     * Reads bytes from transport of connection
+     * @param buffer buffer for bytes
+     * @param handler called with error and number of read bytes
+     */
+    template <typename Handler>
+    void readSome_(net::mutable_buffer buffer, Handler&& handler);
+
+    /**
+     * Writes all bytes to transport of connection
+     * @param buffers sequence of buffers with bytes to write
+     * @param handler called with error and number of written bytes
+     */
+    template <typename Buffers, typename Handler>
+    void write_(const Buffers& buffers, Handler&& handler);
+
+    /**
+     * Queues bytes for writing. If no write is in progress, writes them at
+     * once without queueing, otherwise they are gathered with other pending
+     * items into the next write when the current one completes.
+     * @param buffers bytes to write, must be valid until handler is called
+     * @param handler called with error and number of bytes of the item
+     */
+    template <typename Handler>
+    void send_(std::array<net::const_buffer, 3> buffers, Handler&& handler);
+
+    /**
+     * Writes pending outbound items (up to write batch size) with one
+     * gathered write and continues while the queue is not empty
+     */
+    void flushOutbound_();
+
+    /**
+     * Finishes write of outbound items: on error fails all pending items,
+     * otherwise flushes items queued during the write
+     * @param ec error of the write
+     */
+    void finishWrite_(boost::system::error_code ec);
+
+    /**
+     * Checks if writes can be sent with MSG_ZEROCOPY, enables zerocopy
+     * sends on the socket on the first call. Called with outboundMutex_
+     * @return true for TCP sockets which support it
+     */
+    bool useZeroCopy_();
+
+    /**
+     * Sends all bytes with MSG_ZEROCOPY. Handler is called when the kernel
+     * has released all pages of the buffers, so the connection keeps them
+     * unchanged until then.
+     * @param buffers bytes to send
+     * @param written number of bytes sent before
+     * @param handler called with error and number of sent bytes
+     */
+    void sendZeroCopy_(std::vector<net::const_buffer> buffers,
+                       std::size_t written, WriteHandler handler);
+
+    /**
+     * Calls handler when all zerocopy sends are completed
+     * @param length number of sent bytes
+     * @param handler called with number of sent bytes
+     */
+    void awaitZeroCopy_(std::size_t length, WriteHandler handler);
+
+    /**
+     * Waits for error queue of the socket, keeps the connection only weakly
+     */
+    void waitZeroCopy_();
+
+    /**
+     * Reads zerocopy completions and finishes the write waiting for them
+     */
+    void checkZeroCopy_();
 
+    /**
+     * Reads the next frame into buffer_. Socket connections try a
+     * non-blocking read first, if the socket is empty they give buffer
+     * back to pool and wait until the socket is readable.
+     * @param onFrame called when frameSize_ bytes of frame are in buffer_,
+     * not called on error or on frame larger than maxMessageSize_
+     */
+    void readFrame_(std::function<void()> onFrame);
+
+    /**
+     * Reads bytes of frame into buffer_ until the frame is complete
+     * @param onFrame called when frame is complete
+     */
+    void readFrameBytes_(std::function<void()> onFrame);
+
+    /**
+     * Reads data of message of frame straight into request_.message,
+     * then reads and decodes the rest of request. Head of frame is in
+     * buffer_.
+     * @param size size of frame with header
+     * @param dataType type of data of message
+     * @param dataSize size of data of message
+     * @param onFrame called when request_ is decoded
+     */
+    void streamFrame_(std::size_t size, MessageDataType dataType,
+                      std::size_t dataSize, std::function<void()> onFrame);
+
+    /**
+     * Reads data of streamed message into request_.message in chunks of
+     * kStreamChunkSize, then reads tail of the request
+     * @param size size of frame with header
+     * @param dataSize size of data of message declared in the head
+     * @param onFrame called when request_ is decoded
+     */
+    void readData_(std::size_t size, std::size_t dataSize,
+                   std::function<void()> onFrame);
+
+    /**
+     * Reads tail of streamed frame into buffer_ and decodes it to request_
+     * @param size size of frame with header
+     * @param tailSize size of tail
+     * @param onFrame called when request_ is decoded
+     */
+    void readTail_(std::size_t size, std::size_t tailSize,
+                   std::function<void()> onFrame);
+
+    /**
+     * Drops first bytes of buffer_, buffer is given back to pool if no
+     * more bytes are received
+     * @param size number of bytes
+     */
+    void consumeBuffer_(std::size_t size);
+
+    /**
+     * Decodes request from frame in buffer_ (streamed frame is already
+     * decoded) and drops the frame, buffer is given back to pool if no
+     * more bytes are received
+     */
     void deserializeRequest_();
 
     void serializeResponse_();
 
+    /**
+     * Returns frame of response_: head, data of message and tail, so
+     * the data is written from the message without copying
+     * @return buffers valid until response_ is changed
+     */
+    std::array<net::const_buffer, 3> getResponseBuffers_() const;
+
     /**
      * Creates callback on reading request
      */
@@ -82,11 +361,19 @@ private:
      */
     void processRequest_();
 
+    /**
+     * Runs storage operation of request and writes response.
+     * Called on the owner of request topic if storage is sharded.
+     */
+    void executeRequest_();
+
     /**
      * Creates response on GET-request (which gets message
      * from message storage with exact tag)
+     * @return true if connection waits for a message. Then it may be
+     * already woken up by another thread, so members must not be used.
      */
-    void createGetResponse_();
+    bool createGetResponse_();
 
     /**
      * Creates response on POST-request (which posts message
@@ -94,6 +381,12 @@ private:
      */
     void createPostResponse_();
 
+    /**
+     * Creates response on SeekOffset request (which sets offset of
+     * consumer group in log topic)
+     */
+    void createSeekResponse_();
+
     /**
      * Creates response on unknown request
      */
@@ -105,7 +398,23 @@ private:
      */
     void writeResponse_();
 
+    /**
+     * Records stages of request after response was written and
+     * logs it if it is slow
+     * @param length number of written bytes
+     */
+    void finishTrace_(std::size_t length);
+
     void waitAccept_();
+
+    /**
+     * Writes already serialized response shared with other connections,
+     * then waits for delivery confirmation
+     * @param frame serialized response
+     * @param topic topic of message in response
+     */
+    void sendSharedResponse_(std::shared_ptr<const std::string> frame,
+                             const std::string& topic);
 };
 
 }  // namespace havka
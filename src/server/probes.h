@@ -0,0 +1,48 @@
+#ifndef HAVKA_SRC_SERVER_PROBES_H_
+#define HAVKA_SRC_SERVER_PROBES_H_
+
+/// Static tracepoints (USDT) of the broker hot path
+/**
+ * Probes are compiled in if <sys/sdt.h> (systemtap-sdt-dev) is available.
+ * A probe which is not attached is a single nop instruction, its arguments
+ * are only prepared in registers. Probes belong to provider "havka" and can
+ * be listed with `bpftrace -l 'usdt:./server:havka:*'`, see tools/bpftrace.
+ * Without <sys/sdt.h> probes and their arguments are compiled out.
+ *
+ * Probes and arguments:
+ *  - request_receive(type, topic, bytes)
+ *  - enqueue(topic, bytes)
+ *  - dequeue(topic, bytes, enqueue time in nanoseconds of CLOCK_MONOTONIC,
+ *    the same clock as bpftrace nsecs, so queue time is computed by the
+ *    tracer and the probe does not read the clock)
+ *  - waiter_register(topic, connection)
+ *  - waiter_wakeup(topic, connection, bytes)
+ *  - ack_receive(topic, connection)
+ * Topics are passed as C strings, connection is an address of Connection.
+ */
+
+#if defined(__has_include)
+#if __has_include(<sys/sdt.h>) && !defined(HAVKA_NO_USDT)
+#define HAVKA_HAS_USDT 1
+#endif
+#endif
+
+#ifdef HAVKA_HAS_USDT
+
+#include <sys/sdt.h>
+
+#define HAVKA_PROBE2(name, a1, a2) DTRACE_PROBE2(havka, name, a1, a2)
+#define HAVKA_PROBE3(name, a1, a2, a3) DTRACE_PROBE3(havka, name, a1, a2, a3)
+
+#else
+
+#define HAVKA_PROBE2(name, a1, a2) \
+    do {                           \
+    } while (0)
+#define HAVKA_PROBE3(name, a1, a2, a3) \
+    do {                               \
+    } while (0)
+
+#endif
+
+#endif  // HAVKA_SRC_SERVER_PROBES_H_
@@ -10,31 +10,62 @@ namespace havka {
 
 template <typename T>
 unsigned long MutexQueue<T>::size() const {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::lock_guard<ProfiledMutex> lock(mutex_);
     return queue_.size();
 }
 
 template <typename T>
 std::optional<T> MutexQueue<T>::pop() {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::lock_guard<ProfiledMutex> lock(mutex_);
     if (queue_.empty()) {
         return std::nullopt;
     }
-    T tmp = queue_.front();
+    T tmp = std::move(queue_.front());
     queue_.pop();
     return tmp;
 }
 
 template <typename T>
 void MutexQueue<T>::push(const T& item) {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::lock_guard<ProfiledMutex> lock(mutex_);
     queue_.push(item);
 }
 
+template <typename T>
+void MutexQueue<T>::push(T&& item) {
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    queue_.push(std::move(item));
+}
+
+template <typename T>
+bool MutexQueue<T>::visitFront(
+    const std::function<void(const T&)>& visitor) const {
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    if (queue_.empty()) {
+        return false;
+    }
+    visitor(queue_.front());
+    return true;
+}
+
+template <typename T>
+std::vector<T> MutexQueue<T>::snapshot() const {
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    /// std::queue does not expose iterators, copy and drain the copy
+    std::queue<T> copy = queue_;
+    std::vector<T> items;
+    items.reserve(copy.size());
+    while (!copy.empty()) {
+        items.push_back(std::move(copy.front()));
+        copy.pop();
+    }
+    return items;
+}
+
 std::shared_ptr<IQueue<Message>> createMessageQueue(QueueType queueType) {
     switch (queueType) {
         case QueueType::MutexQueue: {
-            return std::make_shared<MutexQueue<Message>>();
+            return std::make_shared<MutexQueue<Message>>("message_queue");
         }
     }
 }
@@ -43,7 +74,8 @@ std::shared_ptr<IQueue<std::shared_ptr<Connection>>> createConnectionQueue(
     QueueType queueType) {
     switch (queueType) {
         case QueueType::MutexQueue: {
-            return std::make_shared<MutexQueue<std::shared_ptr<Connection>>>();
+            return std::make_shared<MutexQueue<std::shared_ptr<Connection>>>(
+                "waiting_queue");
         }
     }
 }
@@ -55,23 +87,45 @@ std::shared_ptr<IQueue<std::shared_ptr<Connection>>> createConnectionQueue(
 template unsigned long MutexQueue<std::string>::size() const;
 template std::optional<std::string> MutexQueue<std::string>::pop();
 template void MutexQueue<std::string>::push(const std::string&);
+template void MutexQueue<std::string>::push(std::string&&);
+template bool MutexQueue<std::string>::visitFront(
+    const std::function<void(const std::string&)>&) const;
+template std::vector<std::string> MutexQueue<std::string>::snapshot() const;
 
 template unsigned long MutexQueue<int>::size() const;
 template std::optional<int> MutexQueue<int>::pop();
 template void MutexQueue<int>::push(const int&);
+template void MutexQueue<int>::push(int&&);
+template bool MutexQueue<int>::visitFront(
+    const std::function<void(const int&)>&) const;
+template std::vector<int> MutexQueue<int>::snapshot() const;
 
 template unsigned long MutexQueue<double>::size() const;
 template std::optional<double> MutexQueue<double>::pop();
 template void MutexQueue<double>::push(const double&);
+template void MutexQueue<double>::push(double&&);
+template bool MutexQueue<double>::visitFront(
+    const std::function<void(const double&)>&) const;
+template std::vector<double> MutexQueue<double>::snapshot() const;
 
 template unsigned long MutexQueue<Message>::size() const;
 template std::optional<Message> MutexQueue<Message>::pop();
 template void MutexQueue<Message>::push(const Message&);
+template void MutexQueue<Message>::push(Message&&);
+template bool MutexQueue<Message>::visitFront(
+    const std::function<void(const Message&)>&) const;
+template std::vector<Message> MutexQueue<Message>::snapshot() const;
 
 template unsigned long MutexQueue<std::shared_ptr<Connection>>::size() const;
 template std::optional<std::shared_ptr<Connection>>
 MutexQueue<std::shared_ptr<Connection>>::pop();
 template void MutexQueue<std::shared_ptr<Connection>>::push(
     const std::shared_ptr<Connection>&);
+template void MutexQueue<std::shared_ptr<Connection>>::push(
+    std::shared_ptr<Connection>&&);
+template bool MutexQueue<std::shared_ptr<Connection>>::visitFront(
+    const std::function<void(const std::shared_ptr<Connection>&)>&) const;
+template std::vector<std::shared_ptr<Connection>>
+MutexQueue<std::shared_ptr<Connection>>::snapshot() const;
 
 }  // namespace havka
\ No newline at end of file
@@ -1,14 +1,17 @@
 #ifndef HAVKA_SRC_SERVER_QUEUE_H_
 #define HAVKA_SRC_SERVER_QUEUE_H_
 
+#include <functional>
 #include <iostream>
 #include <memory>
 #include <mutex>
 #include <optional>
 #include <queue>
+#include <vector>
 
 #include "message.hpp"
 #include "net.h"
+#include "profiled_mutex.h"
 #include "types.hpp"
 
 namespace havka {
@@ -48,6 +51,27 @@ public:
      * @param item Element to push to the queue
      */
     virtual void push(const T& item) = 0;
+
+    /**
+     * Pushes new element to the queue without copying it.
+     * @param item Element to push to the queue
+     */
+    virtual void push(T&& item) = 0;
+
+    /**
+     * Calls visitor with first element of the queue without copying or
+     * removing it
+     * @param visitor function called under the queue lock
+     * @return true if queue is not empty and visitor was called
+     */
+    virtual bool visitFront(
+        const std::function<void(const T&)>& visitor) const = 0;
+
+    /**
+     * Copies all elements of the queue without removing them.
+     * @return Elements in queue order
+     */
+    virtual std::vector<T> snapshot() const = 0;
 };
 
 /// Implementation of queue interface with mutex. Thread-safe.
@@ -59,7 +83,12 @@ public:
 template <typename T>
 class MutexQueue : public IQueue<T> {
 public:
-    MutexQueue() = default;
+    /**
+     * Creates empty queue
+     * @param lockSite name of lock site for lock profiling
+     */
+    explicit MutexQueue(const char* lockSite = "queue")
+        : mutex_(lockSite) {}
     MutexQueue(const MutexQueue<T>&) = delete;
     MutexQueue& operator=(const MutexQueue<T>&) = delete;
 
@@ -84,9 +113,31 @@ public:
      */
     void push(const T& item) override;
 
+    /**
+     * Pushes new element to the queue without copying it.
+     * @param item Element to push to the queue
+     */
+    void push(T&& item) override;
+
+    /**
+     * Calls visitor with first element of the queue without copying or
+     * removing it
+     * @param visitor function called under the queue lock
+     * @return true if queue is not empty and visitor was called
+     */
+    bool visitFront(
+        const std::function<void(const T&)>& visitor) const override;
+
+    /**
+     * Copies all elements of the queue without removing them.
+     * Holds the lock only for copying.
+     * @return Elements in queue order
+     */
+    std::vector<T> snapshot() const override;
+
 private:
     std::queue<T> queue_;
-    mutable std::mutex mutex_;
+    mutable ProfiledMutex mutex_;
 };
 
 /**
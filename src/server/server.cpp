@@ -4,11 +4,36 @@
 
 #include "server/server.h"
 
+#include <pthread.h>
+#include <sched.h>
+
+#include <cstdio>
+
 #include "server/storage.h"
+#include "server/trace.h"
 #include "types.hpp"
 #include "util.h"
 
 namespace havka {
+
+namespace {
+
+/// SO_REUSEPORT option, Asio does not have it
+using reuse_port =
+    net::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>;
+
+/// Opens acceptor which shares endpoint with other acceptors
+void openReusePortAcceptor(tcp::acceptor& acceptor,
+                           const tcp::endpoint& endpoint) {
+    acceptor.open(endpoint.protocol());
+    acceptor.set_option(tcp::acceptor::reuse_address(true));
+    acceptor.set_option(reuse_port(true));
+    acceptor.bind(endpoint);
+    acceptor.listen();
+}
+
+}  // namespace
+
 BrokerServer::BrokerServer(const net::ip::address& address, unsigned short port,
                            StorageType storageType, QueueType queueType,
                            int threads, int secondsTimeout)
@@ -20,12 +45,19 @@ BrokerServer::BrokerServer(const net::ip::address& address, unsigned short port,
       acceptor_(*ioc_, endpoint_),
       socket_(*ioc_),
       deadline_(socket_.get_executor(), std::chrono::seconds(secondsTimeout)),
-      hasTimeout_(secondsTimeout > 0) {
+      hasTimeout_(secondsTimeout > 0),
+      snapshotInterval_(-1),
+      stopped_(false),
+      topicIdleTimeout_(-1),
+      gcTimer_(*ioc_),
+      nextLocalContext_(0),
+      maxMessageSize_(kMaxFrameSize) {
     LOG_INFO("Endpoint address: " << address);
     LOG_INFO("Endpoint port: " << port);
     LOG_INFO("Storage type: " << getStringFromStorageType(storageType));
     LOG_INFO("Queue type: " << getStringFromQueueType(queueType));
     LOG_INFO("Threads: " << threadsNum_);
+    LOG_INFO("Network backend: " << kNetworkBackend);
     if (hasTimeout_) {
         LOG_INFO("Timeout: " << secondsTimeout << " seconds");
     } else {
@@ -33,10 +65,139 @@ BrokerServer::BrokerServer(const net::ip::address& address, unsigned short port,
     }
 }
 
+BrokerServer::BrokerServer(const ServerConfig& config)
+    : BrokerServer(config.getAddress(), config.getPort(),
+                   config.getStorageType(), config.getQueueType(),
+                   config.getThreadsNumber(), config.getTimeout()) {
+    LOG_INFO("Log level: " << getStringFromLogLevel(config.getLogLevel()));
+    if (config.getLogRateLimit() > 0) {
+        LOG_INFO("Log rate limit: " << config.getLogRateLimit()
+                                    << " lines per second");
+    }
+    log::setLevel(config.getLogLevel());
+    log::setRateLimit(config.getLogRateLimit());
+
+    if (config.isRequestTracing()) {
+        LOG_INFO("Request tracing: enabled");
+        if (config.getSlowRequestThreshold() >= 0) {
+            LOG_INFO("Slow request threshold: "
+                     << config.getSlowRequestThreshold() << " us, every "
+                     << config.getSlowRequestSample()
+                     << " slow request is logged");
+        }
+    }
+    trace::setEnabled(config.isRequestTracing());
+    trace::setSlowRequestLog(
+        std::chrono::microseconds(config.getSlowRequestThreshold()),
+        config.getSlowRequestSample());
+
+    cpuAffinity_ = config.getCpuAffinity();
+    if (!cpuAffinity_.empty()) {
+        std::ostringstream cpus;
+        for (auto cpu : cpuAffinity_) {
+            cpus << ' ' << cpu;
+        }
+        LOG_INFO("CPU affinity:" << cpus.str());
+    }
+    if (config.isThreadPerCore()) {
+        LOG_INFO("Thread per core: enabled");
+        createWorkers_();
+    }
+    if (config.isShardPerCore()) {
+        LOG_INFO("Shard per core: enabled");
+        storage_ = createMessageStorage(config.getStorageType(),
+                                        config.getQueueType(), threadsNum_);
+        std::vector<net::io_context*> contexts = {ioc_.get()};
+        for (auto& worker : workers_) {
+            contexts.push_back(&worker->ioc);
+        }
+        shards_ = std::make_shared<ShardExecutor>(std::move(contexts));
+    }
+
+    storage_->setLogRetention(config.getLogRetention());
+
+    snapshotPath_ = config.getSnapshotPath();
+    snapshotInterval_ = std::chrono::seconds(config.getSnapshotInterval());
+    if (!snapshotPath_.empty()) {
+        LOG_INFO("Snapshot path: " << snapshotPath_);
+        if (IsFileExisting(snapshotPath_) &&
+            !storage_->loadSnapshot(snapshotPath_, threadsNum_)) {
+            LOG_ERROR("Snapshot '" << snapshotPath_
+                                   << "' was not loaded completely");
+        }
+    }
+    topicIdleTimeout_ = std::chrono::seconds(config.getTopicIdleTimeout());
+    if (topicIdleTimeout_.count() > 0) {
+        LOG_INFO("Topic idle timeout: " << topicIdleTimeout_.count()
+                                        << " seconds");
+    }
+    if (config.getMetricsPort() > 0) {
+        LOG_INFO("Metrics port: " << config.getMetricsPort());
+        metricsServer_ = std::make_unique<MetricsServer>(
+            *ioc_,
+            tcp::endpoint(config.getAddress(),
+                          static_cast<unsigned short>(config.getMetricsPort())),
+            storage_);
+    }
+    unixSocketPath_ = config.getUnixSocketPath();
+    if (!unixSocketPath_.empty()) {
+        LOG_INFO("Unix socket: " << unixSocketPath_);
+        /// socket file of a previous run would make bind fail
+        std::remove(unixSocketPath_.c_str());
+        localAcceptor_ = std::make_unique<local_stream::acceptor>(
+            *ioc_, local_stream::endpoint(unixSocketPath_));
+    }
+    if (config.isEnqueueTimeReturned()) {
+        LOG_INFO("Enqueue time is returned to consumers");
+    }
+    Connection::setEnqueueTimeReturned(config.isEnqueueTimeReturned());
+    LOG_INFO("Write batch size: " << config.getWriteBatchSize());
+    Connection::setWriteBatchSize(config.getWriteBatchSize());
+    if (config.getZeroCopyThreshold() > 0) {
+        LOG_INFO("Zerocopy threshold: " << config.getZeroCopyThreshold());
+    }
+    Connection::setZeroCopyThreshold(config.getZeroCopyThreshold());
+    maxMessageSize_ = config.getMaxMessageSize();
+    LOG_INFO("Max message size: " << maxMessageSize_);
+    LOG_INFO("Stream threshold: " << config.getStreamThreshold());
+    Connection::setStreamThreshold(config.getStreamThreshold());
+    if (!config.getCapturePath().empty()) {
+        LOG_INFO("Traffic capture: " << config.getCapturePath());
+        capture_ = std::make_shared<CaptureWriter>(config.getCapturePath());
+        if (!capture_->good()) {
+            capture_.reset();
+        }
+    }
+    if (!config.getShmSocketPath().empty()) {
+        LOG_INFO("Shared memory socket: " << config.getShmSocketPath());
+        LOG_INFO("Shared memory ring size: " << config.getShmRingSize());
+        shmServer_ = std::make_unique<ShmServer>(
+            *ioc_, config.getShmSocketPath(), config.getShmRingSize(),
+            storage_, capture_, shards_, maxMessageSize_);
+    }
+    for (const auto& [pattern, mode] : config.getTopicModes()) {
+        LOG_INFO("Topic mode: '" << pattern << "' -> "
+                                 << getStringFromTopicMode(mode));
+        storage_->setTopicMode(pattern, mode);
+    }
+}
+
 BrokerServer::~BrokerServer() {
     for (auto& thread : threads_) {
         thread.join();
     }
+    {
+        std::lock_guard<std::mutex> lock(stopMutex_);
+        stopped_ = true;
+    }
+    stopCondition_.notify_all();
+    if (snapshotThread_.joinable()) {
+        snapshotThread_.join();
+    }
+    if (localAcceptor_) {
+        localAcceptor_->close();
+        std::remove(unixSocketPath_.c_str());
+    }
 }
 
 void BrokerServer::run() {
@@ -44,25 +205,105 @@ void BrokerServer::run() {
         waitDeadline_();
     }
     waitSignal_();
-    acceptLoop_();
+    acceptLoop_(acceptor_, socket_);
+    for (auto& worker : workers_) {
+        acceptLoop_(worker->acceptor, worker->socket);
+    }
+    if (localAcceptor_) {
+        acceptLocalLoop_();
+    }
+    if (shmServer_) {
+        shmServer_->start();
+    }
+    if (metricsServer_) {
+        metricsServer_->start();
+    }
+    runSnapshots_();
+    collectGarbageLoop_();
 
     threads_.reserve(threadsNum_ - 1);
-    for (int i = 0; i < threadsNum_ - 1; ++i) {
-        threads_.emplace_back([this] { ioc_->run(); });
+    for (unsigned int i = 0; i + 1 < threadsNum_; ++i) {
+        auto& ioc = workers_.empty() ? *ioc_ : workers_[i]->ioc;
+        threads_.emplace_back([this, &ioc, i] {
+            pinThread_(i + 1);
+            ShardExecutor::bindThread(i + 1);
+            ioc.run();
+        });
     }
     LOG_INFO("Server is working...\n");
+    pinThread_(0);
+    ShardExecutor::bindThread(0);
     ioc_->run();
+    ShardExecutor::bindThread(ShardExecutor::kNoShard);
+
+    /// requests handled by io threads until they stop get into snapshot
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+    threads_.clear();
+    if (!snapshotPath_.empty()) {
+        storage_->saveSnapshot(snapshotPath_);
+    }
+    if (capture_) {
+        capture_->flush();
+    }
 }
 
-void BrokerServer::acceptLoop_() {
-    acceptor_.async_accept(socket_, [&](boost::system::error_code ec) {
+void BrokerServer::acceptLoop_(tcp::acceptor& acceptor, tcp::socket& socket) {
+    /// acceptor and socket are members, they outlive the callback
+    acceptor.async_accept(socket, [this, acceptor = &acceptor,
+                                   socket = &socket](
+                                      boost::system::error_code ec) {
         if (!ec) {
-            std::make_shared<Connection>(std::move(socket_), storage_)->start();
+            std::make_shared<Connection>(std::move(*socket), storage_,
+                                         capture_, shards_, maxMessageSize_)
+                ->start();
         }
-        acceptLoop_();
+        acceptLoop_(*acceptor, *socket);
     });
 }
 
+void BrokerServer::acceptLocalLoop_() {
+    auto index = nextLocalContext_++ % (workers_.size() + 1);
+    auto& ioc = index == 0 ? *ioc_ : workers_[index - 1]->ioc;
+    localAcceptor_->async_accept(
+        ioc, [this](boost::system::error_code ec,
+                    local_stream::socket socket) {
+            if (!ec) {
+                std::make_shared<Connection>(std::move(socket), storage_,
+                                             capture_, shards_,
+                                             maxMessageSize_)
+                    ->start();
+            }
+            acceptLocalLoop_();
+        });
+}
+
+void BrokerServer::createWorkers_() {
+    /// listening socket must have SO_REUSEPORT before bind, port 0 is
+    /// resolved by the first bind and shared by all acceptors
+    endpoint_ = acceptor_.local_endpoint();
+    acceptor_.close();
+    openReusePortAcceptor(acceptor_, endpoint_);
+    for (unsigned int i = 0; i + 1 < threadsNum_; ++i) {
+        workers_.push_back(std::make_unique<Worker>());
+        openReusePortAcceptor(workers_.back()->acceptor, endpoint_);
+    }
+}
+
+void BrokerServer::pinThread_(unsigned int index) {
+    if (cpuAffinity_.empty()) {
+        return;
+    }
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpuAffinity_[index % cpuAffinity_.size()], &cpus);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) != 0) {
+        LOG_WARNING("Thread " << index << " can not be pinned to CPU "
+                              << cpuAffinity_[index % cpuAffinity_.size()]);
+    }
+}
+
 void BrokerServer::waitSignal_() {
     signals_.add(SIGINT);
     signals_.add(SIGTERM);
@@ -70,7 +311,7 @@ void BrokerServer::waitSignal_() {
         [this](boost::system::error_code /* ec */, int /* signo */) {
             LOG_INFO("Stop-signal has been caught");
             LOG_INFO("Stopping server...");
-            ioc_->stop();
+            stop_();
         });
 }
 
@@ -78,8 +319,55 @@ void BrokerServer::waitDeadline_() {
     deadline_.async_wait([this](boost::system::error_code /* ec */) {
         LOG_INFO("Deadline has been expired");
         LOG_INFO("Stopping server...");
-        ioc_->stop();
+        stop_();
+    });
+}
+
+void BrokerServer::runSnapshots_() {
+    if (snapshotPath_.empty() || snapshotInterval_.count() <= 0) {
+        return;
+    }
+    snapshotThread_ = std::thread([this] {
+        std::unique_lock<std::mutex> lock(stopMutex_);
+        while (!stopCondition_.wait_for(lock, snapshotInterval_,
+                                        [this] { return stopped_; })) {
+            lock.unlock();
+            storage_->saveSnapshot(snapshotPath_);
+            lock.lock();
+        }
+    });
+}
+
+void BrokerServer::collectGarbageLoop_() {
+    if (topicIdleTimeout_.count() <= 0) {
+        return;
+    }
+    gcTimer_.expires_after(topicIdleTimeout_);
+    gcTimer_.async_wait([this](boost::system::error_code ec) {
+        if (ec) {
+            return;
+        }
+        storage_->collectGarbage();
+        collectGarbageLoop_();
     });
 }
 
+void BrokerServer::stop_() {
+    {
+        std::lock_guard<std::mutex> lock(stopMutex_);
+        if (stopped_) {
+            return;
+        }
+        stopped_ = true;
+    }
+    stopCondition_.notify_all();
+    if (shmServer_) {
+        shmServer_->stop();
+    }
+    for (auto& worker : workers_) {
+        worker->ioc.stop();
+    }
+    ioc_->stop();
+}
+
 }  // namespace havka
\ No newline at end of file
@@ -1,8 +1,12 @@
 #ifndef HAVKA_SRC_SERVER_HAVKA_H_
 #define HAVKA_SRC_SERVER_HAVKA_H_
 
+#include <condition_variable>
+#include <mutex>
 #include <string>
+#include <thread>
 
+#include "server/metrics_server.h"
 #include "server/net.h"
 #include "server/server_config.h"
 
@@ -42,6 +46,15 @@ public:
                           StorageType storageType, QueueType queueType,
                           int threads = -1, int secondsTimeout = -1);
 
+    /**
+     * Constructor of BrokerServer instance from server configuration.
+     * Initializes storage and contexts (one per thread in thread-per-core
+     * mode), applies topic modes, loads storage snapshot if it is
+     * configured and exists.
+     * @param config Server configuration
+     */
+    explicit BrokerServer(const ServerConfig& config);
+
     /**
      * Destructor of BrokerServer.
      * Joins threads.
@@ -51,7 +64,8 @@ public:
     /**
      * Creates callbacks on deadline or signal to stop server,
      * creates callback on new client connection and runs threads.
-     * Blocks until server will stop.
+     * Blocks until server will stop. Shutdown snapshot is written after
+     * all io threads have stopped.
      * Blocking
      */
     void run();
@@ -64,6 +78,23 @@ private:
 
     std::shared_ptr<net::io_context> ioc_;
 
+    /// Context with its own acceptor, run by one thread in
+    /// thread-per-core mode
+    struct Worker {
+        net::io_context ioc{1};
+        tcp::acceptor acceptor{ioc};
+        tcp::socket socket{ioc};
+    };
+
+    /// Contexts of threads except the one which runs ioc_
+    /// (empty if thread-per-core mode is disabled)
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::vector<int> cpuAffinity_;
+
+    /// Executor of storage shards, one per thread
+    /// (nullptr if shard-per-core mode is disabled)
+    std::shared_ptr<ShardExecutor> shards_;
+
     net::signal_set signals_;
     tcp::endpoint endpoint_;
     tcp::acceptor acceptor_;
@@ -71,12 +102,63 @@ private:
     net::steady_timer deadline_;
     bool hasTimeout_;
 
+    std::string snapshotPath_;
+    std::chrono::seconds snapshotInterval_;
+    std::thread snapshotThread_;
+    std::mutex stopMutex_;
+    std::condition_variable stopCondition_;
+    bool stopped_;
+
+    std::chrono::seconds topicIdleTimeout_;
+    net::steady_timer gcTimer_;
+
+    std::unique_ptr<MetricsServer> metricsServer_;
+
+    std::shared_ptr<CaptureWriter> capture_;
+
+    /// Listener of Unix domain socket (nullptr if it is not configured)
+    std::unique_ptr<local_stream::acceptor> localAcceptor_;
+    std::string unixSocketPath_;
+    /// Index of context which gets the next local connection
+    std::size_t nextLocalContext_;
+    /// Connections of sockets are closed on larger requests
+    std::size_t maxMessageSize_;
+
+    /// Listener of shared memory transport (nullptr if it is disabled)
+    std::unique_ptr<ShmServer> shmServer_;
+
     /**
      * Creates callback on new connection which processes it and
      * creates new callback on new client connection.
      * Non-blocking
+     * @param acceptor acceptor to accept connections from
+     * @param socket socket for new connection, belongs to context
+     * of acceptor
+     */
+    void acceptLoop_(tcp::acceptor& acceptor, tcp::socket& socket);
+
+    /**
+     * Creates callback on new connection to Unix domain socket. In
+     * thread-per-core mode connections are spread between contexts of
+     * threads round-robin, because there is no SO_REUSEPORT balancing
+     * for Unix domain sockets.
+     * Non-blocking
      */
-    void acceptLoop_();
+    void acceptLocalLoop_();
+
+    /**
+     * Reopens acceptor_ with SO_REUSEPORT and creates threadsNum_ - 1
+     * workers with their own acceptors listening on the same endpoint,
+     * so the kernel balances connections between threads.
+     */
+    void createWorkers_();
+
+    /**
+     * Pins calling thread to CPU of thread with given index
+     * if CPU affinity is configured
+     * @param index index of server thread
+     */
+    void pinThread_(unsigned int index);
 
     /**
      * Creates callback on signals SIGINT and SIGTERM to correct
@@ -91,6 +173,25 @@ private:
      * Non-blocking
      */
     void waitDeadline_();
+
+    /**
+     * Writes storage snapshots every snapshotInterval_ in a separate
+     * thread until server stops, so io threads keep serving traffic.
+     * Non-blocking
+     */
+    void runSnapshots_();
+
+    /**
+     * Creates callback which erases idle topics of storage every
+     * topicIdleTimeout_ if it is set.
+     * Non-blocking
+     */
+    void collectGarbageLoop_();
+
+    /**
+     * Writes final storage snapshot if it is configured and stops server.
+     */
+    void stop_();
 };
 
 }  // namespace havka
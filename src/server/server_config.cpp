@@ -2,6 +2,7 @@
 
 #include <yaml-cpp/yaml.h>
 
+#include "codec.hpp"
 #include "util.h"
 
 namespace havka {
@@ -49,6 +50,23 @@ ServerConfig::ServerConfig(const std::string &config_path) {
         threadsNumber_ = config["threads"].as<int>();
     }
 
+    if (!config["thread_per_core"]) {
+        threadPerCore_ = false;
+    } else {
+        threadPerCore_ = config["thread_per_core"].as<bool>();
+    }
+    if (!config["shard_per_core"]) {
+        shardPerCore_ = false;
+    } else {
+        shardPerCore_ = config["shard_per_core"].as<bool>();
+    }
+    if (config["cpu_affinity"]) {
+        if (!config["cpu_affinity"].IsSequence()) {
+            LOG_FATAL("ServerConfig cpu_affinity is not a list");
+        }
+        cpuAffinity_ = config["cpu_affinity"].as<std::vector<int>>();
+    }
+
     if (!config["timeout"]) {
         LOG_INFO(
             "There is no information about timeout "
@@ -58,6 +76,133 @@ ServerConfig::ServerConfig(const std::string &config_path) {
         secondsTimeout_ = config["timeout"].as<int>();
     }
 
+    if (config["topic_modes"]) {
+        if (!config["topic_modes"].IsMap()) {
+            LOG_FATAL("ServerConfig topic_modes is not a map");
+        }
+        for (const auto &topicMode : config["topic_modes"]) {
+            topicModes_.emplace_back(
+                topicMode.first.as<std::string>(),
+                getTopicModeFromString(topicMode.second.as<std::string>()));
+        }
+    }
+
+    if (config["log_retention_bytes"]) {
+        logRetention_.maxBytes =
+            config["log_retention_bytes"].as<std::size_t>();
+    }
+    if (config["log_retention_seconds"]) {
+        logRetention_.maxAge =
+            std::chrono::seconds(config["log_retention_seconds"].as<long>());
+    }
+
+    if (config["snapshot_path"]) {
+        snapshotPath_ = config["snapshot_path"].as<std::string>();
+    }
+    if (!config["snapshot_interval"]) {
+        snapshotInterval_ = -1;
+    } else {
+        snapshotInterval_ = config["snapshot_interval"].as<int>();
+    }
+    if (!config["topic_idle_timeout"]) {
+        topicIdleTimeout_ = -1;
+    } else {
+        topicIdleTimeout_ = config["topic_idle_timeout"].as<int>();
+    }
+
+    if (!config["metrics_port"]) {
+        metricsPort_ = -1;
+    } else {
+        metricsPort_ = config["metrics_port"].as<int>();
+    }
+
+    if (!config["log_level"]) {
+        logLevel_ = log::Level::Info;
+    } else {
+        logLevel_ =
+            getLogLevelFromString(config["log_level"].as<std::string>());
+    }
+    if (!config["log_rate_limit"]) {
+        logRateLimit_ = 0;
+    } else {
+        logRateLimit_ = config["log_rate_limit"].as<std::uint32_t>();
+    }
+
+    if (!config["request_tracing"]) {
+        requestTracing_ = false;
+    } else {
+        requestTracing_ = config["request_tracing"].as<bool>();
+    }
+    if (!config["slow_request_threshold_us"]) {
+        slowRequestThreshold_ = -1;
+    } else {
+        slowRequestThreshold_ = config["slow_request_threshold_us"].as<int>();
+    }
+    if (!config["slow_request_sample"]) {
+        slowRequestSample_ = 1;
+    } else {
+        slowRequestSample_ =
+            config["slow_request_sample"].as<std::uint32_t>();
+    }
+
+    if (!config["return_enqueue_time"]) {
+        enqueueTimeReturned_ = false;
+    } else {
+        enqueueTimeReturned_ = config["return_enqueue_time"].as<bool>();
+    }
+
+    if (!config["capture_path"]) {
+        capturePath_ = "";
+    } else {
+        capturePath_ = config["capture_path"].as<std::string>();
+    }
+
+    if (!config["unix_socket_path"]) {
+        unixSocketPath_ = "";
+    } else {
+        unixSocketPath_ = config["unix_socket_path"].as<std::string>();
+    }
+
+    if (!config["shm_socket_path"]) {
+        shmSocketPath_ = "";
+    } else {
+        shmSocketPath_ = config["shm_socket_path"].as<std::string>();
+    }
+
+    if (!config["shm_ring_size"]) {
+        shmRingSize_ = 1 << 20;
+    } else {
+        /// rings index data with a mask
+        shmRingSize_ = 4096;
+        while (shmRingSize_ < config["shm_ring_size"].as<std::size_t>()) {
+            shmRingSize_ *= 2;
+        }
+    }
+
+    if (!config["write_batch_size"]) {
+        writeBatchSize_ = 256 * 1024;
+    } else {
+        writeBatchSize_ = config["write_batch_size"].as<std::size_t>();
+    }
+
+    if (!config["zerocopy_threshold"]) {
+        zeroCopyThreshold_ = 0;
+    } else {
+        zeroCopyThreshold_ = config["zerocopy_threshold"].as<std::size_t>();
+    }
+
+    if (!config["max_message_size"]) {
+        maxMessageSize_ = kMaxFrameSize;
+    } else {
+        maxMessageSize_ = config["max_message_size"].as<std::size_t>();
+    }
+
+    if (!config["stream_threshold"]) {
+        streamThreshold_ = 64 * 1024;
+    } else {
+        streamThreshold_ = config["stream_threshold"].as<std::size_t>();
+    }
+
     address_ =
         net::ip::make_address(config["endpoint_address"].as<std::string>());
     port_ = config["endpoint_port"].as<unsigned short>();
@@ -73,6 +218,81 @@ QueueType ServerConfig::getQueueType() const { return queueType_; }
 
 int ServerConfig::getThreadsNumber() const { return threadsNumber_; }
 
+bool ServerConfig::isThreadPerCore() const {
+    return threadPerCore_ || shardPerCore_;
+}
+
+bool ServerConfig::isShardPerCore() const { return shardPerCore_; }
+
+const std::vector<int> &ServerConfig::getCpuAffinity() const {
+    return cpuAffinity_;
+}
+
 int ServerConfig::getTimeout() const { return secondsTimeout_; }
 
+const std::vector<std::pair<std::string, TopicMode>>
+    &ServerConfig::getTopicModes() const {
+    return topicModes_;
+}
+
+LogRetention ServerConfig::getLogRetention() const { return logRetention_; }
+
+const std::string &ServerConfig::getSnapshotPath() const {
+    return snapshotPath_;
+}
+
+int ServerConfig::getSnapshotInterval() const { return snapshotInterval_; }
+
+int ServerConfig::getTopicIdleTimeout() const { return topicIdleTimeout_; }
+
+int ServerConfig::getMetricsPort() const { return metricsPort_; }
+
+log::Level ServerConfig::getLogLevel() const { return logLevel_; }
+
+std::uint32_t ServerConfig::getLogRateLimit() const { return logRateLimit_; }
+
+bool ServerConfig::isRequestTracing() const { return requestTracing_; }
+
+int ServerConfig::getSlowRequestThreshold() const {
+    return slowRequestThreshold_;
+}
+
+std::uint32_t ServerConfig::getSlowRequestSample() const {
+    return slowRequestSample_;
+}
+
+bool ServerConfig::isEnqueueTimeReturned() const {
+    return enqueueTimeReturned_;
+}
+
+const std::string &ServerConfig::getCapturePath() const {
+    return capturePath_;
+}
+
+const std::string &ServerConfig::getUnixSocketPath() const {
+    return unixSocketPath_;
+}
+
+const std::string &ServerConfig::getShmSocketPath() const {
+    return shmSocketPath_;
+}
+
+std::size_t ServerConfig::getShmRingSize() const { return shmRingSize_; }
+
+std::size_t ServerConfig::getWriteBatchSize() const {
+    return writeBatchSize_;
+}
+
+std::size_t ServerConfig::getZeroCopyThreshold() const {
+    return zeroCopyThreshold_;
+}
+
+std::size_t ServerConfig::getMaxMessageSize() const {
+    return maxMessageSize_;
+}
+
+std::size_t ServerConfig::getStreamThreshold() const {
+    return streamThreshold_;
+}
+
 }  // namespace havka
\ No newline at end of file
@@ -3,7 +3,10 @@
 
 #include <boost/asio.hpp>
 #include <string>
+#include <utility>
+#include <vector>
 
+#include "server/message_log.h"
 #include "types.hpp"
 
 namespace net = boost::asio;  // from <boost/asio.hpp>
@@ -56,19 +59,198 @@ public:
      */
     int getThreadsNumber() const;
 
+    /**
+     * Checks if every server thread runs its own io_context and acceptor
+     * (SO_REUSEPORT), so connections stay on the thread which accepted them
+     * @return true if thread-per-core mode is enabled
+     */
+    bool isThreadPerCore() const;
+
+    /**
+     * Checks if storage is partitioned by topic between threads, requests
+     * of a topic are run by the thread owning it. Enables thread-per-core.
+     * @return true if shard-per-core mode is enabled
+     */
+    bool isShardPerCore() const;
+
+    /**
+     * Returns CPUs to pin server threads to, i-th thread is pinned to
+     * (i % size)-th CPU. Threads are not pinned if list is empty.
+     * @return list of CPU numbers
+     */
+    const std::vector<int>& getCpuAffinity() const;
+
     /**
      * Returns server timeout in seconds
      * @return server timeout in seconds
      */
     int getTimeout() const;
 
+    /**
+     * Returns delivery modes of topics as pairs (topic pattern, mode)
+     * @return topic modes
+     */
+    const std::vector<std::pair<std::string, TopicMode>>& getTopicModes()
+        const;
+
+    /**
+     * Returns retention limits of log topics
+     * @return retention limits
+     */
+    LogRetention getLogRetention() const;
+
+    /**
+     * Returns path to storage snapshot file (empty if snapshots are disabled)
+     * @return path to snapshot file
+     */
+    const std::string& getSnapshotPath() const;
+
+    /**
+     * Returns interval between periodic snapshots in seconds
+     * (-1 if snapshot is written only on shutdown)
+     * @return snapshot interval in seconds
+     */
+    int getSnapshotInterval() const;
+
+    /**
+     * Returns interval of garbage collection of idle topics in seconds
+     * (-1 if idle topics are never erased)
+     * @return topic idle timeout in seconds
+     */
+    int getTopicIdleTimeout() const;
+
+    /**
+     * Returns port of HTTP endpoint with metrics in Prometheus format
+     * (-1 if endpoint is disabled)
+     * @return metrics port
+     */
+    int getMetricsPort() const;
+
+    /**
+     * Returns minimal level of written log lines
+     * @return log level
+     */
+    log::Level getLogLevel() const;
+
+    /**
+     * Returns maximal number of log lines per second from one call site
+     * (0 if lines are not limited)
+     * @return log rate limit
+     */
+    std::uint32_t getLogRateLimit() const;
+
+    /**
+     * Checks if requests are traced (lock waits are measured and slow
+     * requests are logged)
+     * @return true if tracing is enabled
+     */
+    bool isRequestTracing() const;
+
+    /**
+     * Returns total time of request after which it is logged as slow
+     * (-1 if slow requests are not logged)
+     * @return slow request threshold in microseconds
+     */
+    int getSlowRequestThreshold() const;
+
+    /**
+     * Returns sampling of slow request log, every n-th slow request
+     * is logged
+     * @return slow request sampling
+     */
+    std::uint32_t getSlowRequestSample() const;
+
+    /**
+     * Checks if consumers get time when broker enqueued message
+     * @return true if enqueue time is returned
+     */
+    bool isEnqueueTimeReturned() const;
+
+    /**
+     * Returns path to file of traffic capture (empty if capture is off)
+     * @return capture path
+     */
+    const std::string& getCapturePath() const;
+
+    /**
+     * Returns path of Unix domain socket the server also listens on
+     * (empty if it is not configured)
+     * @return socket path
+     */
+    const std::string& getUnixSocketPath() const;
+
+    /**
+     * Returns path of Unix domain socket of shared memory transport
+     * (empty if transport is disabled)
+     * @return socket path
+     */
+    const std::string& getShmSocketPath() const;
+
+    /**
+     * Returns size of every ring of shared memory transport, it is rounded
+     * up to a power of two not less than 4096
+     * @return ring size in bytes
+     */
+    std::size_t getShmRingSize() const;
+
+    /**
+     * Returns maximal number of bytes of outbound items of a connection
+     * gathered into one write
+     * @return budget in bytes
+     */
+    std::size_t getWriteBatchSize() const;
+
+    /**
+     * Returns size of writes sent with MSG_ZEROCOPY on TCP connections
+     * @return size in bytes, 0 if zerocopy sends are disabled
+     */
+    std::size_t getZeroCopyThreshold() const;
+
+    /**
+     * Returns maximal size of request frame, connection which sends a
+     * larger one is closed
+     * @return size in bytes
+     */
+    std::size_t getMaxMessageSize() const;
+
+    /**
+     * Returns size of request frames whose message data is read from
+     * socket straight into the message
+     * @return size in bytes, larger frames are streamed
+     */
+    std::size_t getStreamThreshold() const;
+
 private:
     net::ip::address address_;
     unsigned short port_;
     StorageType storageType_;
     QueueType queueType_;
     int threadsNumber_;
+    bool threadPerCore_;
+    bool shardPerCore_;
+    std::vector<int> cpuAffinity_;
     int secondsTimeout_;
+    std::vector<std::pair<std::string, TopicMode>> topicModes_;
+    /// 1 GiB and one day if absent
+    LogRetention logRetention_{std::size_t{1} << 30, std::chrono::hours(24)};
+    std::string snapshotPath_;
+    int snapshotInterval_;
+    int topicIdleTimeout_;
+    int metricsPort_;
+    log::Level logLevel_;
+    std::uint32_t logRateLimit_;
+    bool requestTracing_;
+    int slowRequestThreshold_;
+    std::uint32_t slowRequestSample_;
+    bool enqueueTimeReturned_;
+    std::string capturePath_;
+    std::string unixSocketPath_;
+    std::string shmSocketPath_;
+    std::size_t shmRingSize_;
+    std::size_t writeBatchSize_;
+    std::size_t zeroCopyThreshold_;
+    std::size_t maxMessageSize_;
+    std::size_t streamThreshold_;
 
     // ...
 };
@@ -0,0 +1,71 @@
+#include "server/shards.h"
+
+namespace havka {
+
+namespace {
+
+/// Capacity of mailbox between two shards
+constexpr std::size_t kMailboxCapacity = 256;
+
+thread_local std::size_t currentShard = ShardExecutor::kNoShard;
+
+}  // namespace
+
+ShardExecutor::ShardExecutor(std::vector<boost::asio::io_context*> contexts)
+    : contexts_(std::move(contexts)) {
+    mailboxes_.reserve(contexts_.size() * contexts_.size());
+    for (std::size_t i = 0; i < contexts_.size() * contexts_.size(); ++i) {
+        mailboxes_.push_back(std::make_unique<Mailbox>(kMailboxCapacity));
+    }
+}
+
+std::size_t ShardExecutor::size() const { return contexts_.size(); }
+
+void ShardExecutor::bindThread(std::size_t shard) { currentShard = shard; }
+
+std::size_t ShardExecutor::getCurrentShard() { return currentShard; }
+
+void ShardExecutor::dispatch(std::size_t shard, Task task) {
+    auto from = currentShard;
+    if (from == shard) {
+        task();
+        return;
+    }
+    if (from >= size()) {
+        boost::asio::post(*contexts_[shard], std::move(task));
+        return;
+    }
+    auto& mailbox = *mailboxes_[from * size() + shard];
+    if (!mailbox.tasks.push(task)) {
+        boost::asio::post(*contexts_[shard], std::move(task));
+        return;
+    }
+    schedule_(shard, mailbox);
+}
+
+void ShardExecutor::schedule_(std::size_t shard, Mailbox& mailbox) {
+    /// pairs with the fence in drain_: either the drain sees the pushed
+    /// task or this thread sees that no drain is scheduled
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!mailbox.scheduled.exchange(true)) {
+        boost::asio::post(*contexts_[shard],
+                          [this, shard, &mailbox] { drain_(shard, mailbox); });
+    }
+}
+
+void ShardExecutor::drain_(std::size_t shard, Mailbox& mailbox) {
+    mailbox.scheduled.store(false);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    /// other handlers of the shard are not starved by a busy producer
+    Task task;
+    for (std::size_t i = 0; i < kMailboxCapacity && mailbox.tasks.pop(task);
+         ++i) {
+        task();
+        task = nullptr;
+    }
+    if (!mailbox.tasks.empty()) {
+        schedule_(shard, mailbox);
+    }
+}
+
+}  // namespace havka
@@ -0,0 +1,163 @@
+#ifndef HAVKA_SRC_SERVER_SHARDS_H_
+#define HAVKA_SRC_SERVER_SHARDS_H_
+
+#include <atomic>
+#include <boost/asio.hpp>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace havka {
+
+/**
+ * Returns shard which owns topic
+ * @param topic topic (not a pattern)
+ * @param shards number of shards
+ * @return index of shard
+ */
+inline std::size_t getTopicShard(const std::string& topic,
+                                 std::size_t shards) {
+    return std::hash<std::string>{}(topic) % shards;
+}
+
+/// Bounded lock-free queue of one producer thread and one consumer thread
+/**
+ * Head and tail are on separate cache lines, so producer and consumer
+ * do not invalidate each other's line on every operation.
+ * @tparam T type of elements, must be default constructible and movable
+ */
+template <typename T>
+class SpscRing {
+public:
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    /**
+     * Creates ring
+     * @param capacity maximal number of elements, power of two
+     */
+    explicit SpscRing(std::size_t capacity)
+        : items_(capacity), mask_(capacity - 1) {}
+
+    /**
+     * Pushes element if ring is not full. Called only by producer.
+     * @param item element, it is moved only on success
+     * @return false if ring is full
+     */
+    bool push(T& item) {
+        auto tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) == items_.size()) {
+            return false;
+        }
+        items_[tail & mask_] = std::move(item);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Pops element if ring is not empty. Called only by consumer.
+     * @param item element to move popped element to
+     * @return false if ring is empty
+     */
+    bool pop(T& item) {
+        auto head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = std::move(items_[head & mask_]);
+        items_[head & mask_] = T();
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Checks if ring is empty. Exact only for consumer.
+     * @return true if there are no elements
+     */
+    bool empty() const {
+        return head_.load(std::memory_order_relaxed) ==
+               tail_.load(std::memory_order_acquire);
+    }
+
+private:
+    std::vector<T> items_;
+    std::size_t mask_;
+    alignas(64) std::atomic<std::size_t> head_{0};
+    alignas(64) std::atomic<std::size_t> tail_{0};
+};
+
+/// Runs tasks on threads which own shards
+/**
+ * Every shard is owned by one thread running its io_context. Tasks from
+ * a shard thread to another shard go through a SPSC mailbox of the pair
+ * of shards, and the owner is woken up by one posted handler per batch
+ * of tasks, so a busy shard drains many tasks per wakeup. If the mailbox
+ * is full or the caller is not a shard thread, task is posted to the
+ * io_context of the owner.
+ */
+class ShardExecutor {
+public:
+    using Task = std::function<void()>;
+
+    /// Shard of threads which are not shard owners
+    static constexpr std::size_t kNoShard = static_cast<std::size_t>(-1);
+
+    ShardExecutor(const ShardExecutor&) = delete;
+    ShardExecutor& operator=(const ShardExecutor&) = delete;
+
+    /**
+     * Creates executor
+     * @param contexts io_context of every shard, i-th context is run by
+     * the owner of i-th shard
+     */
+    explicit ShardExecutor(std::vector<boost::asio::io_context*> contexts);
+
+    /**
+     * Returns number of shards
+     * @return number of shards
+     */
+    std::size_t size() const;
+
+    /**
+     * Marks calling thread as owner of shard, must be called by the thread
+     * which runs context of shard before running it
+     * @param shard index of shard
+     */
+    static void bindThread(std::size_t shard);
+
+    /**
+     * Returns shard owned by calling thread
+     * @return index of shard or kNoShard
+     */
+    static std::size_t getCurrentShard();
+
+    /**
+     * Runs task on owner of shard, immediately if it is the calling thread
+     * @param shard index of shard
+     * @param task task to run
+     */
+    void dispatch(std::size_t shard, Task task);
+
+private:
+    /// Tasks from one shard to another
+    struct Mailbox {
+        SpscRing<Task> tasks;
+        /// drain of mailbox is posted and has not started yet
+        std::atomic<bool> scheduled{false};
+
+        explicit Mailbox(std::size_t capacity) : tasks(capacity) {}
+    };
+
+    std::vector<boost::asio::io_context*> contexts_;
+    /// mailbox from shard i to shard j is (i * size + j)-th
+    std::vector<std::unique_ptr<Mailbox>> mailboxes_;
+
+    void schedule_(std::size_t shard, Mailbox& mailbox);
+
+    void drain_(std::size_t shard, Mailbox& mailbox);
+};
+
+}  // namespace havka
+
+#endif  // HAVKA_SRC_SERVER_SHARDS_H_
@@ -0,0 +1,250 @@
+#include "server/shm.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <thread>
+
+#include "server/net.h"
+#include "util.h"
+
+namespace havka {
+
+namespace {
+
+/// Maximal time of sleeping on empty ring, closed channel is noticed
+/// not later than this
+constexpr auto kWaitTimeout = std::chrono::milliseconds(100);
+
+}  // namespace
+
+ShmStream::ShmStream(boost::asio::local::stream_protocol::socket control,
+                     std::unique_ptr<ShmChannel> channel, std::string name)
+    : control_(std::move(control)),
+      channel_(std::move(channel)),
+      name_(std::move(name)),
+      controlByte_(0),
+      closed_(false) {}
+
+void ShmStream::start(std::function<void()> onReady) {
+    auto self = shared_from_this();
+    auto line = std::make_shared<std::string>(name_ + '\n');
+    net::async_write(
+        control_, net::buffer(*line),
+        [self, line, onReady = std::move(onReady)](
+            boost::system::error_code ec, std::size_t /* length */) {
+            if (ec) {
+                self->close();
+                return;
+            }
+            /// client sends one byte when it has mapped the channel
+            net::async_read(
+                self->control_, net::buffer(&self->controlByte_, 1),
+                [self, onReady](boost::system::error_code ec,
+                                std::size_t /* length */) {
+                    /// memory is freed when both sides unmap it
+                    ShmChannel::unlink(self->name_);
+                    if (ec) {
+                        self->close();
+                        return;
+                    }
+                    onReady();
+                    self->watchControl_();
+                });
+        });
+}
+
+void ShmStream::asyncReadSome(net::mutable_buffer buffer, Handler handler) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        /// handler owns the connection, which owns the stream
+        if (closed_) {
+            return;
+        }
+        readBuffer_ = buffer;
+        readHandler_ = std::move(handler);
+    }
+    readRequested_.notify_one();
+}
+
+std::size_t ShmStream::getMaxFrameSize() const {
+    /// every frame in ring is preceded by its length
+    return channel_->getRequests().getCapacity() - sizeof(std::uint32_t);
+}
+
+void ShmStream::write(const std::vector<net::const_buffer>& buffers,
+                      Handler handler) {
+    if (closed_ || channel_->isClosed()) {
+        handler(net::error::broken_pipe, 0);
+        return;
+    }
+    std::vector<iovec> parts;
+    parts.reserve(buffers.size());
+    for (const auto& buffer : buffers) {
+        parts.push_back({const_cast<void*>(buffer.data()), buffer.size()});
+    }
+    auto size = net::buffer_size(buffers);
+    /// client waits for the response, so the ring has space for it
+    /// unless the frame is larger than the ring
+    if (!channel_->getResponses().push(parts.data(), parts.size())) {
+        LOG_WARNING("Response of " << size
+                                   << " bytes does not fit into ring, closing");
+        /// client waits for this response, it must see the channel closed
+        close();
+        handler(net::error::no_buffer_space, 0);
+        return;
+    }
+    handler({}, size);
+}
+
+void ShmStream::close() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (closed_.exchange(true)) {
+            return;
+        }
+    }
+    readRequested_.notify_one();
+    channel_->close();
+    ShmChannel::unlink(name_);
+}
+
+void ShmStream::run() {
+    auto& requests = channel_->getRequests();
+    while (true) {
+        net::mutable_buffer buffer;
+        Handler handler;
+        bool closed;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            readRequested_.wait(lock,
+                                [this] { return readHandler_ || closed_; });
+            closed = closed_;
+            buffer = readBuffer_;
+            handler = std::move(readHandler_);
+            readHandler_ = nullptr;
+        }
+        /// handler owns the connection, which closes the stream when it is
+        /// destroyed, so it is dropped without the lock
+        if (closed) {
+            return;
+        }
+        std::size_t size = 0;
+        while (!requests.pop(static_cast<char*>(buffer.data()), buffer.size(),
+                             size)) {
+            if (closed_ || channel_->isClosed()) {
+                close();
+                handler(net::error::eof, 0);
+                return;
+            }
+            requests.wait(kWaitTimeout);
+        }
+        handler({}, size);
+    }
+}
+
+void ShmStream::watchControl_() {
+    auto self = shared_from_this();
+    control_.async_read_some(
+        net::buffer(&controlByte_, 1),
+        [self](boost::system::error_code ec, std::size_t /* length */) {
+            if (ec) {
+                self->close();
+                return;
+            }
+            self->watchControl_();
+        });
+}
+
+ShmServer::ShmServer(net::io_context& ioc, std::string socketPath,
+                     std::size_t ringSize,
+                     std::shared_ptr<IMessageStorage> storage,
+                     std::shared_ptr<CaptureWriter> capture,
+                     std::shared_ptr<ShardExecutor> shards,
+                     std::size_t maxMessageSize)
+    : acceptor_(ioc),
+      socketPath_(std::move(socketPath)),
+      ringSize_(ringSize),
+      storage_(std::move(storage)),
+      capture_(std::move(capture)),
+      shards_(std::move(shards)),
+      maxMessageSize_(maxMessageSize),
+      lastChannel_(0),
+      running_(0) {
+    /// socket file of a previous run would make bind fail
+    std::remove(socketPath_.c_str());
+    boost::asio::local::stream_protocol::endpoint endpoint(socketPath_);
+    acceptor_.open(endpoint.protocol());
+    acceptor_.bind(endpoint);
+    acceptor_.listen();
+}
+
+ShmServer::~ShmServer() {
+    stop();
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        stopped_.wait(lock, [this] { return running_ == 0; });
+    }
+    acceptor_.close();
+    std::remove(socketPath_.c_str());
+}
+
+void ShmServer::start() { acceptLoop_(); }
+
+void ShmServer::stop() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& weak : streams_) {
+        if (auto stream = weak.lock()) {
+            stream->close();
+        }
+    }
+    streams_.clear();
+}
+
+void ShmServer::acceptLoop_() {
+    acceptor_.async_accept([this](
+                               boost::system::error_code ec,
+                               boost::asio::local::stream_protocol::socket
+                                   socket) {
+        if (!ec) {
+            auto name = "/havka-" + std::to_string(getpid()) + "-" +
+                        std::to_string(++lastChannel_);
+            auto channel = std::make_unique<ShmChannel>(name, ringSize_);
+            if (!channel->good()) {
+                LOG_ERROR("Shared memory '" << name << "' can not be created");
+            } else {
+                auto stream = std::make_shared<ShmStream>(
+                    std::move(socket), std::move(channel), name);
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    streams_.erase(
+                        std::remove_if(
+                            streams_.begin(), streams_.end(),
+                            [](const auto& weak) { return weak.expired(); }),
+                        streams_.end());
+                    streams_.push_back(stream);
+                }
+                stream->start([this, stream] {
+                    std::make_shared<Connection>(stream, storage_, capture_,
+                                                 shards_, maxMessageSize_)
+                        ->start();
+                    {
+                        std::lock_guard<std::mutex> lock(mutex_);
+                        ++running_;
+                    }
+                    std::thread([this, stream]() mutable {
+                        stream->run();
+                        stream.reset();
+                        std::lock_guard<std::mutex> lock(mutex_);
+                        --running_;
+                        stopped_.notify_all();
+                    }).detach();
+                });
+            }
+        }
+        acceptLoop_();
+    });
+}
+
+}  // namespace havka
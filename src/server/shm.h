@@ -0,0 +1,178 @@
+#ifndef HAVKA_SRC_SERVER_SHM_H_
+#define HAVKA_SRC_SERVER_SHM_H_
+
+#include <atomic>
+#include <boost/asio.hpp>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "server/capture.h"
+#include "server/shards.h"
+#include "shm_ring.h"
+
+namespace havka {
+
+/// from <boost/asio.hpp>
+namespace net = boost::asio;
+
+// Forward declaration. Defined in file src/server/storage.h
+class IMessageStorage;
+
+/// Shared memory transport of one client connection
+/**
+ * Requests are read from the ring by a thread which runs the stream, it
+ * spins and then sleeps on futex while the ring is empty, and read
+ * handlers are run on this thread. Responses are pushed to the ring by
+ * the thread which writes them, write handlers are run immediately. Unix
+ * domain socket of the client is used to pass name of shared memory
+ * object and to notice that the client has gone.
+ */
+class ShmStream : public std::enable_shared_from_this<ShmStream> {
+public:
+    using Handler = std::function<void(boost::system::error_code, std::size_t)>;
+
+    ShmStream() = delete;
+    ShmStream(const ShmStream&) = delete;
+    ShmStream& operator=(const ShmStream&) = delete;
+
+    /**
+     * Constructs stream of accepted client
+     * @param control accepted Unix domain socket of client
+     * @param channel created channel
+     * @param name name of shared memory object of channel
+     */
+    ShmStream(boost::asio::local::stream_protocol::socket control,
+              std::unique_ptr<ShmChannel> channel, std::string name);
+
+    /**
+     * Sends name of channel to client and waits until client maps it.
+     * Non-blocking
+     * @param onReady called when client is ready to send requests
+     */
+    void start(std::function<void()> onReady);
+
+    /**
+     * Runs read handlers until stream is closed.
+     * Blocking
+     */
+    void run();
+
+    /**
+     * Reads the next request frame
+     * @param buffer buffer for frame, longer frames are truncated
+     * @param handler called with size of frame, or with error if stream
+     * is closed
+     */
+    void asyncReadSome(net::mutable_buffer buffer, Handler handler);
+
+    /**
+     * Returns size of the largest request frame, buffer of this size gets
+     * any frame whole
+     * @return size in bytes
+     */
+    std::size_t getMaxFrameSize() const;
+
+    /**
+     * Writes response frame gathered from buffers, handler is called
+     * before return
+     * @param buffers parts of frame
+     * @param handler called with size of frame, or with error if stream
+     * is closed or frame does not fit into ring
+     */
+    void write(const std::vector<net::const_buffer>& buffers,
+               Handler handler);
+
+    /**
+     * Closes channel, pending read is completed with error
+     */
+    void close();
+
+private:
+    boost::asio::local::stream_protocol::socket control_;
+    std::unique_ptr<ShmChannel> channel_;
+    std::string name_;
+    char controlByte_;
+
+    std::mutex mutex_;
+    std::condition_variable readRequested_;
+    net::mutable_buffer readBuffer_;
+    Handler readHandler_;
+    std::atomic<bool> closed_;
+
+    /**
+     * Closes stream when client closes its socket
+     */
+    void watchControl_();
+};
+
+/// Listener of clients of shared memory transport.
+/**
+ * Every accepted client gets its own channel of two rings in /dev/shm
+ * and a Connection over it, so requests are handled exactly as requests
+ * from sockets.
+ */
+class ShmServer {
+public:
+    ShmServer() = delete;
+    ShmServer(const ShmServer&) = delete;
+    ShmServer& operator=(const ShmServer&) = delete;
+
+    /**
+     * Opens Unix domain socket of the transport
+     * @param ioc io_context of server
+     * @param socketPath path of socket, stale socket file is removed
+     * @param ringSize size of every ring, power of two
+     * @param storage storage of server
+     * @param capture writer of traffic capture (nullptr if capture is off)
+     * @param shards executor of storage shards (nullptr if storage is not
+     * sharded)
+     * @param maxMessageSize maximum size of request frame of connections
+     */
+    ShmServer(net::io_context& ioc, std::string socketPath,
+              std::size_t ringSize, std::shared_ptr<IMessageStorage> storage,
+              std::shared_ptr<CaptureWriter> capture,
+              std::shared_ptr<ShardExecutor> shards,
+              std::size_t maxMessageSize);
+
+    /**
+     * Closes channels, waits for threads of streams and removes socket file
+     */
+    ~ShmServer();
+
+    /**
+     * Creates callback on new client.
+     * Non-blocking
+     */
+    void start();
+
+    /**
+     * Closes channels of all clients
+     */
+    void stop();
+
+private:
+    boost::asio::local::stream_protocol::acceptor acceptor_;
+    std::string socketPath_;
+    std::size_t ringSize_;
+    std::shared_ptr<IMessageStorage> storage_;
+    std::shared_ptr<CaptureWriter> capture_;
+    std::shared_ptr<ShardExecutor> shards_;
+    std::size_t maxMessageSize_;
+
+    std::mutex mutex_;
+    std::vector<std::weak_ptr<ShmStream>> streams_;
+    std::uint64_t lastChannel_;
+    /// number of running threads of streams
+    std::size_t running_;
+    std::condition_variable stopped_;
+
+    void acceptLoop_();
+};
+
+}  // namespace havka
+
+#endif  // HAVKA_SRC_SERVER_SHM_H_
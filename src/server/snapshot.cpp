@@ -0,0 +1,289 @@
+#include "server/snapshot.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "util.h"
+
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__,
+              "Snapshot format is little-endian");
+
+namespace havka {
+
+namespace {
+
+constexpr char kSnapshotMagic[8] = {'H', 'V', 'K', 'S', 'N', 'A', 'P', '\0'};
+constexpr std::uint32_t kSnapshotVersion = 2;
+constexpr std::uint8_t kQueueSection = 0;
+constexpr std::uint8_t kLogSection = 1;
+constexpr std::size_t kHeaderSize = 32;
+constexpr std::size_t kIndexEntrySize = 16;
+
+/// Reads integer from possibly unaligned memory, moves pointer
+template <typename T>
+bool readValue(const char*& pos, const char* end, T& value) {
+    if (static_cast<std::size_t>(end - pos) < sizeof(T)) {
+        return false;
+    }
+    std::memcpy(&value, pos, sizeof(T));
+    pos += sizeof(T);
+    return true;
+}
+
+/// Reads string prefixed with its u32 length, moves pointer
+bool readString(const char*& pos, const char* end, std::string& value) {
+    std::uint32_t size;
+    if (!readValue(pos, end, size) ||
+        static_cast<std::size_t>(end - pos) < size) {
+        return false;
+    }
+    value.assign(pos, size);
+    pos += size;
+    return true;
+}
+
+}  // namespace
+
+SnapshotWriter::SnapshotWriter(std::string path)
+    : path_(std::move(path)),
+      tmpPath_(path_ + ".tmp"),
+      file_(std::fopen(tmpPath_.c_str(), "wb")),
+      offset_(0),
+      good_(file_ != nullptr) {
+    if (!good_) {
+        LOG_ERROR("Can not open snapshot file '" << tmpPath_ << "'");
+        return;
+    }
+    /// header is rewritten in finish()
+    char header[kHeaderSize] = {};
+    write_(header, kHeaderSize);
+}
+
+SnapshotWriter::~SnapshotWriter() {
+    if (file_) {
+        std::fclose(file_);
+        std::remove(tmpPath_.c_str());
+    }
+}
+
+bool SnapshotWriter::good() const { return good_; }
+
+void SnapshotWriter::addTopic(const std::string& topic,
+                              const std::vector<Message>& messages) {
+    std::uint64_t begin = offset_;
+
+    writeString_(topic);
+    write_(&kQueueSection, sizeof(kQueueSection));
+    writeMessages_(messages);
+
+    index_.emplace_back(begin, offset_ - begin);
+}
+
+void SnapshotWriter::addLog(
+    const std::string& topic, std::uint64_t beginOffset,
+    const std::vector<Message>& messages,
+    const std::unordered_map<std::string, std::uint64_t>& groupOffsets) {
+    std::uint64_t begin = offset_;
+
+    writeString_(topic);
+    write_(&kLogSection, sizeof(kLogSection));
+    write_(&beginOffset, sizeof(beginOffset));
+    std::uint64_t groupsNumber = groupOffsets.size();
+    write_(&groupsNumber, sizeof(groupsNumber));
+    for (const auto& [group, offset] : groupOffsets) {
+        writeString_(group);
+        write_(&offset, sizeof(offset));
+    }
+    writeMessages_(messages);
+
+    index_.emplace_back(begin, offset_ - begin);
+}
+
+bool SnapshotWriter::finish() {
+    if (!good_) {
+        return false;
+    }
+
+    std::uint64_t indexOffset = offset_;
+    for (const auto& [sectionOffset, sectionSize] : index_) {
+        write_(&sectionOffset, sizeof(sectionOffset));
+        write_(&sectionSize, sizeof(sectionSize));
+    }
+
+    char header[kHeaderSize] = {};
+    std::uint64_t topicsNumber = index_.size();
+    std::memcpy(header, kSnapshotMagic, sizeof(kSnapshotMagic));
+    std::memcpy(header + 8, &kSnapshotVersion, sizeof(kSnapshotVersion));
+    std::memcpy(header + 16, &topicsNumber, sizeof(topicsNumber));
+    std::memcpy(header + 24, &indexOffset, sizeof(indexOffset));
+    if (good_ && std::fseek(file_, 0, SEEK_SET) != 0) {
+        good_ = false;
+    }
+    write_(header, kHeaderSize);
+
+    good_ = good_ && std::fflush(file_) == 0 && fsync(fileno(file_)) == 0;
+    good_ = std::fclose(file_) == 0 && good_;
+    file_ = nullptr;
+    if (!good_ || std::rename(tmpPath_.c_str(), path_.c_str()) != 0) {
+        LOG_ERROR("Can not write snapshot file '" << path_ << "'");
+        std::remove(tmpPath_.c_str());
+        return false;
+    }
+    return true;
+}
+
+void SnapshotWriter::write_(const void* data, std::size_t size) {
+    if (good_ && size > 0 && std::fwrite(data, 1, size, file_) != size) {
+        good_ = false;
+    }
+    offset_ += size;
+}
+
+void SnapshotWriter::writeString_(const std::string& value) {
+    auto size = static_cast<std::uint32_t>(value.size());
+    write_(&size, sizeof(size));
+    write_(value.data(), value.size());
+}
+
+void SnapshotWriter::writeMessages_(const std::vector<Message>& messages) {
+    std::uint64_t messagesNumber = messages.size();
+    write_(&messagesNumber, sizeof(messagesNumber));
+    for (const auto& message : messages) {
+        auto dataType = static_cast<std::uint8_t>(message.dataType);
+        std::uint64_t dataSize = message.data.size();
+        write_(&dataType, sizeof(dataType));
+        write_(&dataSize, sizeof(dataSize));
+        write_(message.data.data(), message.data.size());
+    }
+}
+
+SnapshotReader::SnapshotReader(const std::string& path)
+    : data_(nullptr),
+      size_(0),
+      topicsNumber_(0),
+      version_(0),
+      index_(nullptr) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        LOG_ERROR("Can not open snapshot file '" << path << "'");
+        return;
+    }
+    struct stat st {};
+    if (fstat(fd, &st) != 0 ||
+        static_cast<std::size_t>(st.st_size) < kHeaderSize) {
+        LOG_ERROR("Snapshot file '" << path << "' is too small");
+        close(fd);
+        return;
+    }
+    void* mapped = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        LOG_ERROR("Can not map snapshot file '" << path << "'");
+        return;
+    }
+    /// whole snapshot is going to be read
+    madvise(mapped, st.st_size, MADV_WILLNEED);
+    data_ = static_cast<const char*>(mapped);
+    size_ = st.st_size;
+
+    std::uint32_t version;
+    std::uint64_t topicsNumber;
+    std::uint64_t indexOffset;
+    std::memcpy(&version, data_ + 8, sizeof(version));
+    std::memcpy(&topicsNumber, data_ + 16, sizeof(topicsNumber));
+    std::memcpy(&indexOffset, data_ + 24, sizeof(indexOffset));
+    if (std::memcmp(data_, kSnapshotMagic, sizeof(kSnapshotMagic)) != 0 ||
+        version == 0 || version > kSnapshotVersion || indexOffset > size_ ||
+        (size_ - indexOffset) / kIndexEntrySize < topicsNumber) {
+        LOG_ERROR("Snapshot file '" << path << "' is corrupted");
+        return;
+    }
+    topicsNumber_ = topicsNumber;
+    version_ = version;
+    index_ = data_ + indexOffset;
+}
+
+SnapshotReader::~SnapshotReader() {
+    if (data_) {
+        munmap(const_cast<char*>(data_), size_);
+    }
+}
+
+bool SnapshotReader::good() const { return index_ != nullptr; }
+
+std::size_t SnapshotReader::getTopicsNumber() const { return topicsNumber_; }
+
+bool SnapshotReader::readTopic(std::size_t index,
+                               TopicSnapshot& snapshot) const {
+    if (index >= topicsNumber_) {
+        return false;
+    }
+    std::uint64_t sectionOffset;
+    std::uint64_t sectionSize;
+    const char* entry = index_ + index * kIndexEntrySize;
+    std::memcpy(&sectionOffset, entry, sizeof(sectionOffset));
+    std::memcpy(&sectionSize, entry + 8, sizeof(sectionSize));
+    if (sectionOffset > size_ || sectionSize > size_ - sectionOffset) {
+        return false;
+    }
+
+    const char* pos = data_ + sectionOffset;
+    const char* end = pos + sectionSize;
+    if (!readString(pos, end, snapshot.topic)) {
+        return false;
+    }
+
+    std::uint8_t kind = kQueueSection;
+    if (version_ > 1 && !readValue(pos, end, kind)) {
+        return false;
+    }
+    snapshot.isLog = kind == kLogSection;
+    snapshot.beginOffset = 0;
+    snapshot.groupOffsets.clear();
+    if (kind == kLogSection) {
+        std::uint64_t groupsNumber;
+        if (!readValue(pos, end, snapshot.beginOffset) ||
+            !readValue(pos, end, groupsNumber)) {
+            return false;
+        }
+        for (std::uint64_t i = 0; i < groupsNumber; ++i) {
+            std::string group;
+            std::uint64_t offset;
+            if (!readString(pos, end, group) || !readValue(pos, end, offset)) {
+                return false;
+            }
+            snapshot.groupOffsets[std::move(group)] = offset;
+        }
+    } else if (kind != kQueueSection) {
+        return false;
+    }
+
+    std::uint64_t messagesNumber;
+    if (!readValue(pos, end, messagesNumber)) {
+        return false;
+    }
+
+    snapshot.messages.clear();
+    snapshot.messages.reserve(
+        std::min<std::uint64_t>(messagesNumber, sectionSize / 9));
+    for (std::uint64_t i = 0; i < messagesNumber; ++i) {
+        std::uint8_t dataType;
+        std::uint64_t dataSize;
+        if (!readValue(pos, end, dataType) || !readValue(pos, end, dataSize) ||
+            static_cast<std::uint64_t>(end - pos) < dataSize) {
+            return false;
+        }
+        Message& message = snapshot.messages.emplace_back();
+        message.setData(pos, dataSize,
+                        static_cast<MessageDataType>(dataType));
+        pos += dataSize;
+    }
+    return true;
+}
+
+}  // namespace havka
@@ -0,0 +1,164 @@
+#ifndef HAVKA_SRC_SERVER_SNAPSHOT_H_
+#define HAVKA_SRC_SERVER_SNAPSHOT_H_
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "message.hpp"
+
+namespace havka {
+
+/// Messages of one topic stored in snapshot
+struct TopicSnapshot {
+    /// Topic name
+    std::string topic;
+
+    /// Messages in queue order
+    std::vector<Message> messages;
+
+    /// True if topic is a log topic, fields below are used only for it
+    bool isLog{false};
+
+    /// Offset of the first message of log
+    std::uint64_t beginOffset{0};
+
+    /// Offsets of consumer groups of log
+    std::unordered_map<std::string, std::uint64_t> groupOffsets;
+};
+
+/// Writes binary snapshot of storage topics to file.
+/**
+ * Snapshot format (all integers are little-endian):
+ * - header: magic "HVKSNAP" + '\0' (8 bytes), version (u32), reserved (u32),
+ *   number of topics (u64), offset of index (u64);
+ * - topic sections: topic length (u32), topic, kind (u8, 0 for queue and
+ *   1 for log), for logs begin offset (u64), number of consumer groups (u64)
+ *   and for every group name length (u32), name, offset (u64); then number
+ *   of messages (u64) and for every message data type (u8), data length
+ *   (u64), data;
+ * - index: for every topic offset (u64) and size (u64) of its section.
+ * Sections are independent, so a mapped snapshot is loaded in parallel
+ * per topic. Version 1 sections have no kind and are always queues.
+ * Snapshot is written to a temporary file which replaces target file
+ * only in finish(), so a crash never leaves a broken snapshot.
+ */
+class SnapshotWriter {
+public:
+    SnapshotWriter() = delete;
+    SnapshotWriter(const SnapshotWriter&) = delete;
+    SnapshotWriter& operator=(const SnapshotWriter&) = delete;
+
+    /**
+     * Opens temporary file for snapshot
+     * @param path path to snapshot file
+     */
+    explicit SnapshotWriter(std::string path);
+
+    /**
+     * Removes temporary file if snapshot was not finished
+     */
+    ~SnapshotWriter();
+
+    /**
+     * Checks if temporary file was opened and all writes were successful
+     * @return true if there were no errors
+     */
+    bool good() const;
+
+    /**
+     * Writes section with messages of one topic
+     * @param topic topic name
+     * @param messages messages in queue order
+     */
+    void addTopic(const std::string& topic,
+                  const std::vector<Message>& messages);
+
+    /**
+     * Writes section with retained messages and consumer group offsets of
+     * one log topic
+     * @param topic topic name
+     * @param beginOffset offset of the first message
+     * @param messages messages in offset order
+     * @param groupOffsets offsets of consumer groups
+     */
+    void addLog(const std::string& topic, std::uint64_t beginOffset,
+                const std::vector<Message>& messages,
+                const std::unordered_map<std::string, std::uint64_t>&
+                    groupOffsets);
+
+    /**
+     * Writes index and header, flushes file and atomically replaces
+     * snapshot file with it
+     * @return true on success
+     */
+    bool finish();
+
+private:
+    std::string path_;
+    std::string tmpPath_;
+    std::FILE* file_;
+    std::uint64_t offset_;
+    std::vector<std::pair<std::uint64_t, std::uint64_t>> index_;
+    bool good_;
+
+    void write_(const void* data, std::size_t size);
+    void writeString_(const std::string& value);
+    void writeMessages_(const std::vector<Message>& messages);
+};
+
+/// Reads binary snapshot written by SnapshotWriter.
+/**
+ * File is mapped into memory, topics are decoded straight from the mapping.
+ * readTopic is thread-safe, so topics can be decoded in parallel.
+ */
+class SnapshotReader {
+public:
+    SnapshotReader() = delete;
+    SnapshotReader(const SnapshotReader&) = delete;
+    SnapshotReader& operator=(const SnapshotReader&) = delete;
+
+    /**
+     * Maps snapshot file and validates its header and index
+     * @param path path to snapshot file
+     */
+    explicit SnapshotReader(const std::string& path);
+
+    /**
+     * Unmaps snapshot file
+     */
+    ~SnapshotReader();
+
+    /**
+     * Checks if snapshot was mapped and is valid
+     * @return true if snapshot can be read
+     */
+    bool good() const;
+
+    /**
+     * Returns number of topics in snapshot
+     * @return number of topics
+     */
+    std::size_t getTopicsNumber() const;
+
+    /**
+     * Decodes topic section with given index. Thread-safe.
+     * @param index index of topic, less than getTopicsNumber()
+     * @param snapshot decoded topic
+     * @return true on success, false if section is corrupted
+     */
+    bool readTopic(std::size_t index, TopicSnapshot& snapshot) const;
+
+private:
+    const char* data_;
+    std::size_t size_;
+    std::size_t topicsNumber_;
+    std::uint32_t version_;
+    const char* index_;
+};
+
+}  // namespace havka
+
+#endif  // HAVKA_SRC_SERVER_SNAPSHOT_H_
@@ -4,38 +4,146 @@
 
 #include "server/storage.h"
 
+#include <atomic>
+#include <functional>
+#include <iterator>
+#include <thread>
+#include <unordered_set>
+
+#include "metrics.h"
+#include "server/probes.h"
 #include "server/queue.h"
+#include "server/shards.h"
+#include "server/snapshot.h"
+#include "server/trace.h"
 
 namespace havka {
 
+namespace {
+
+metrics::Gauge &getQueuedMessages() {
+    static auto &gauge = metrics::Registry::instance().getGauge(
+        "havka_queued_messages", "Messages stored in queue topics");
+    return gauge;
+}
+
+metrics::Gauge &getWaitingClients() {
+    static auto &gauge = metrics::Registry::instance().getGauge(
+        "havka_waiting_clients", "Clients blocked in GET requests");
+    return gauge;
+}
+
+/// Sets monotonic and wall clock enqueue time of message
+void stampMessage(Message &message) {
+    message.enqueuedAt = metrics::getNowNs();
+    message.enqueueTime =
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch())
+            .count();
+}
+
+/**
+ * Reads snapshot, decoding topics in parallel
+ * @param path path to snapshot file
+ * @param threads number of threads decoding topics
+ * @param load function adding decoded topic to storage, called
+ * concurrently; messages of topic are stamped with loading time
+ * @return true on success
+ */
+bool loadSnapshotTopics(const std::string &path, unsigned int threads,
+                        const std::function<void(TopicSnapshot &)> &load) {
+    SnapshotReader reader(path);
+    if (!reader.good()) {
+        return false;
+    }
+
+    std::atomic<std::size_t> next{0};
+    std::atomic<bool> good{true};
+    auto loadTopics = [&] {
+        TopicSnapshot snapshot;
+        std::size_t index;
+        while ((index = next++) < reader.getTopicsNumber()) {
+            if (!reader.readTopic(index, snapshot)) {
+                good = false;
+                continue;
+            }
+            for (auto &message : snapshot.messages) {
+                /// time in queue is counted from loading
+                stampMessage(message);
+            }
+            load(snapshot);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    threads = std::max(1u, threads);
+    for (unsigned int i = 1; i < threads; ++i) {
+        workers.emplace_back(loadTopics);
+    }
+    loadTopics();
+    for (auto &worker : workers) {
+        worker.join();
+    }
+
+    if (!good) {
+        LOG_ERROR("Snapshot '" << path << "' has corrupted topics");
+    }
+    LOG_INFO("Snapshot with " << reader.getTopicsNumber()
+                              << " topics is loaded from '" << path << "'");
+    return good;
+}
+
+}  // namespace
+
 RamStorage::RamStorage(QueueType queueType) : queueType_(queueType) {}
 
-void RamStorage::postMessage(const Message &message, const std::string &tag) {
-    std::lock_guard<std::mutex> lock(mutex_);
+void RamStorage::postMessage(Message message, const std::string &tag) {
+    stampMessage(message);
+    auto lock = trace::lock(mutex_);
 
-    if (clients_.find(tag) != clients_.end() && clients_[tag]->size() > 0) {
+    auto mode = getTopicMode_(tag);
+    if (mode == TopicMode::Broadcast) {
+        auto payload = std::make_shared<const Message>(std::move(message));
+        std::size_t subscribers = 0;
+        auto clients = broadcast_(payload, tag, subscribers);
+        lock.unlock();
+        if (subscribers == 0) {
+            LOG_WARNING("There are no subscribers of broadcast topic '"
+                        << tag << "', message is dropped");
+            return;
+        }
+        if (!clients.empty()) {
+            Connection::sendBroadcastMessage(clients, *payload, tag);
+        }
+        return;
+    } else if (mode == TopicMode::Log) {
+        appendLog_(message, tag);
+        return;
+    }
+
+    auto client = popWaitingClient_(tag);
+    if (client) {
         /// there is a waiting client, send message immediately
-        auto client = *clients_[tag]->pop();
-        client->sendEmergedMessage(message);
+        HAVKA_PROBE3(waiter_wakeup, tag.c_str(), client.get(),
+                     message.data.size());
+        client->sendEmergedMessage(std::move(message), tag);
     } else {
         /// push message to the queue
-        if (queues_.find(tag) == queues_.end()) {
-            queues_.emplace(tag, createMessageQueue(queueType_));
-        }
-        queues_[tag]->push(message);
+        HAVKA_PROBE2(enqueue, tag.c_str(), message.data.size());
+        getQueue_(tag).queue->push(std::move(message));
+        getQueuedMessages().add(1);
     }
 }
 
 std::optional<Message> RamStorage::getMessageNonblocking(
-    const std::string &tag) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    if (queues_.find(tag) == queues_.end()) {
-        LOG_WARNING("There is no such queue with tag '" << tag << "'");
-        return std::nullopt;
-    }
+    const std::string &tag, const std::string &group, DeliveryInfo *info) {
+    auto lock = trace::lock(mutex_);
 
-    auto el = queues_[tag]->pop();
+    if (!isTopicPattern(tag) && getTopicMode_(tag) == TopicMode::Log) {
+        return readLog_(tag, group, nullptr, info);
+    }
 
+    auto el = popMessage_(tag, info);
     if (el == std::nullopt) {
         LOG_WARNING("IQueue with tag '" << tag << "' is empty");
     }
@@ -43,39 +151,731 @@ std::optional<Message> RamStorage::getMessageNonblocking(
 }
 
 std::optional<Message> RamStorage::getMessageBlocking(
-    const std::string &tag, std::shared_ptr<Connection> connection) {
-    std::lock_guard<std::mutex> lock(mutex_);
+    const std::string &tag, std::shared_ptr<Connection> connection,
+    const std::string &group, DeliveryInfo *info) {
+    auto lock = trace::lock(mutex_);
 
-    if (queues_.find(tag) == queues_.end()) {
-        LOG_WARNING("There is no such queue with tag '"
-                    << tag << "'\n"
-                    << "...... Adding client in a queue...");
-        if (clients_.find(tag) == clients_.end()) {
-            clients_.emplace(tag, createConnectionQueue(queueType_));
+    if (connection && !subscriptions_.empty()) {
+        if (auto subscription = findPendingBroadcast_(tag, connection.get())) {
+            return popPendingBroadcast_(*subscription, info);
         }
-        clients_[tag]->push(connection);
-        return std::nullopt;
     }
 
-    auto el = queues_[tag]->pop();
+    if (!isTopicPattern(tag) && getTopicMode_(tag) == TopicMode::Log) {
+        return readLog_(tag, group, std::move(connection), info);
+    }
+
+    auto el = popMessage_(tag, info);
     if (el == std::nullopt) {
         LOG_WARNING("IQueue with tag '"
                     << tag << "' is empty\n"
                     << "...... Adding client in a queue...");
-        if (clients_.find(tag) == clients_.end()) {
-            clients_.emplace(tag, createConnectionQueue(queueType_));
+        pushWaitingClient_(tag, std::move(connection));
+    }
+    return el;
+}
+
+std::optional<Message> RamStorage::getMessageBlocking(
+    const std::string &tag, std::shared_ptr<Connection> connection,
+    const std::shared_ptr<std::atomic<bool>> &claim, DeliveryInfo *info) {
+    auto lock = trace::lock(mutex_);
+    if (*claim) {
+        /// client is served by another storage
+        return std::nullopt;
+    }
+
+    Subscription *subscription = nullptr;
+    if (connection && !subscriptions_.empty()) {
+        subscription = findPendingBroadcast_(tag, connection.get());
+    }
+    bool ready = subscription != nullptr;
+    if (!ready) {
+        topics_.forEachMatchedBy(
+            tag, [&ready](const std::string &, MessageQueue *&entry) {
+                ready = entry->queue->size() > 0;
+                return ready;
+            });
+    }
+    if (!ready) {
+        pushWaitingClient_(tag, std::move(connection), claim);
+        return std::nullopt;
+    }
+    /// message is taken only by the wait which claims the client
+    if (claim->exchange(true)) {
+        return std::nullopt;
+    }
+    if (subscription) {
+        return popPendingBroadcast_(*subscription, info);
+    }
+    return popMessage_(tag, info);
+}
+
+std::optional<Message> RamStorage::popMessage_(const std::string &tag,
+                                               DeliveryInfo *info) {
+    std::optional<Message> el;
+    if (isTopicPattern(tag)) {
+        topics_.forEachMatchedBy(
+            tag, [&](const std::string &key, MessageQueue *&entry) {
+                el = entry->queue->pop();
+                if (!el) {
+                    return false;
+                }
+                getQueuedMessages().add(-1);
+                HAVKA_PROBE3(dequeue, key.c_str(), el->data.size(),
+                             el->enqueuedAt);
+                recordQueueTime_(*entry, *el);
+                entry->used = true;
+                if (info) {
+                    info->topic = key;
+                    info->offset = std::nullopt;
+                }
+                return true;
+            });
+        return el;
+    }
+
+    auto it = queues_.find(tag);
+    if (it == queues_.end()) {
+        return std::nullopt;
+    }
+    it->second.used = true;
+    el = it->second.queue->pop();
+    if (el) {
+        getQueuedMessages().add(-1);
+        HAVKA_PROBE3(dequeue, tag.c_str(), el->data.size(), el->enqueuedAt);
+        recordQueueTime_(it->second, *el);
+    }
+    if (el && info) {
+        info->topic = tag;
+        info->offset = std::nullopt;
+    }
+    return el;
+}
+
+void RamStorage::appendLog_(const Message &message, const std::string &tag) {
+    auto &topic = logs_.try_emplace(tag, LogTopic{MessageLog(logRetention_)})
+                      .first->second;
+    topic.log.append(message);
+
+    /// every consumer group gets the message independently
+    for (auto &[group, waiters] : topic.waiters) {
+        if (waiters->size() == 0) {
+            continue;
+        }
+        std::uint64_t offset;
+        auto el = topic.log.readNext(group, &offset);
+        if (!el) {
+            continue;
+        }
+        auto client = *waiters->pop();
+        getWaitingClients().add(-1);
+        HAVKA_PROBE3(waiter_wakeup, tag.c_str(), client.get(),
+                     el->data.size());
+        client->sendEmergedMessage(std::move(*el), tag, offset);
+    }
+}
+
+std::optional<Message> RamStorage::readLog_(
+    const std::string &tag, const std::string &group,
+    std::shared_ptr<Connection> connection, DeliveryInfo *info) {
+    auto &topic = logs_.try_emplace(tag, LogTopic{MessageLog(logRetention_)})
+                      .first->second;
+
+    std::uint64_t offset;
+    auto el = topic.log.readNext(group, &offset);
+    if (el) {
+        if (info) {
+            info->topic = tag;
+            info->offset = offset;
         }
-        clients_[tag]->push(connection);
+        return el;
+    }
+
+    LOG_WARNING("Log with tag '" << tag << "' has no new messages for group '"
+                                 << group << "'");
+    if (connection) {
+        auto &waiters = topic.waiters[group];
+        if (!waiters) {
+            waiters = createConnectionQueue(queueType_);
+        }
+        HAVKA_PROBE2(waiter_register, tag.c_str(), connection.get());
+        waiters->push(std::move(connection));
+        getWaitingClients().add(1);
+    }
+    return std::nullopt;
+}
+
+std::optional<std::uint64_t> RamStorage::seekLog(const std::string &tag,
+                                                 const std::string &group,
+                                                 std::uint64_t offset) {
+    auto lock = trace::lock(mutex_);
+    if (getTopicMode_(tag) != TopicMode::Log) {
         return std::nullopt;
+    }
+    auto &topic = logs_.try_emplace(tag, LogTopic{MessageLog(logRetention_)})
+                      .first->second;
+    return topic.log.seek(group, offset);
+}
+
+void RamStorage::setLogRetention(const LogRetention &retention) {
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    logRetention_ = retention;
+}
+
+std::shared_ptr<Connection> RamStorage::popWaitingClient_(
+    const std::string &tag) {
+    auto it = clients_.find(tag);
+    if (it != clients_.end()) {
+        it->second.used = true;
+    }
+    while (true) {
+        /// the client which has waited longest, on the topic or on a pattern
+        WaitingQueue *oldest = nullptr;
+        auto consider = [&oldest](WaitingQueue &entry) {
+            if (!entry.arrivals.empty() &&
+                (!oldest || entry.arrivals.front().number <
+                                oldest->arrivals.front().number)) {
+                oldest = &entry;
+            }
+        };
+        if (it != clients_.end()) {
+            consider(it->second);
+        }
+        if (!patternClients_.empty()) {
+            patternClients_.forEachMatching(
+                tag, [&](const std::string &, WaitingQueue &entry) {
+                    consider(entry);
+                    return false;
+                });
+        }
+        if (!oldest) {
+            return nullptr;
+        }
+        oldest->used = true;
+        auto arrival = std::move(oldest->arrivals.front());
+        oldest->arrivals.pop_front();
+        auto client = *oldest->queue->pop();
+        getWaitingClients().add(-1);
+        /// wait shared with other shards could be served by one of them
+        if (!arrival.claim || !arrival.claim->exchange(true)) {
+            return client;
+        }
+    }
+}
+
+std::vector<std::pair<std::string, std::shared_ptr<Connection>>>
+RamStorage::popWaitingClients_(const std::string &tag) {
+    std::vector<std::pair<std::string, std::shared_ptr<Connection>>> clients;
+    std::int64_t popped = 0;
+    auto popAll = [&](const std::string &key, WaitingQueue &entry) {
+        for (auto &arrival : entry.arrivals) {
+            auto client = *entry.queue->pop();
+            ++popped;
+            if (!arrival.claim || !arrival.claim->exchange(true)) {
+                clients.emplace_back(key, std::move(client));
+            }
+        }
+        entry.arrivals.clear();
+    };
+
+    auto it = clients_.find(tag);
+    if (it != clients_.end()) {
+        it->second.used = true;
+        popAll(tag, it->second);
+    }
+    if (!patternClients_.empty()) {
+        patternClients_.forEachMatching(
+            tag, [&](const std::string &pattern, WaitingQueue &entry) {
+                entry.used = true;
+                popAll(pattern, entry);
+                return false;
+            });
+    }
+    getWaitingClients().add(-popped);
+    return clients;
+}
+
+std::vector<std::shared_ptr<Connection>> RamStorage::broadcast_(
+    const std::shared_ptr<const Message> &payload, const std::string &tag,
+    std::size_t &subscribers) {
+    /// waiting clients get the message now and stay subscribed
+    std::vector<std::shared_ptr<Connection>> clients;
+    std::unordered_set<const Connection *> delivered;
+    for (auto &[key, client] : popWaitingClients_(tag)) {
+        if (!client || !delivered.insert(client.get()).second) {
+            continue;
+        }
+        auto &subscription = subscriptions_[key].subscribers[client.get()];
+        if (subscription.connection.expired()) {
+            /// connection at the same address is a new subscriber
+            subscription.pending.clear();
+            subscription.connection = client;
+        }
+        clients.push_back(std::move(client));
+    }
+
+    /// other subscribers get it on their next get
+    subscriptions_.forEachMatching(
+        tag, [&](const std::string &key, SubscriptionSet &entry) {
+            entry.used = true;
+            auto &set = entry.subscribers;
+            for (auto it = set.begin(); it != set.end();) {
+                auto &[connection, subscription] = *it;
+                if (subscription.connection.expired()) {
+                    it = set.erase(it);
+                    continue;
+                }
+                if (delivered.insert(connection).second) {
+                    if (subscription.pending.size() >= kMaxPendingBroadcasts) {
+                        LOG_WARNING("Subscriber of '"
+                                    << key << "' is too slow, the oldest "
+                                    << "broadcast message is dropped");
+                        subscription.pending.pop_front();
+                    }
+                    subscription.pending.emplace_back(tag, payload);
+                }
+                ++it;
+            }
+            return false;
+        });
+    subscribers = delivered.size();
+    return clients;
+}
+
+RamStorage::Subscription *RamStorage::findPendingBroadcast_(
+    const std::string &tag, const Connection *connection) {
+    auto entry = subscriptions_.find(tag);
+    if (!entry) {
+        return nullptr;
+    }
+    auto it = entry->subscribers.find(connection);
+    if (it == entry->subscribers.end() || it->second.pending.empty()) {
+        return nullptr;
+    }
+    entry->used = true;
+    return &it->second;
+}
+
+Message RamStorage::popPendingBroadcast_(Subscription &subscription,
+                                         DeliveryInfo *info) {
+    auto [topic, payload] = std::move(subscription.pending.front());
+    subscription.pending.pop_front();
+    if (info) {
+        info->topic = std::move(topic);
+        info->offset = std::nullopt;
+    }
+    return *payload;
+}
+
+void RamStorage::setTopicMode(const std::string &pattern, TopicMode mode) {
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    topicModes_[pattern] = mode;
+}
+
+TopicMode RamStorage::getTopicMode_(const std::string &tag) {
+    if (topicModes_.empty()) {
+        return TopicMode::Queue;
+    }
+    if (auto mode = topicModes_.find(tag)) {
+        return *mode;
+    }
+
+    TopicMode result = TopicMode::Queue;
+    std::size_t longest = 0;
+    topicModes_.forEachMatching(
+        tag, [&](const std::string &pattern, TopicMode &mode) {
+            if (pattern.size() >= longest) {
+                longest = pattern.size();
+                result = mode;
+            }
+            return false;
+        });
+    return result;
+}
+
+void RamStorage::recordQueueTime_(MessageQueue &entry,
+                                  const Message &message) {
+    /// message which was not stamped is not counted
+    if (message.enqueuedAt != 0) {
+        entry.queueTime.record(metrics::getNowNs() - message.enqueuedAt);
+    }
+}
+
+RamStorage::MessageQueue &RamStorage::getQueue_(const std::string &tag) {
+    auto it = queues_.find(tag);
+    if (it == queues_.end()) {
+        it = queues_
+                 .emplace(tag,
+                          MessageQueue{{createMessageQueue(queueType_)}, {}})
+                 .first;
+        topics_[tag] = &it->second;
+    }
+    it->second.used = true;
+    return it->second;
+}
+
+bool RamStorage::saveSnapshot(const std::string &path) {
+    std::lock_guard<std::mutex> snapshotLock(snapshotMutex_);
+
+    SnapshotWriter writer(path);
+    auto messagesNumber = writeSnapshot(writer);
+    if (!writer.finish()) {
+        return false;
+    }
+    LOG_INFO("Snapshot with " << messagesNumber << " messages is written to '"
+                              << path << "'");
+    return true;
+}
+
+std::size_t RamStorage::writeSnapshot(SnapshotWriter &writer) {
+    std::vector<std::pair<std::string, std::shared_ptr<IQueue<Message>>>>
+        queues;
+    std::vector<TopicSnapshot> logs;
+    {
+        std::lock_guard<ProfiledMutex> lock(mutex_);
+        queues.reserve(queues_.size());
+        for (const auto &[tag, entry] : queues_) {
+            queues.emplace_back(tag, entry.queue);
+        }
+        /// logs have no own locks, they are copied under storage lock
+        logs.reserve(logs_.size());
+        for (auto &[tag, entry] : logs_) {
+            auto &log = logs.emplace_back();
+            log.topic = tag;
+            log.isLog = true;
+            log.beginOffset = entry.log.getBeginOffset();
+            log.messages = entry.log.getMessages();
+            log.groupOffsets = entry.log.getGroupOffsets();
+        }
+    }
+
+    std::size_t messagesNumber = 0;
+    for (const auto &[tag, queue] : queues) {
+        auto messages = queue->snapshot();
+        if (messages.empty()) {
+            continue;
+        }
+        messagesNumber += messages.size();
+        writer.addTopic(tag, messages);
+    }
+    for (const auto &log : logs) {
+        messagesNumber += log.messages.size();
+        writer.addLog(log.topic, log.beginOffset, log.messages,
+                      log.groupOffsets);
+    }
+    return messagesNumber;
+}
+
+bool RamStorage::loadSnapshot(const std::string &path, unsigned int threads) {
+    return loadSnapshotTopics(
+        path, threads,
+        [this](TopicSnapshot &snapshot) { loadTopic(snapshot); });
+}
+
+void RamStorage::loadTopic(const TopicSnapshot &snapshot) {
+    if (snapshot.isLog) {
+        std::lock_guard<ProfiledMutex> lock(mutex_);
+        auto &topic = logs_
+                          .try_emplace(snapshot.topic,
+                                       LogTopic{MessageLog(logRetention_)})
+                          .first->second;
+        topic.log.restore(snapshot.beginOffset, snapshot.messages,
+                          snapshot.groupOffsets);
+        return;
+    }
+
+    /// queue is filled without storage lock,
+    /// then it is inserted or merged into existing one
+    auto queue = createMessageQueue(queueType_);
+    for (const auto &message : snapshot.messages) {
+        queue->push(message);
+    }
+    getQueuedMessages().add(snapshot.messages.size());
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    auto it = queues_.find(snapshot.topic);
+    if (it == queues_.end()) {
+        it = queues_.emplace(snapshot.topic, MessageQueue{{queue}, {}}).first;
+        topics_[snapshot.topic] = &it->second;
     } else {
-        return el;
+        for (const auto &message : snapshot.messages) {
+            it->second.queue->push(message);
+        }
+    }
+}
+
+void RamStorage::pushWaitingClient_(
+    const std::string &tag, std::shared_ptr<Connection> connection,
+    std::shared_ptr<std::atomic<bool>> claim) {
+    auto &entry = isTopicPattern(tag) ? patternClients_[tag] : clients_[tag];
+    if (!entry.queue) {
+        entry.queue = createConnectionQueue(queueType_);
+    }
+    entry.used = true;
+    HAVKA_PROBE2(waiter_register, tag.c_str(), connection.get());
+    entry.queue->push(connection);
+    entry.arrivals.push_back({++lastWaiter_, std::move(claim)});
+    getWaitingClients().add(1);
+}
+
+std::size_t RamStorage::collectGarbage() {
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    std::size_t erased = 0;
+
+    /// erases idle empty entries, unmarks others
+    auto isGarbage = [](auto &entry) {
+        if (entry.used || entry.queue->size() > 0) {
+            entry.used = false;
+            return false;
+        }
+        return true;
+    };
+
+    for (auto it = queues_.begin(); it != queues_.end();) {
+        if (isGarbage(it->second)) {
+            topics_.erase(it->first);
+            it = queues_.erase(it);
+            ++erased;
+        } else {
+            ++it;
+        }
+    }
+    for (auto it = clients_.begin(); it != clients_.end();) {
+        if (isGarbage(it->second)) {
+            it = clients_.erase(it);
+            ++erased;
+        } else {
+            ++it;
+        }
+    }
+    /// drops waits served by other shards, so they do not keep clients
+    auto dropClaimed = [](WaitingQueue &entry) {
+        std::deque<Arrival> arrivals;
+        for (auto &arrival : entry.arrivals) {
+            auto client = *entry.queue->pop();
+            if (arrival.claim && *arrival.claim) {
+                getWaitingClients().add(-1);
+                continue;
+            }
+            entry.queue->push(std::move(client));
+            arrivals.push_back(std::move(arrival));
+        }
+        entry.arrivals = std::move(arrivals);
+    };
+    std::vector<std::string> patterns;
+    patternClients_.forEach(
+        [&](const std::string &pattern, WaitingQueue &entry) {
+            dropClaimed(entry);
+            if (isGarbage(entry)) {
+                patterns.push_back(pattern);
+            }
+            return false;
+        });
+    for (const auto &pattern : patterns) {
+        patternClients_.erase(pattern);
+        ++erased;
+    }
+
+    /// age limit is applied to logs which nobody writes or reads
+    for (auto &[tag, entry] : logs_) {
+        entry.log.trim();
+    }
+
+    /// subscribers which have disconnected are dropped
+    patterns.clear();
+    subscriptions_.forEach(
+        [&](const std::string &pattern, SubscriptionSet &entry) {
+            auto &set = entry.subscribers;
+            for (auto it = set.begin(); it != set.end();) {
+                if (it->second.connection.expired()) {
+                    it = set.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+            if (!entry.used && set.empty()) {
+                patterns.push_back(pattern);
+            }
+            entry.used = false;
+            return false;
+        });
+    for (const auto &pattern : patterns) {
+        subscriptions_.erase(pattern);
+        ++erased;
+    }
+
+    if (erased > 0) {
+        LOG_INFO("Garbage collection erased " << erased << " idle queues");
+    }
+    return erased;
+}
+
+std::size_t RamStorage::getQueuesNumber() {
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    return queues_.size() + clients_.size() + patternClients_.size();
+}
+
+std::vector<TopicStats> RamStorage::getTopicStats() {
+    std::vector<TopicStats> topics;
+    std::vector<std::shared_ptr<IQueue<Message>>> queues;
+    {
+        std::lock_guard<ProfiledMutex> lock(mutex_);
+        topics.reserve(queues_.size());
+        queues.reserve(queues_.size());
+        for (const auto &[tag, entry] : queues_) {
+            auto &stats = topics.emplace_back();
+            stats.topic = tag;
+            stats.queueTime = entry.queueTime;
+            queues.push_back(entry.queue);
+        }
+    }
+
+    auto now = metrics::getNowNs();
+    for (std::size_t i = 0; i < topics.size(); ++i) {
+        topics[i].depth = queues[i]->size();
+        /// only the timestamp is read, the message is not copied
+        std::uint64_t enqueuedAt = 0;
+        queues[i]->visitFront([&enqueuedAt](const Message &oldest) {
+            enqueuedAt = oldest.enqueuedAt;
+        });
+        if (enqueuedAt != 0 && enqueuedAt < now) {
+            topics[i].oldestAge = now - enqueuedAt;
+        }
+    }
+    return topics;
+}
+
+ShardedStorage::ShardedStorage(QueueType queueType, std::size_t shards) {
+    shards_.reserve(shards);
+    for (std::size_t i = 0; i < shards; ++i) {
+        shards_.push_back(std::make_unique<RamStorage>(queueType));
+    }
+}
+
+std::size_t ShardedStorage::getShard(const std::string &tag) const {
+    return getTopicShard(tag, shards_.size());
+}
+
+void ShardedStorage::postMessage(Message message, const std::string &tag) {
+    shards_[getShard(tag)]->postMessage(std::move(message), tag);
+}
+
+std::optional<Message> ShardedStorage::getMessageNonblocking(
+    const std::string &tag, const std::string &group, DeliveryInfo *info) {
+    if (!isTopicPattern(tag)) {
+        return shards_[getShard(tag)]->getMessageNonblocking(tag, group, info);
+    }
+    /// shards are checked from a rotating one, so a pattern consumer
+    /// does not drain the first shard before others
+    static std::atomic<std::size_t> nextShard{0};
+    auto first = nextShard++;
+    for (std::size_t i = 0; i < shards_.size(); ++i) {
+        auto message = shards_[(first + i) % shards_.size()]
+                           ->getMessageNonblocking(tag, group, info);
+        if (message) {
+            return message;
+        }
+    }
+    return std::nullopt;
+}
+
+std::optional<Message> ShardedStorage::getMessageBlocking(
+    const std::string &tag, std::shared_ptr<Connection> connection,
+    const std::string &group, DeliveryInfo *info) {
+    if (isTopicPattern(tag)) {
+        /// client waits on every shard, the first one with a message
+        /// claims it
+        auto claim = std::make_shared<std::atomic<bool>>(false);
+        for (auto &shard : shards_) {
+            if (auto el =
+                    shard->getMessageBlocking(tag, connection, claim, info)) {
+                return el;
+            }
+            if (*claim) {
+                break;
+            }
+        }
+        return std::nullopt;
+    }
+    return shards_[getShard(tag)]->getMessageBlocking(
+        tag, std::move(connection), group, info);
+}
+
+void ShardedStorage::setTopicMode(const std::string &pattern,
+                                  TopicMode mode) {
+    for (auto &shard : shards_) {
+        shard->setTopicMode(pattern, mode);
+    }
+}
+
+std::optional<std::uint64_t> ShardedStorage::seekLog(const std::string &tag,
+                                                     const std::string &group,
+                                                     std::uint64_t offset) {
+    return shards_[getShard(tag)]->seekLog(tag, group, offset);
+}
+
+void ShardedStorage::setLogRetention(const LogRetention &retention) {
+    for (auto &shard : shards_) {
+        shard->setLogRetention(retention);
+    }
+}
+
+bool ShardedStorage::saveSnapshot(const std::string &path) {
+    std::lock_guard<std::mutex> snapshotLock(snapshotMutex_);
+
+    SnapshotWriter writer(path);
+    std::size_t messagesNumber = 0;
+    for (auto &shard : shards_) {
+        messagesNumber += shard->writeSnapshot(writer);
+    }
+    if (!writer.finish()) {
+        return false;
+    }
+    LOG_INFO("Snapshot with " << messagesNumber << " messages is written to '"
+                              << path << "'");
+    return true;
+}
+
+bool ShardedStorage::loadSnapshot(const std::string &path,
+                                  unsigned int threads) {
+    return loadSnapshotTopics(path, threads, [this](TopicSnapshot &snapshot) {
+        shards_[getShard(snapshot.topic)]->loadTopic(snapshot);
+    });
+}
+
+std::size_t ShardedStorage::collectGarbage() {
+    std::size_t erased = 0;
+    for (auto &shard : shards_) {
+        erased += shard->collectGarbage();
+    }
+    return erased;
+}
+
+std::size_t ShardedStorage::getQueuesNumber() {
+    std::size_t queues = 0;
+    for (auto &shard : shards_) {
+        queues += shard->getQueuesNumber();
+    }
+    return queues;
+}
+
+std::vector<TopicStats> ShardedStorage::getTopicStats() {
+    std::vector<TopicStats> stats;
+    for (auto &shard : shards_) {
+        auto shardStats = shard->getTopicStats();
+        std::move(shardStats.begin(), shardStats.end(),
+                  std::back_inserter(stats));
     }
+    return stats;
 }
 
 std::shared_ptr<IMessageStorage> createMessageStorage(StorageType storageType,
-                                                      QueueType queueType) {
+                                                      QueueType queueType,
+                                                      std::size_t shards) {
     switch (storageType) {
         case StorageType::RAM:
+            if (shards > 1) {
+                return std::make_shared<ShardedStorage>(queueType, shards);
+            }
             return std::make_shared<RamStorage>(queueType);
     }
 }
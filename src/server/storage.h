@@ -1,15 +1,23 @@
 #ifndef HAVKA_SRC_SERVER_STORAGE_H_
 #define HAVKA_SRC_SERVER_STORAGE_H_
 
+#include <atomic>
+#include <cstdint>
+#include <deque>
 #include <memory>
 #include <optional>
 #include <shared_mutex>
 #include <unordered_map>
 
 #include "message.hpp"
+#include "metrics.h"
+#include "profiled_mutex.h"
+#include "server/message_log.h"
 #include "server/net.h"
 #include "server/queue.h"
 #include "server/server_config.h"
+#include "server/snapshot.h"
+#include "server/topic_trie.hpp"
 #include "types.hpp"
 
 namespace havka {
@@ -21,44 +29,139 @@ class Connection;
 template <typename T>
 class IQueue;
 
+/// Statistics of queue topic
+struct TopicStats {
+    std::string topic;
+
+    /// Number of messages in queue
+    std::size_t depth{0};
+
+    /// Time spent in queue by the oldest message in nanoseconds
+    /// (0 if queue is empty)
+    std::uint64_t oldestAge{0};
+
+    /// Time spent in queue by messages which were got from topic,
+    /// messages handed to waiting clients directly are not counted
+    metrics::BucketHistogram queueTime;
+};
+
 /// Storage interface for server.
 class IMessageStorage {
 public:
     /**
      * Posts message to the storage. If topic is empty and
      * there are waiting clients, sends message to one of them
-     * @param message message to post
+     * @param message message to post, moved into the queue
      * @param tag message topic
      */
-    virtual void postMessage(const Message& message,
-                             const std::string& tag) = 0;
+    virtual void postMessage(Message message, const std::string& tag) = 0;
 
     /**
      * Gets message from the storage. If topic is empty, returns std::nullopt
      * Nonblocking.
-     * @param tag message topic
+     * @param tag message topic or wildcard pattern
+     * @param group consumer group, used if topic is a log topic
+     * @param info if not null, receives topic (and log offset) of
+     * returned message
      * @return message or std::nullopt if topic is empty
      */
     virtual std::optional<Message> getMessageNonblocking(
-        const std::string& tag) = 0;
+        const std::string& tag, const std::string& group = "",
+        DeliveryInfo* info = nullptr) = 0;
 
     /**
      * Gets message from the storage.
      * Call is nonblocking.
      * If queue is empty, pushes client to the waiting queue.
-     * @param tag message topic
+     * @param tag message topic or wildcard pattern
      * @param connection clients connection (which is being pushed to waiting
      * queue if needed)
+     * @param group consumer group, used if topic is a log topic
+     * @param info if not null, receives topic (and log offset) of
+     * returned message
      * @return message or std::nullopt if topic is empty
      */
     virtual std::optional<Message> getMessageBlocking(
-        const std::string& tag, std::shared_ptr<Connection> connection) = 0;
+        const std::string& tag, std::shared_ptr<Connection> connection,
+        const std::string& group = "", DeliveryInfo* info = nullptr) = 0;
+
+    /**
+     * Sets delivery mode for topics matching pattern.
+     * By default every topic has TopicMode::Queue.
+     * @param pattern topic or wildcard pattern
+     * @param mode delivery mode
+     */
+    virtual void setTopicMode(const std::string& pattern, TopicMode mode) = 0;
+
+    /**
+     * Sets offset of consumer group in log topic (TopicMode::Log),
+     * so the group can replay retained messages or skip them.
+     * @param tag log topic
+     * @param group consumer group
+     * @param offset new offset, clamped to offsets of retained messages
+     * @return offset which was set or std::nullopt if tag is not a log topic
+     */
+    virtual std::optional<std::uint64_t> seekLog(const std::string& tag,
+                                                 const std::string& group,
+                                                 std::uint64_t offset) = 0;
+
+    /**
+     * Sets retention limits of log topics created after the call
+     * @param retention size and age limits
+     */
+    virtual void setLogRetention(const LogRetention& retention) = 0;
+
+    /**
+     * Writes binary snapshot of all queue and log topics to file.
+     * Traffic is not stopped: every queue is copied under its own lock,
+     * so snapshot is consistent per topic.
+     * @param path path to snapshot file
+     * @return true on success
+     */
+    virtual bool saveSnapshot(const std::string& path) = 0;
+
+    /**
+     * Loads binary snapshot, decoding topics in parallel. Messages are
+     * appended to the queues of their topics.
+     * @param path path to snapshot file
+     * @param threads number of threads decoding topics
+     * @return true on success
+     */
+    virtual bool loadSnapshot(const std::string& path,
+                              unsigned int threads) = 0;
+
+    /**
+     * Erases message queues and waiting queues which are empty and were not
+     * used since the previous call, so ephemeral topics do not leak memory.
+     * Calling it every idle interval evicts topics idle for one to two
+     * intervals.
+     * Also evicts messages of log topics older than retention limit.
+     * @return number of erased queues
+     */
+    virtual std::size_t collectGarbage() = 0;
+
+    /**
+     * Returns number of allocated message and waiting queues
+     * @return number of queues
+     */
+    virtual std::size_t getQueuesNumber() = 0;
+
+    /**
+     * Returns statistics of every queue topic. Storage is locked only to
+     * copy the list of queues, sizes and oldest messages are read without
+     * storage lock.
+     * @return statistics of topics
+     */
+    virtual std::vector<TopicStats> getTopicStats() = 0;
 };
 
 /// Implementation of storage interface, uses RAM. Thread-safe.
 /**
  * Implementation of IMessageStorage interface
  * with RAM unordered maps and mutex.
+ * Exact topics are looked up in hash maps, wildcard patterns
+ * go through segment tries of topics and of waiting pattern subscribers,
+ * so post touches only matching subscribers in O(topic depth).
  * Thread-safe because of mutex.
  */
 class RamStorage : public IMessageStorage {
@@ -73,51 +176,381 @@ public:
 
     /**
      * Posts message to the storage. If topic is empty and
-     * there are waiting clients, sends message to one of them
-     * @param message message to post
+     * there are waiting clients, sends message to one of them.
+     * Message is stamped with enqueue time.
+     * @param message message to post, moved into the queue
      * @param tag message topic
      */
-    void postMessage(const Message& message, const std::string& tag) override;
+    void postMessage(Message message, const std::string& tag) override;
 
     /**
      * Gets message from the storage. If topic is empty, returns std::nullopt
      * Nonblocking.
-     * @param tag message topic
+     * @param tag message topic or wildcard pattern
+     * @param group consumer group, used if topic is a log topic
+     * @param info if not null, receives topic (and log offset) of
+     * returned message
      * @return message or std::nullopt if topic is empty
      */
     std::optional<Message> getMessageNonblocking(
-        const std::string& tag) override;
+        const std::string& tag, const std::string& group = "",
+        DeliveryInfo* info = nullptr) override;
 
     /**
      * Gets message from the storage.
      * Call is nonblocking.
      * If queue is empty, pushes client to the waiting queue.
-     * @param tag message topic
+     * @param tag message topic or wildcard pattern
      * @param connection clients connection (which is being pushed to waiting
      * queue if needed)
+     * @param group consumer group, used if topic is a log topic
+     * @param info if not null, receives topic (and log offset) of
+     * returned message
      * @return message or std::nullopt if topic is empty
      */
     std::optional<Message> getMessageBlocking(
-        const std::string& tag,
-        std::shared_ptr<Connection> connection) override;
+        const std::string& tag, std::shared_ptr<Connection> connection,
+        const std::string& group = "", DeliveryInfo* info = nullptr) override;
+
+    /**
+     * Gets message of wildcard pattern or, if there is none, pushes client
+     * to the waiting queue of pattern. Used to wait on several storages at
+     * once: a message is taken or the client is served only by the one
+     * which sets the claim.
+     * @param tag wildcard pattern
+     * @param connection clients connection
+     * @param claim claim shared by waits of the request
+     * @param info if not null, receives topic of returned message
+     * @return message or std::nullopt if there is none or claim is set
+     */
+    std::optional<Message> getMessageBlocking(
+        const std::string& tag, std::shared_ptr<Connection> connection,
+        const std::shared_ptr<std::atomic<bool>>& claim, DeliveryInfo* info);
+
+    /**
+     * Sets delivery mode for topics matching pattern.
+     * If several patterns match a topic, the exact one or else the longest
+     * one is used.
+     * @param pattern topic or wildcard pattern
+     * @param mode delivery mode
+     */
+    void setTopicMode(const std::string& pattern, TopicMode mode) override;
+
+    /**
+     * Sets offset of consumer group in log topic (TopicMode::Log),
+     * so the group can replay retained messages or skip them.
+     * @param tag log topic
+     * @param group consumer group
+     * @param offset new offset, clamped to offsets of retained messages
+     * @return offset which was set or std::nullopt if tag is not a log topic
+     */
+    std::optional<std::uint64_t> seekLog(const std::string& tag,
+                                         const std::string& group,
+                                         std::uint64_t offset) override;
+
+    /**
+     * Sets retention limits of log topics created after the call
+     * @param retention size and age limits
+     */
+    void setLogRetention(const LogRetention& retention) override;
+
+    /**
+     * Writes binary snapshot of all queue and log topics to file.
+     * Traffic is not stopped: every queue is copied under its own lock,
+     * so snapshot is consistent per topic.
+     * @param path path to snapshot file
+     * @return true on success
+     */
+    bool saveSnapshot(const std::string& path) override;
+
+    /**
+     * Loads binary snapshot, decoding topics in parallel. Messages are
+     * appended to the queues of their topics.
+     * @param path path to snapshot file
+     * @param threads number of threads decoding topics
+     * @return true on success
+     */
+    bool loadSnapshot(const std::string& path, unsigned int threads) override;
+
+    /**
+     * Erases message queues and waiting queues which are empty and were not
+     * used since the previous call, so ephemeral topics do not leak memory.
+     * Calling it every idle interval evicts topics idle for one to two
+     * intervals.
+     * Also evicts messages of log topics older than retention limit.
+     * @return number of erased queues
+     */
+    std::size_t collectGarbage() override;
+
+    /**
+     * Returns number of allocated message and waiting queues
+     * @return number of queues
+     */
+    std::size_t getQueuesNumber() override;
+
+    /**
+     * Returns statistics of every queue topic. Storage is locked only to
+     * copy the list of queues, sizes and oldest messages are read without
+     * storage lock.
+     * @return statistics of topics
+     */
+    std::vector<TopicStats> getTopicStats() override;
+
+    /**
+     * Adds all non-empty queue topics and all log topics to snapshot,
+     * every queue is copied under its own lock, logs are copied under
+     * storage lock
+     * @param writer writer of snapshot
+     * @return number of added messages
+     */
+    std::size_t writeSnapshot(SnapshotWriter& writer);
+
+    /**
+     * Appends messages of topic loaded from snapshot to its queue,
+     * log topic replaces content of the log
+     * @param snapshot snapshot of topic
+     */
+    void loadTopic(const TopicSnapshot& snapshot);
 
 private:
-    std::unordered_map<std::string, std::shared_ptr<IQueue<Message>>> queues_;
-    std::unordered_map<std::string,
-                       std::shared_ptr<IQueue<std::shared_ptr<Connection>>>>
-        clients_;
+    using ConnectionQueue = IQueue<std::shared_ptr<Connection>>;
+
+    /// Queue with mark of use since the last garbage collection
+    template <typename T>
+    struct TrackedQueue {
+        std::shared_ptr<IQueue<T>> queue;
+        bool used{true};
+    };
+
+    /// Message queue of topic with time spent in it by got messages
+    struct MessageQueue : TrackedQueue<Message> {
+        metrics::BucketHistogram queueTime;
+    };
+
+    /// Wait of client in waiting queue
+    struct Arrival {
+        /// order of arrival, a message goes to the client which has waited
+        /// longest
+        std::uint64_t number;
+        /// set by whoever serves the wait, shared by waits of one request
+        /// on several shards (nullptr if the wait is not shared)
+        std::shared_ptr<std::atomic<bool>> claim;
+    };
+
+    /// Clients waiting on topic or pattern with their arrivals
+    struct WaitingQueue : TrackedQueue<std::shared_ptr<Connection>> {
+        std::deque<Arrival> arrivals;
+    };
+
+    /// Broadcast subscriber with messages posted while it was not waiting,
+    /// payload of a message is shared by all subscribers
+    struct Subscription {
+        std::weak_ptr<Connection> connection;
+        std::deque<std::pair<std::string, std::shared_ptr<const Message>>>
+            pending;
+    };
+
+    /// Broadcast subscribers of topic or pattern by their connections
+    struct SubscriptionSet {
+        std::unordered_map<const Connection*, Subscription> subscribers;
+        bool used{true};
+    };
+
+    /// Log topic with clients waiting for new messages by consumer group
+    struct LogTopic {
+        MessageLog log;
+        std::unordered_map<std::string, std::shared_ptr<ConnectionQueue>>
+            waiters;
+    };
+
+    std::unordered_map<std::string, MessageQueue> queues_;
+    std::unordered_map<std::string, WaitingQueue> clients_;
+    /// values point to queues_ values, which are stable
+    TopicTrie<MessageQueue*> topics_;
+    TopicTrie<WaitingQueue> patternClients_;
+    /// arrival number of the last waiting client
+    std::uint64_t lastWaiter_{0};
+    /// clients which have got broadcast messages of topic or pattern
+    TopicTrie<SubscriptionSet> subscriptions_;
+    TopicTrie<TopicMode> topicModes_;
+    std::unordered_map<std::string, LogTopic> logs_;
+    LogRetention logRetention_;
     QueueType queueType_;
-    std::mutex mutex_;
+    ProfiledMutex mutex_{"storage"};
+    std::mutex snapshotMutex_;
+
+    /// Limit of messages pending for one broadcast subscriber, the oldest
+    /// ones are dropped above it
+    static constexpr std::size_t kMaxPendingBroadcasts = 1024;
+
+    /**
+     * Pops message from the queue with exact tag or, if tag is a pattern,
+     * from any queue with matching topic. Must be called under mutex_.
+     */
+    std::optional<Message> popMessage_(const std::string& tag,
+                                       DeliveryInfo* info);
+
+    /**
+     * Appends message to log topic and sends it to one waiting client
+     * of every consumer group. Must be called under mutex_.
+     */
+    void appendLog_(const Message& message, const std::string& tag);
+
+    /**
+     * Reads next message of consumer group from log topic, if there is none
+     * and connection is not null, pushes it to the waiting queue of group.
+     * Must be called under mutex_.
+     */
+    std::optional<Message> readLog_(const std::string& tag,
+                                    const std::string& group,
+                                    std::shared_ptr<Connection> connection,
+                                    DeliveryInfo* info);
+
+    /**
+     * Pops client waiting for tag exactly or with matching pattern.
+     * Must be called under mutex_.
+     */
+    std::shared_ptr<Connection> popWaitingClient_(const std::string& tag);
+
+    /**
+     * Pops all clients waiting for tag exactly or with matching pattern.
+     * Must be called under mutex_.
+     * @return pairs of topic or pattern waited on and client
+     */
+    std::vector<std::pair<std::string, std::shared_ptr<Connection>>>
+    popWaitingClients_(const std::string& tag);
+
+    /**
+     * Subscribes clients waiting for broadcast topic and returns them to
+     * send message to, other subscribers get the message on their next
+     * blocking get. Must be called under mutex_.
+     * @param payload message shared by subscribers
+     * @param tag broadcast topic
+     * @param subscribers number of subscribers which get the message
+     * @return waiting clients
+     */
+    std::vector<std::shared_ptr<Connection>> broadcast_(
+        const std::shared_ptr<const Message>& payload, const std::string& tag,
+        std::size_t& subscribers);
+
+    /**
+     * Finds subscription of connection to tag with pending broadcast
+     * messages. Must be called under mutex_.
+     * @return subscription or nullptr if there are no pending messages
+     */
+    Subscription* findPendingBroadcast_(const std::string& tag,
+                                        const Connection* connection);
+
+    /**
+     * Pops the oldest pending broadcast message of subscription.
+     * Must be called under mutex_.
+     */
+    static Message popPendingBroadcast_(Subscription& subscription,
+                                        DeliveryInfo* info);
+
+    /**
+     * Gets delivery mode of concrete topic. Must be called under mutex_.
+     */
+    TopicMode getTopicMode_(const std::string& tag);
+
+    /**
+     * Gets queue of tag, creates it if absent. Must be called under mutex_.
+     */
+    MessageQueue& getQueue_(const std::string& tag);
+
+    /**
+     * Records time spent in queue by got message. Must be called under mutex_.
+     */
+    static void recordQueueTime_(MessageQueue& entry, const Message& message);
+
+    /**
+     * Pushes client to the waiting queue of tag (exact or pattern).
+     * Must be called under mutex_.
+     * @param claim claim shared with waits on other storages
+     */
+    void pushWaitingClient_(
+        const std::string& tag, std::shared_ptr<Connection> connection,
+        std::shared_ptr<std::atomic<bool>> claim = nullptr);
+};
+
+/// Storage partitioned by topic between independent RAM storages
+/**
+ * Every topic is owned by one shard (see getTopicShard), requests to topic
+ * go only to its shard, so threads working with different shards do not
+ * share locks or cache lines. Server runs requests of a shard on the thread
+ * which owns it (see ShardExecutor). Wildcard patterns are not routed to
+ * one shard: nonblocking gets check shards one by one, blocking gets wait
+ * on every shard and are served by the first one with a matching message.
+ * Topic modes, retention and snapshots apply to all shards, snapshot format
+ * is the same as of RamStorage.
+ */
+class ShardedStorage : public IMessageStorage {
+public:
+    ShardedStorage() = delete;
+
+    /**
+     * Creates shards
+     * @param queueType queue type to use
+     * @param shards number of shards
+     */
+    ShardedStorage(QueueType queueType, std::size_t shards);
+
+    /**
+     * Returns shard which owns topic
+     * @param tag topic
+     * @return index of shard
+     */
+    std::size_t getShard(const std::string& tag) const;
+
+    void postMessage(Message message, const std::string& tag) override;
+
+    std::optional<Message> getMessageNonblocking(
+        const std::string& tag, const std::string& group = "",
+        DeliveryInfo* info = nullptr) override;
+
+    /**
+     * Gets message from shard of topic, see RamStorage::getMessageBlocking.
+     * Client of wildcard pattern waits on every shard, the first shard with
+     * a matching message serves it and the others drop its waits.
+     */
+    std::optional<Message> getMessageBlocking(
+        const std::string& tag, std::shared_ptr<Connection> connection,
+        const std::string& group = "", DeliveryInfo* info = nullptr) override;
+
+    void setTopicMode(const std::string& pattern, TopicMode mode) override;
+
+    std::optional<std::uint64_t> seekLog(const std::string& tag,
+                                         const std::string& group,
+                                         std::uint64_t offset) override;
+
+    void setLogRetention(const LogRetention& retention) override;
+
+    bool saveSnapshot(const std::string& path) override;
+
+    bool loadSnapshot(const std::string& path, unsigned int threads) override;
+
+    std::size_t collectGarbage() override;
+
+    std::size_t getQueuesNumber() override;
+
+    std::vector<TopicStats> getTopicStats() override;
+
+private:
+    std::vector<std::unique_ptr<RamStorage>> shards_;
+    std::mutex snapshotMutex_;
 };
 
 /**
  * Creates new message storage of given type with queues of given type
  * @param storageType type of storage to create
  * @param queueType type of queue to use
+ * @param shards number of shards, ShardedStorage is created if it is
+ * more than one
  * @return shared pointer on new storage
  */
 std::shared_ptr<IMessageStorage> createMessageStorage(StorageType storageType,
-                                                      QueueType queueType);
+                                                      QueueType queueType,
+                                                      std::size_t shards = 1);
 
 }  // namespace havka
 
@@ -0,0 +1,299 @@
+#ifndef HAVKA_SRC_SERVER_TOPIC_TRIE_HPP_
+#define HAVKA_SRC_SERVER_TOPIC_TRIE_HPP_
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace havka {
+
+/// Separator between topic segments, e.g. "orders.created.eu"
+constexpr char kTopicSeparator = '.';
+
+/// Wildcard segment matching exactly one topic segment
+constexpr const char* kSingleSegmentWildcard = "*";
+
+/// Wildcard segment matching zero or more topic segments
+constexpr const char* kMultiSegmentWildcard = "#";
+
+/**
+ * Splits topic into segments by kTopicSeparator.
+ * Empty topic is one empty segment.
+ * @param topic topic or topic pattern
+ * @return segments of topic
+ */
+inline std::vector<std::string> splitTopic(const std::string& topic) {
+    std::vector<std::string> segments;
+    std::size_t begin = 0;
+    while (true) {
+        std::size_t end = topic.find(kTopicSeparator, begin);
+        if (end == std::string::npos) {
+            segments.emplace_back(topic, begin);
+            return segments;
+        }
+        segments.emplace_back(topic, begin, end - begin);
+        begin = end + 1;
+    }
+}
+
+/**
+ * Checks if topic is a pattern, i.e. has a wildcard segment
+ * ('*' for one segment or '#' for zero or more segments)
+ * @param topic topic to check
+ * @return true if topic contains wildcard segment
+ */
+inline bool isTopicPattern(const std::string& topic) {
+    if (topic.find_first_of("*#") == std::string::npos) {
+        return false;
+    }
+    for (const auto& segment : splitTopic(topic)) {
+        if (segment == kSingleSegmentWildcard ||
+            segment == kMultiSegmentWildcard) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/// Segment trie of topics (or topic patterns) with values of type T.
+/**
+ * Keys are split into segments by kTopicSeparator, so lookups of topics
+ * and patterns cost O(topic depth) instead of a scan over all keys.
+ * Trie can be used in two ways:
+ * - keys are patterns and query is a concrete topic (forEachMatching),
+ *   e.g. to find subscribers of a posted message;
+ * - keys are concrete topics and query is a pattern (forEachMatchedBy),
+ *   e.g. to find queues with messages for a wildcard subscription.
+ * Matched keys are visited in order of their insertion, so the result
+ * does not depend on memory layout.
+ * Not thread-safe.
+ * @tparam T Type of values
+ */
+template <typename T>
+class TopicTrie {
+public:
+    TopicTrie() = default;
+    TopicTrie(const TopicTrie<T>&) = delete;
+    TopicTrie& operator=(const TopicTrie<T>&) = delete;
+
+    /**
+     * Gets value with given key, default-constructs it if absent
+     * @param key topic or pattern
+     * @return reference to value
+     */
+    T& operator[](const std::string& key) {
+        Node* node = &root_;
+        for (auto& segment : splitTopic(key)) {
+            auto& child = node->children[segment];
+            if (!child) {
+                child = std::make_unique<Node>();
+            }
+            node = child.get();
+        }
+        if (!node->value) {
+            node->value.emplace();
+            node->key = key;
+            node->sequence = nextSequence_++;
+            ++size_;
+        }
+        return *node->value;
+    }
+
+    /**
+     * Gets value with given key (exact, wildcards are not expanded)
+     * @param key topic or pattern
+     * @return pointer to value or nullptr if absent
+     */
+    T* find(const std::string& key) {
+        Node* node = &root_;
+        for (const auto& segment : splitTopic(key)) {
+            auto it = node->children.find(segment);
+            if (it == node->children.end()) {
+                return nullptr;
+            }
+            node = it->second.get();
+        }
+        return node->value ? &*node->value : nullptr;
+    }
+
+    /**
+     * Erases value with given key and prunes nodes left empty
+     * @param key topic or pattern
+     * @return true if value was erased
+     */
+    bool erase(const std::string& key) {
+        auto segments = splitTopic(key);
+        if (!erase_(&root_, segments, 0)) {
+            return false;
+        }
+        --size_;
+        return true;
+    }
+
+    /**
+     * Returns number of keys in trie
+     * @return number of keys
+     */
+    std::size_t size() const { return size_; }
+
+    /**
+     * Checks if trie has no keys
+     * @return true if trie is empty
+     */
+    bool empty() const { return size_ == 0; }
+
+    /**
+     * Calls f(key, value) for every stored pattern matching concrete topic,
+     * every key at most once. Stops when f returns true.
+     * @param topic concrete topic
+     * @param f callback bool(const std::string&, T&)
+     */
+    template <typename F>
+    void forEachMatching(const std::string& topic, F&& f) {
+        auto segments = splitTopic(topic);
+        std::vector<Node*> matched;
+        collectMatching_(&root_, segments, 0, matched);
+        visit_(matched, f);
+    }
+
+    /**
+     * Calls f(key, value) for every stored concrete topic matched by pattern,
+     * every key at most once. Stops when f returns true.
+     * @param pattern topic pattern (concrete topic works as exact lookup)
+     * @param f callback bool(const std::string&, T&)
+     */
+    template <typename F>
+    void forEachMatchedBy(const std::string& pattern, F&& f) {
+        auto segments = splitTopic(pattern);
+        std::vector<Node*> matched;
+        collectMatchedBy_(&root_, segments, 0, matched);
+        visit_(matched, f);
+    }
+
+    /**
+     * Calls f(key, value) for every stored key. Stops when f returns true.
+     * @param f callback bool(const std::string&, T&)
+     */
+    template <typename F>
+    void forEach(F&& f) {
+        std::vector<Node*> all;
+        collectAll_(&root_, all);
+        visit_(all, f);
+    }
+
+private:
+    struct Node {
+        std::unordered_map<std::string, std::unique_ptr<Node>> children;
+        std::optional<T> value;
+        std::string key;
+        /// order of insertion of key
+        std::uint64_t sequence{0};
+    };
+
+    Node root_;
+    std::size_t size_{0};
+    std::uint64_t nextSequence_{0};
+
+    static Node* child_(Node* node, const std::string& segment) {
+        auto it = node->children.find(segment);
+        return it == node->children.end() ? nullptr : it->second.get();
+    }
+
+    static void collectMatching_(Node* node,
+                                 const std::vector<std::string>& segments,
+                                 std::size_t i, std::vector<Node*>& matched) {
+        if (Node* any = child_(node, kMultiSegmentWildcard)) {
+            for (std::size_t j = i; j <= segments.size(); ++j) {
+                collectMatching_(any, segments, j, matched);
+            }
+        }
+        if (i == segments.size()) {
+            if (node->value) {
+                matched.push_back(node);
+            }
+            return;
+        }
+        if (Node* exact = child_(node, segments[i])) {
+            collectMatching_(exact, segments, i + 1, matched);
+        }
+        if (Node* one = child_(node, kSingleSegmentWildcard)) {
+            collectMatching_(one, segments, i + 1, matched);
+        }
+    }
+
+    static void collectMatchedBy_(Node* node,
+                                  const std::vector<std::string>& segments,
+                                  std::size_t i, std::vector<Node*>& matched) {
+        if (i == segments.size()) {
+            if (node->value) {
+                matched.push_back(node);
+            }
+            return;
+        }
+        if (segments[i] == kMultiSegmentWildcard) {
+            collectMatchedBy_(node, segments, i + 1, matched);
+            for (auto& [segment, child] : node->children) {
+                collectMatchedBy_(child.get(), segments, i, matched);
+            }
+        } else if (segments[i] == kSingleSegmentWildcard) {
+            for (auto& [segment, child] : node->children) {
+                collectMatchedBy_(child.get(), segments, i + 1, matched);
+            }
+        } else if (Node* exact = child_(node, segments[i])) {
+            collectMatchedBy_(exact, segments, i + 1, matched);
+        }
+    }
+
+    static void collectAll_(Node* node, std::vector<Node*>& all) {
+        if (node->value) {
+            all.push_back(node);
+        }
+        for (auto& [segment, child] : node->children) {
+            collectAll_(child.get(), all);
+        }
+    }
+
+    template <typename F>
+    static void visit_(std::vector<Node*>& nodes, F& f) {
+        /// '#' can match the same key in several ways, duplicates are
+        /// adjacent after sorting as every key has its own sequence
+        std::sort(nodes.begin(), nodes.end(), [](Node* lhs, Node* rhs) {
+            return lhs->sequence < rhs->sequence;
+        });
+        nodes.erase(std::unique(nodes.begin(), nodes.end()), nodes.end());
+        for (Node* node : nodes) {
+            if (f(node->key, *node->value)) {
+                return;
+            }
+        }
+    }
+
+    static bool erase_(Node* node, const std::vector<std::string>& segments,
+                       std::size_t i) {
+        if (i == segments.size()) {
+            if (!node->value) {
+                return false;
+            }
+            node->value.reset();
+            node->key.clear();
+            return true;
+        }
+        auto it = node->children.find(segments[i]);
+        if (it == node->children.end() ||
+            !erase_(it->second.get(), segments, i + 1)) {
+            return false;
+        }
+        if (!it->second->value && it->second->children.empty()) {
+            node->children.erase(it);
+        }
+        return true;
+    }
+};
+
+}  // namespace havka
+
+#endif  // HAVKA_SRC_SERVER_TOPIC_TRIE_HPP_
@@ -0,0 +1,71 @@
+#include "server/trace.h"
+
+#include <atomic>
+#include <limits>
+#include <sstream>
+
+namespace havka::trace {
+
+namespace {
+
+std::atomic<bool> enabled{false};
+std::atomic<std::uint64_t> slowThresholdNs{
+    std::numeric_limits<std::uint64_t>::max()};
+std::atomic<std::uint32_t> slowSample{1};
+std::atomic<std::uint64_t> slowRequests{0};
+
+thread_local std::uint64_t lockWaitNs = 0;
+
+}  // namespace
+
+void setEnabled(bool value) { enabled = value; }
+
+bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+
+void setSlowRequestLog(std::chrono::microseconds threshold,
+                       std::uint32_t sample) {
+    if (threshold.count() < 0) {
+        slowThresholdNs = std::numeric_limits<std::uint64_t>::max();
+    } else {
+        slowThresholdNs =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(threshold)
+                .count();
+    }
+    slowSample = sample > 0 ? sample : 1;
+}
+
+void addLockWait(std::uint64_t wait) { lockWaitNs += wait; }
+
+std::uint64_t takeLockWait() {
+    auto wait = lockWaitNs;
+    lockWaitNs = 0;
+    return wait;
+}
+
+bool shouldLog(const RequestTrace& requestTrace) {
+    if (!isEnabled() || requestTrace.written - requestTrace.received <
+                            slowThresholdNs.load(std::memory_order_relaxed)) {
+        return false;
+    }
+    return slowRequests.fetch_add(1, std::memory_order_relaxed) %
+               slowSample.load(std::memory_order_relaxed) ==
+           0;
+}
+
+std::string format(const RequestTrace& requestTrace,
+                   const std::string& topic) {
+    auto us = [](std::uint64_t from, std::uint64_t to) {
+        return (to - from) / 1000;
+    };
+    std::ostringstream out;
+    out << getStringFromRequestType(requestTrace.type) << " '" << topic
+        << "' total " << us(requestTrace.received, requestTrace.written)
+        << "us: decode " << us(requestTrace.received, requestTrace.decoded)
+        << "us, lock_wait " << requestTrace.lockWait / 1000 << "us, storage "
+        << us(requestTrace.decoded, requestTrace.processed) << "us, encode "
+        << us(requestTrace.processed, requestTrace.encoded) << "us, write "
+        << us(requestTrace.encoded, requestTrace.written) << "us";
+    return out.str();
+}
+
+}  // namespace havka::trace
@@ -0,0 +1,113 @@
+#ifndef HAVKA_SRC_SERVER_TRACE_H_
+#define HAVKA_SRC_SERVER_TRACE_H_
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+#include "message.hpp"
+#include "metrics.h"
+
+/// Namespace with optional per-stage tracing of requests
+/**
+ * Connection always takes timestamps of request stages for latency
+ * histograms. If tracing is enabled, it also measures time spent waiting
+ * for the storage lock and writes a breakdown of requests slower than
+ * the threshold to the log.
+ */
+namespace havka::trace {
+
+/// Timestamps of stages of one request, nanoseconds of metrics::getNowNs()
+struct RequestTrace {
+    RequestType type;
+
+    /// Request was read from socket
+    std::uint64_t received{0};
+    std::uint64_t decoded{0};
+    /// Storage operation was finished
+    std::uint64_t processed{0};
+    std::uint64_t encoded{0};
+    /// Response was written to socket
+    std::uint64_t written{0};
+
+    /// Time spent waiting for storage lock (part of storage stage),
+    /// measured only if tracing is enabled
+    std::uint64_t lockWait{0};
+};
+
+/**
+ * Enables or disables tracing
+ * @param enabled true to measure lock waits and log slow requests
+ */
+void setEnabled(bool enabled);
+
+/**
+ * Checks if tracing is enabled
+ * @return true if tracing is enabled
+ */
+bool isEnabled();
+
+/**
+ * Sets threshold of slow requests and sampling of their log lines
+ * @param threshold requests with larger total time are slow,
+ * negative threshold disables slow request log
+ * @param sample every sample-th slow request is written to the log
+ */
+void setSlowRequestLog(std::chrono::microseconds threshold,
+                       std::uint32_t sample);
+
+/**
+ * Adds lock waiting time to the current request of the thread
+ * @param wait time in nanoseconds
+ */
+void addLockWait(std::uint64_t wait);
+
+/**
+ * Locks mutex, adds waiting time to the current request of the thread
+ * if tracing is enabled
+ * @param mutex mutex to lock
+ * @return owning lock
+ */
+template <typename Mutex>
+std::unique_lock<Mutex> lock(Mutex& mutex) {
+    if (!isEnabled()) {
+        return std::unique_lock<Mutex>(mutex);
+    }
+    std::unique_lock<Mutex> guard(mutex, std::try_to_lock);
+    if (!guard) {
+        auto start = metrics::getNowNs();
+        guard.lock();
+        addLockWait(metrics::getNowNs() - start);
+    }
+    return guard;
+}
+
+/**
+ * Returns lock waiting time of the current thread since the previous call
+ * and resets it
+ * @return time in nanoseconds
+ */
+std::uint64_t takeLockWait();
+
+/**
+ * Checks if finished request is slow and its log line is sampled
+ * @param requestTrace timestamps of request
+ * @return true if request should be written to the log
+ */
+bool shouldLog(const RequestTrace& requestTrace);
+
+/**
+ * Formats stage breakdown of request, for example
+ * "RequestType::PostMessageSafe 'orders' total 1520us: decode 3us,
+ * lock_wait 1400us, storage 1450us, encode 2us, write 65us"
+ * @param requestTrace timestamps of request
+ * @param topic topic of request
+ * @return description of request
+ */
+std::string format(const RequestTrace& requestTrace,
+                   const std::string& topic);
+
+}  // namespace havka::trace
+
+#endif  // HAVKA_SRC_SERVER_TRACE_H_
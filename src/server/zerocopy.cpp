@@ -0,0 +1,62 @@
+#include "server/zerocopy.h"
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <time.h>
+/// needs timespec of <time.h>
+#include <linux/errqueue.h>
+
+#include <cstring>
+
+namespace havka::zerocopy {
+
+#if defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY)
+const int kSendFlag = MSG_ZEROCOPY;
+
+bool enable(int fd) {
+    int one = 1;
+    return setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) == 0;
+}
+
+Completions readCompletions(int fd) {
+    Completions completions;
+    while (true) {
+        char control[128];
+        msghdr message{};
+        message.msg_control = control;
+        message.msg_controllen = sizeof(control);
+        if (recvmsg(fd, &message, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+            break;
+        }
+        for (auto header = CMSG_FIRSTHDR(&message); header != nullptr;
+             header = CMSG_NXTHDR(&message, header)) {
+            if (!(header->cmsg_level == SOL_IP &&
+                  header->cmsg_type == IP_RECVERR) &&
+                !(header->cmsg_level == SOL_IPV6 &&
+                  header->cmsg_type == IPV6_RECVERR)) {
+                continue;
+            }
+            sock_extended_err error{};
+            std::memcpy(&error, CMSG_DATA(header), sizeof(error));
+            if (error.ee_origin != SO_EE_ORIGIN_ZEROCOPY ||
+                error.ee_errno != 0) {
+                continue;
+            }
+            /// sequence numbers of completed sends, inclusive
+            completions.count += error.ee_data - error.ee_info + 1;
+            if (error.ee_code & SO_EE_CODE_ZEROCOPY_COPIED) {
+                completions.copied = true;
+            }
+        }
+    }
+    return completions;
+}
+#else
+const int kSendFlag = 0;
+
+bool enable(int /* fd */) { return false; }
+
+Completions readCompletions(int /* fd */) { return {}; }
+#endif
+
+}  // namespace havka::zerocopy
@@ -0,0 +1,45 @@
+#ifndef HAVKA_SRC_SERVER_ZEROCOPY_H_
+#define HAVKA_SRC_SERVER_ZEROCOPY_H_
+
+#include <cstdint>
+
+/// Namespace with helpers of MSG_ZEROCOPY sends (Linux 4.14+)
+/**
+ * A send with MSG_ZEROCOPY pins pages of the buffer instead of copying
+ * them into the kernel, so the buffer must not change until the kernel
+ * reports that it has released the pages. Every successful zerocopy send
+ * of a socket gets the next sequence number, and completions are read
+ * from the error queue of the socket as ranges of these numbers.
+ */
+namespace havka::zerocopy {
+
+/// Flag of send to pass with zerocopy sends, 0 if it is not supported
+extern const int kSendFlag;
+
+/// Completions read from error queue
+struct Completions {
+    /// number of completed sends
+    std::uint32_t count{0};
+    /// kernel copied data of some sends (e.g. loopback), zerocopy does not
+    /// pay off on the socket
+    bool copied{false};
+};
+
+/**
+ * Enables zerocopy sends on TCP socket
+ * @param fd descriptor of socket
+ * @return false if the system or the socket does not support it
+ */
+bool enable(int fd);
+
+/**
+ * Reads all completions waiting in error queue of socket.
+ * Non-blocking
+ * @param fd descriptor of socket
+ * @return completed sends
+ */
+Completions readCompletions(int fd);
+
+}  // namespace havka::zerocopy
+
+#endif  // HAVKA_SRC_SERVER_ZEROCOPY_H_
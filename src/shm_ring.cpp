@@ -0,0 +1,285 @@
+#include "shm_ring.h"
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <new>
+#include <thread>
+
+namespace havka {
+
+namespace {
+
+/// Time of spinning before sleeping on futex
+constexpr auto kSpinTime = std::chrono::microseconds(50);
+
+/// "HVKSHM" + version 1
+constexpr std::uint64_t kChannelMagic = 0x0100'4d48'534b'5648ULL;
+
+/// Control block at the start of channel memory
+struct ChannelHeader {
+    alignas(64) std::uint64_t magic;
+    std::uint64_t capacity;
+    std::atomic<std::uint32_t> closed;
+};
+
+void pause() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+/// Futex word must be shared between processes, so futex is not private
+void futexWait(std::atomic<std::uint32_t>& word, std::uint32_t value,
+               std::chrono::milliseconds timeout) {
+    timespec time{};
+    time.tv_sec = timeout.count() / 1000;
+    time.tv_nsec = (timeout.count() % 1000) * 1000000;
+    syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word), FUTEX_WAIT,
+            value, &time, nullptr, 0);
+}
+
+void futexWake(std::atomic<std::uint32_t>& word) {
+    syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word), FUTEX_WAKE, 1,
+            nullptr, nullptr, 0);
+}
+
+}  // namespace
+
+ShmRing::ShmRing(void* memory, std::size_t capacity, bool init)
+    : header_(static_cast<Header*>(memory)),
+      data_(static_cast<char*>(memory) + sizeof(Header)),
+      capacity_(capacity) {
+    if (init) {
+        new (header_) Header();
+        header_->head.store(0);
+        header_->tail.store(0);
+        header_->waiting.store(0);
+        header_->signal.store(0);
+    }
+}
+
+std::size_t ShmRing::getMemorySize(std::size_t capacity) {
+    return sizeof(Header) + capacity;
+}
+
+std::size_t ShmRing::getCapacity() const { return capacity_; }
+
+bool ShmRing::push(const char* data, std::size_t size) {
+    iovec part{const_cast<char*>(data), size};
+    return push(&part, 1);
+}
+
+bool ShmRing::push(const iovec* parts, std::size_t count) {
+    std::size_t size = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        size += parts[i].iov_len;
+    }
+    std::uint32_t length = size;
+    if (broken_) {
+        return false;
+    }
+    auto tail = header_->tail.load(std::memory_order_relaxed);
+    auto head = header_->head.load(std::memory_order_acquire);
+    /// head is written by the other process, frame must fit even into
+    /// the empty ring
+    if (tail - head > capacity_ || sizeof(length) + size > capacity_) {
+        broken_ = true;
+        return false;
+    }
+    if (capacity_ - (tail - head) < sizeof(length) + size) {
+        return false;
+    }
+    copyIn_(tail, reinterpret_cast<const char*>(&length), sizeof(length));
+    auto position = tail + sizeof(length);
+    for (std::size_t i = 0; i < count; ++i) {
+        copyIn_(position, static_cast<const char*>(parts[i].iov_base),
+                parts[i].iov_len);
+        position += parts[i].iov_len;
+    }
+    header_->tail.store(position, std::memory_order_release);
+    /// pairs with the fence in wait: either consumer sees the frame or
+    /// producer sees that consumer sleeps
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (header_->waiting.load(std::memory_order_relaxed)) {
+        notify();
+    }
+    return true;
+}
+
+bool ShmRing::pop(char* data, std::size_t maxSize, std::size_t& size) {
+    auto head = header_->head.load(std::memory_order_relaxed);
+    auto tail = header_->tail.load(std::memory_order_acquire);
+    if (broken_ || head == tail) {
+        return false;
+    }
+    std::uint32_t length;
+    if (tail - head > capacity_ || tail - head < sizeof(length)) {
+        broken_ = true;
+        return false;
+    }
+    copyOut_(head, reinterpret_cast<char*>(&length), sizeof(length));
+    if (length > tail - head - sizeof(length)) {
+        broken_ = true;
+        return false;
+    }
+    size = std::min<std::size_t>(length, maxSize);
+    copyOut_(head + sizeof(length), data, size);
+    header_->head.store(head + sizeof(length) + length,
+                        std::memory_order_release);
+    return true;
+}
+
+bool ShmRing::isBroken() const { return broken_; }
+
+bool ShmRing::empty() const {
+    return header_->head.load(std::memory_order_relaxed) ==
+           header_->tail.load(std::memory_order_acquire);
+}
+
+bool ShmRing::wait(std::chrono::milliseconds timeout) {
+    /// spinning on the only CPU delays the producer
+    static const auto spinTime = std::thread::hardware_concurrency() > 1
+                                     ? kSpinTime
+                                     : std::chrono::microseconds(0);
+    auto spinEnd = std::chrono::steady_clock::now() + spinTime;
+    while (empty()) {
+        for (int i = 0; i < 64; ++i) {
+            pause();
+        }
+        if (std::chrono::steady_clock::now() < spinEnd) {
+            continue;
+        }
+        auto signal = header_->signal.load();
+        header_->waiting.store(1);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (empty()) {
+            futexWait(header_->signal, signal, timeout);
+        }
+        header_->waiting.store(0);
+        return !empty();
+    }
+    return true;
+}
+
+void ShmRing::notify() {
+    header_->signal.fetch_add(1);
+    futexWake(header_->signal);
+}
+
+void ShmRing::copyIn_(std::uint64_t position, const char* data,
+                      std::size_t size) {
+    auto offset = position & (capacity_ - 1);
+    auto first = std::min(size, capacity_ - offset);
+    std::memcpy(data_ + offset, data, first);
+    std::memcpy(data_, data + first, size - first);
+}
+
+void ShmRing::copyOut_(std::uint64_t position, char* data,
+                       std::size_t size) const {
+    auto offset = position & (capacity_ - 1);
+    auto first = std::min(size, capacity_ - offset);
+    std::memcpy(data, data_ + offset, first);
+    std::memcpy(data + first, data_, size - first);
+}
+
+ShmChannel::ShmChannel(const std::string& name, std::size_t capacity)
+    : memory_(nullptr), size_(0) {
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+        return;
+    }
+    if (!map_(fd, capacity)) {
+        shm_unlink(name.c_str());
+    }
+    ::close(fd);
+}
+
+ShmChannel::ShmChannel(const std::string& name)
+    : memory_(nullptr), size_(0) {
+    int fd = shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0) {
+        return;
+    }
+    map_(fd, 0);
+    ::close(fd);
+}
+
+ShmChannel::~ShmChannel() {
+    if (memory_) {
+        munmap(memory_, size_);
+    }
+}
+
+bool ShmChannel::good() const { return memory_ != nullptr; }
+
+void ShmChannel::unlink(const std::string& name) {
+    shm_unlink(name.c_str());
+}
+
+ShmRing& ShmChannel::getRequests() { return requests_; }
+
+ShmRing& ShmChannel::getResponses() { return responses_; }
+
+void ShmChannel::close() {
+    static_cast<ChannelHeader*>(memory_)->closed.store(1);
+    requests_.notify();
+    responses_.notify();
+}
+
+bool ShmChannel::isClosed() const {
+    return static_cast<ChannelHeader*>(memory_)->closed.load() != 0 ||
+           requests_.isBroken() || responses_.isBroken();
+}
+
+bool ShmChannel::map_(int fd, std::size_t capacity) {
+    bool init = capacity != 0;
+    if (init) {
+        size_ = sizeof(ChannelHeader) + 2 * ShmRing::getMemorySize(capacity);
+        if (ftruncate(fd, size_) != 0) {
+            return false;
+        }
+    } else {
+        struct stat info {};
+        if (fstat(fd, &info) != 0 ||
+            static_cast<std::size_t>(info.st_size) < sizeof(ChannelHeader)) {
+            return false;
+        }
+        size_ = info.st_size;
+    }
+    void* memory =
+        mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (memory == MAP_FAILED) {
+        return false;
+    }
+    auto header = static_cast<ChannelHeader*>(memory);
+    if (init) {
+        header->magic = kChannelMagic;
+        header->capacity = capacity;
+        new (&header->closed) std::atomic<std::uint32_t>(0);
+    } else {
+        capacity = header->capacity;
+        if (header->magic != kChannelMagic || capacity == 0 ||
+            (capacity & (capacity - 1)) != 0 ||
+            size_ != sizeof(ChannelHeader) +
+                         2 * ShmRing::getMemorySize(capacity)) {
+            munmap(memory, size_);
+            return false;
+        }
+    }
+    auto rings = static_cast<char*>(memory) + sizeof(ChannelHeader);
+    requests_ = ShmRing(rings, capacity, init);
+    responses_ = ShmRing(rings + ShmRing::getMemorySize(capacity), capacity,
+                         init);
+    memory_ = memory;
+    return true;
+}
+
+}  // namespace havka
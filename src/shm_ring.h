@@ -0,0 +1,210 @@
+#ifndef HAVKA_SRC_SHM_RING_H_
+#define HAVKA_SRC_SHM_RING_H_
+
+#include <sys/uio.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace havka {
+
+/// Bounded queue of frames of one producer and one consumer process
+/**
+ * Ring lives in memory shared by two processes, so it has no pointers
+ * and only lock-free atomics. Every frame is its length (u32) and bytes,
+ * frames wrap around the end of ring. Consumer spins for a while before
+ * sleeping on futex, and producer makes a syscall only if consumer sleeps,
+ * so a busy pair of processes exchanges frames without syscalls.
+ */
+class ShmRing {
+public:
+    /// Control block at the start of ring memory
+    struct Header {
+        alignas(64) std::atomic<std::uint64_t> head;
+        alignas(64) std::atomic<std::uint64_t> tail;
+        /// consumer sleeps or is going to sleep on signal
+        alignas(64) std::atomic<std::uint32_t> waiting;
+        /// futex word, incremented by producer to wake consumer
+        std::atomic<std::uint32_t> signal;
+    };
+
+    ShmRing() = default;
+
+    /**
+     * Attaches ring to memory
+     * @param memory memory of getMemorySize(capacity) bytes
+     * @param capacity size of data area, power of two
+     * @param init true to reset control block (done by the creator)
+     */
+    ShmRing(void* memory, std::size_t capacity, bool init);
+
+    /**
+     * Returns size of memory of ring
+     * @param capacity size of data area
+     * @return size in bytes
+     */
+    static std::size_t getMemorySize(std::size_t capacity);
+
+    /**
+     * Returns size of data area, frame with its length must fit into it
+     * @return capacity in bytes
+     */
+    std::size_t getCapacity() const;
+
+    /**
+     * Pushes frame if there is space for it and wakes consumer if it
+     * sleeps. Called only by producer. Head is written by the other
+     * process, so head which is ahead of tail by more than capacity or
+     * frame which can never fit breaks the ring.
+     * @param data frame bytes
+     * @param size frame size
+     * @return false if ring does not have space for the frame or is broken
+     */
+    bool push(const char* data, std::size_t size);
+
+    /**
+     * Pushes frame gathered from parts if there is space for it and wakes
+     * consumer if it sleeps. Called only by producer.
+     * @param parts parts of frame
+     * @param count number of parts
+     * @return false if ring does not have space for the frame or is broken
+     */
+    bool push(const iovec* parts, std::size_t count);
+
+    /**
+     * Pops frame if ring is not empty. Called only by consumer.
+     * Length of frame is written by the other process, so a frame which
+     * does not fit between head and tail breaks the ring.
+     * @param data buffer for frame
+     * @param maxSize size of buffer, longer frames are truncated
+     * @param size size of popped frame (at most maxSize)
+     * @return false if ring is empty or broken
+     */
+    bool pop(char* data, std::size_t maxSize, std::size_t& size);
+
+    /**
+     * Checks if consumer has found a frame with invalid length or producer
+     * has found invalid head or too large frame, nothing is pushed to or
+     * popped from broken ring
+     * @return true if ring is broken
+     */
+    bool isBroken() const;
+
+    /**
+     * Checks if ring has frames. Exact only for consumer.
+     * @return true if there are no frames
+     */
+    bool empty() const;
+
+    /**
+     * Waits until ring is not empty: spins first, then sleeps on futex.
+     * Called only by consumer.
+     * @param timeout maximal time of sleeping
+     * @return false if ring is still empty
+     */
+    bool wait(std::chrono::milliseconds timeout);
+
+    /**
+     * Wakes consumer if it sleeps, e.g. to make it check if the other
+     * side was closed
+     */
+    void notify();
+
+private:
+    Header* header_{nullptr};
+    char* data_{nullptr};
+    std::size_t capacity_{0};
+    /// local to this side, other side learns it from closed channel
+    bool broken_{false};
+
+    void copyIn_(std::uint64_t position, const char* data, std::size_t size);
+
+    void copyOut_(std::uint64_t position, char* data, std::size_t size) const;
+};
+
+/// Pair of rings of one client in a shared memory object (/dev/shm)
+/**
+ * Server creates the object, sends its name to the client which opens it
+ * and then removes the name, so the memory is freed when both sides
+ * unmap it. Requests ring is written by client, responses ring by server.
+ * Either side sets closed flag when it leaves.
+ */
+class ShmChannel {
+public:
+    ShmChannel() = delete;
+    ShmChannel(const ShmChannel&) = delete;
+    ShmChannel& operator=(const ShmChannel&) = delete;
+
+    /**
+     * Creates shared memory object and maps it
+     * @param name name of object, e.g. "/havka-1"
+     * @param capacity size of data area of every ring, power of two
+     */
+    ShmChannel(const std::string& name, std::size_t capacity);
+
+    /**
+     * Maps existing shared memory object
+     * @param name name of object
+     */
+    explicit ShmChannel(const std::string& name);
+
+    /**
+     * Unmaps memory
+     */
+    ~ShmChannel();
+
+    /**
+     * Checks if object was created or opened and mapped
+     * @return true if channel is usable
+     */
+    bool good() const;
+
+    /**
+     * Removes name of shared memory object
+     * @param name name of object
+     */
+    static void unlink(const std::string& name);
+
+    /**
+     * Returns ring of requests from client to server
+     * @return ring of requests
+     */
+    ShmRing& getRequests();
+
+    /**
+     * Returns ring of responses from server to client
+     * @return ring of responses
+     */
+    ShmRing& getResponses();
+
+    /**
+     * Marks channel as closed and wakes both sides
+     */
+    void close();
+
+    /**
+     * Checks if some side closed channel or one of rings is broken
+     * @return true if channel is closed
+     */
+    bool isClosed() const;
+
+private:
+    void* memory_;
+    std::size_t size_;
+    ShmRing requests_;
+    ShmRing responses_;
+
+    /**
+     * Maps object and attaches rings
+     * @param fd descriptor of object
+     * @param capacity capacity of rings, 0 to read it from the object
+     * @return true on success
+     */
+    bool map_(int fd, std::size_t capacity);
+};
+
+}  // namespace havka
+
+#endif  // HAVKA_SRC_SHM_RING_H_
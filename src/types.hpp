@@ -54,4 +54,73 @@ inline std::string getStringFromStorageType(StorageType storageType) {
     }
 }
 
+/**
+ * Enum for delivery mode of topic
+ */
+enum class TopicMode {
+    /// Work queue: every message is delivered to exactly one consumer
+    Queue,
+
+    /// Fan-out: every message is delivered to all subscribers (clients
+    /// which have got the topic with blocking get), dropped if there are
+    /// none
+    Broadcast,
+
+    /// Retained log: messages are kept by size/time limits, every consumer
+    /// group reads all messages with its own offset and can seek to replay
+    Log,
+};
+
+inline TopicMode getTopicModeFromString(const std::string& name) {
+    if (name == "queue") {
+        return TopicMode::Queue;
+    } else if (name == "broadcast") {
+        return TopicMode::Broadcast;
+    } else if (name == "log") {
+        return TopicMode::Log;
+    } else {
+        LOG_ERROR("Returning TopicMode::Queue from string '" << name << "'");
+        return TopicMode::Queue;
+    }
+}
+
+inline std::string getStringFromTopicMode(TopicMode topicMode) {
+    switch (topicMode) {
+        case TopicMode::Queue:
+            return "TopicMode::Queue";
+        case TopicMode::Broadcast:
+            return "TopicMode::Broadcast";
+        case TopicMode::Log:
+            return "TopicMode::Log";
+        default:
+            return "Unknown TopicMode";
+    }
+}
+
+inline havka::log::Level getLogLevelFromString(const std::string& name) {
+    if (name == "info") {
+        return havka::log::Level::Info;
+    } else if (name == "warning") {
+        return havka::log::Level::Warning;
+    } else if (name == "error") {
+        return havka::log::Level::Error;
+    } else {
+        LOG_ERROR("Returning log::Level::Info from string '" << name << "'");
+        return havka::log::Level::Info;
+    }
+}
+
+inline std::string getStringFromLogLevel(havka::log::Level level) {
+    switch (level) {
+        case havka::log::Level::Info:
+            return "log::Level::Info";
+        case havka::log::Level::Warning:
+            return "log::Level::Warning";
+        case havka::log::Level::Error:
+            return "log::Level::Error";
+        default:
+            return "Unknown log::Level";
+    }
+}
+
 #endif  // HAVKA_SRC_TYPES_H_
\ No newline at end of file
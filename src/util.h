@@ -5,13 +5,17 @@
 
 #include <iostream>
 
+#include "log.h"
+
 /// Defines for server monitoring (info about new clients, requests and errors)
+/// Lines are written asynchronously, see log.h
 
 #ifdef MONITORING
 
-#define LOG_INFO(msg) std::cerr << "[INFO] " << msg << '\n'
-#define LOG_WARNING(msg) std::cerr << "[WARNING] " << msg << '\n'
-#define LOG_ERROR(msg) std::cerr << "[ERROR] " << msg << '\n'
+#define LOG_INFO(msg) HAVKA_LOG(::havka::log::Level::Info, "[INFO] ", msg)
+#define LOG_WARNING(msg) \
+    HAVKA_LOG(::havka::log::Level::Warning, "[WARNING] ", msg)
+#define LOG_ERROR(msg) HAVKA_LOG(::havka::log::Level::Error, "[ERROR] ", msg)
 
 #else
 
@@ -21,9 +25,13 @@
 
 #endif
 
-#define LOG_FATAL(msg)                      \
-    std::cerr << "[FATAL] " << msg << '\n'; \
-    exit(1)
+/// Fatal lines are written synchronously after pending asynchronous lines
+#define LOG_FATAL(msg)                               \
+    do {                                             \
+        ::havka::log::flush();                       \
+        std::cerr << "[FATAL] " << msg << std::endl; \
+        exit(1);                                     \
+    } while (0)
 
 /// Function for checking if file with given path exists
 inline bool IsFileExisting(const std::string &sPath) {
@@ -31,25 +39,4 @@ inline bool IsFileExisting(const std::string &sPath) {
     return (stat(sPath.c_str(), &buffer) == 0);
 }
 
-/// Namespace with utility functions to measure time. Not recommended to use.
-/**
- * Namespace with utility functions to measure time.
- * Not recommended to use.
- */
-namespace havka::time_measure {
-
-void start1();
-void stopAdd1();
-double getTime1();
-
-void start2();
-void stopAdd2();
-double getTime2();
-
-void start3();
-void stopAdd3();
-double getTime3();
-
-}  // namespace havka::time_measure
-
 #endif  // HAVKA_SRC_UTIL_H_
\ No newline at end of file
@@ -0,0 +1,85 @@
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "buffer_pool.h"
+
+TEST(BufferPoolTest, SizeClassTest) {
+    havka::BufferPool pool;
+    std::size_t size = 1;
+    auto small = pool.acquire(size);
+    ASSERT_EQ(size, havka::BufferPool::kMinSize);
+    size = 5000;
+    auto medium = pool.acquire(size);
+    ASSERT_EQ(size, 8192);
+    pool.release(medium, size);
+    ASSERT_EQ(pool.getFreeBytes(), 8192);
+
+    /// buffer of the same class is reused
+    size = 8000;
+    ASSERT_EQ(pool.acquire(size), medium);
+    ASSERT_EQ(pool.getFreeBytes(), 0);
+    pool.release(medium, size);
+    pool.release(small, havka::BufferPool::kMinSize);
+    ASSERT_EQ(pool.getFreeBytes(), 8192 + havka::BufferPool::kMinSize);
+
+    /// buffers larger than the largest class are not pooled
+    size = havka::BufferPool::kMaxSize + 1;
+    auto huge = pool.acquire(size);
+    ASSERT_EQ(size, havka::BufferPool::kMaxSize + 1);
+    pool.release(huge, size);
+    ASSERT_EQ(pool.getFreeBytes(), 8192 + havka::BufferPool::kMinSize);
+}
+
+TEST(BufferPoolTest, FreeBytesLimitTest) {
+    havka::BufferPool pool;
+    const std::size_t SIZE = 4 << 20;
+    const std::size_t COUNT = havka::BufferPool::kMaxFreeBytes / SIZE + 2;
+    std::vector<char*> buffers;
+    for (std::size_t i = 0; i < COUNT; ++i) {
+        auto size = SIZE;
+        buffers.push_back(pool.acquire(size));
+    }
+    for (auto data : buffers) {
+        pool.release(data, SIZE);
+    }
+    ASSERT_EQ(pool.getFreeBytes(), havka::BufferPool::kMaxFreeBytes);
+
+    /// limit is shared by all classes
+    auto size = havka::BufferPool::kMinSize;
+    auto data = pool.acquire(size);
+    pool.release(data, size);
+    ASSERT_EQ(pool.getFreeBytes(), havka::BufferPool::kMaxFreeBytes);
+
+    /// buffers larger than the limit are never kept
+    havka::BufferPool empty;
+    size = havka::BufferPool::kMaxSize;
+    data = empty.acquire(size);
+    empty.release(data, size);
+    ASSERT_EQ(empty.getFreeBytes(), 0);
+}
+
+TEST(BufferPoolTest, PooledBufferTest) {
+    havka::PooledBuffer buffer;
+    ASSERT_EQ(buffer.capacity(), 0);
+    buffer.reserve(10);
+    ASSERT_EQ(buffer.capacity(), havka::BufferPool::kMinSize);
+    std::memcpy(buffer.data(), "0123456789", 10);
+
+    /// growing keeps the first bytes
+    buffer.reserve(100000, 4);
+    ASSERT_EQ(buffer.capacity(), 131072);
+    ASSERT_EQ(std::string(buffer.data(), 4), "0123");
+    buffer.reserve(10);
+    ASSERT_EQ(buffer.capacity(), 131072);
+
+    havka::PooledBuffer other(std::move(buffer));
+    ASSERT_EQ(buffer.capacity(), 0);
+    ASSERT_EQ(other.capacity(), 131072);
+    other.release();
+    ASSERT_EQ(other.capacity(), 0);
+    ASSERT_EQ(other.data(), nullptr);
+}
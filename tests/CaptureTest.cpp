@@ -0,0 +1,64 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+
+#include "server/capture.h"
+
+namespace {
+class CaptureTest : public testing::Test {
+public:
+    const std::string path = "capture_test.bin";
+
+    ~CaptureTest() override { std::remove(path.c_str()); }
+};
+}  // namespace
+
+TEST_F(CaptureTest, WriteReadTest) {
+    havka::Request post;
+    post.type = havka::RequestType::PostMessageSafe;
+    post.topic = "orders.created";
+    post.message = havka::Message();
+    post.message->setData("12345", 5, havka::MessageDataType::Text);
+
+    havka::Request get;
+    get.type = havka::RequestType::GetMessageBlocking;
+    get.topic = "orders.#";
+    get.group = "billing";
+    {
+        havka::CaptureWriter writer(path);
+        ASSERT_TRUE(writer.good());
+        writer.write(1, post);
+        writer.write(2, get);
+    }
+
+    havka::CaptureReader reader(path);
+    ASSERT_TRUE(reader.good());
+    ASSERT_GT(reader.getStartTime(), 0);
+    havka::CaptureRecord record;
+    ASSERT_TRUE(reader.next(record));
+    ASSERT_EQ(record.connection, 1);
+    ASSERT_EQ(record.type, havka::RequestType::PostMessageSafe);
+    ASSERT_EQ(record.payloadSize, 5);
+    ASSERT_EQ(record.topic, "orders.created");
+    ASSERT_EQ(record.group, "");
+    auto postTime = record.time;
+
+    ASSERT_TRUE(reader.next(record));
+    ASSERT_EQ(record.connection, 2);
+    ASSERT_EQ(record.type, havka::RequestType::GetMessageBlocking);
+    ASSERT_EQ(record.payloadSize, 0);
+    ASSERT_EQ(record.topic, "orders.#");
+    ASSERT_EQ(record.group, "billing");
+    ASSERT_GE(record.time, postTime);
+    ASSERT_FALSE(reader.next(record));
+}
+
+TEST_F(CaptureTest, InvalidFileTest) {
+    ASSERT_FALSE(havka::CaptureReader("capture_not_existing.bin").good());
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file << "not a capture file at all";
+    file.close();
+    ASSERT_FALSE(havka::CaptureReader(path).good());
+}
@@ -0,0 +1,101 @@
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "codec.hpp"
+
+namespace {
+
+void checkSplitEncode(const havka::Response& response) {
+    std::string head, tail;
+    havka::encode(response, head, tail);
+    std::string data = response.message ? response.message->data : "";
+    ASSERT_EQ(head + data + tail, havka::encode(response));
+}
+
+}  // namespace
+
+TEST(CodecTest, SplitResponseTest) {
+    havka::Response response;
+    response.type = havka::ResponseType::PostSuccess;
+    response.topic = "topic";
+    checkSplitEncode(response);
+
+    response.message = havka::Message();
+    response.type = havka::ResponseType::GetSuccess;
+    checkSplitEncode(response);
+
+    response.message->setData("payload", 7, havka::MessageDataType::Text);
+    response.offset = 42;
+    response.enqueueTime = 1234567;
+    checkSplitEncode(response);
+
+    response.message->data = std::string(1 << 20, 'x');
+    checkSplitEncode(response);
+
+    havka::Response decoded;
+    std::string head, tail;
+    havka::encode(response, head, tail);
+    auto frame = head + response.message->data + tail;
+    havka::decode(frame.data(), frame.size(), decoded);
+    ASSERT_TRUE(decoded.message);
+    ASSERT_EQ(decoded.message->data, response.message->data);
+    ASSERT_EQ(decoded.topic, "topic");
+    ASSERT_EQ(decoded.offset, 42);
+}
+
+TEST(CodecTest, FrameTest) {
+    auto header = havka::encodeFrameHeader(0x01020304);
+    ASSERT_EQ(header.size(), havka::kFrameHeaderSize);
+    /// length is little-endian
+    ASSERT_EQ(header, std::string("\x04\x03\x02\x01", 4));
+    ASSERT_EQ(havka::decodeFrameHeader(header.data()), 0x01020304);
+
+    havka::Request request;
+    request.type = havka::RequestType::PostMessageSafe;
+    request.topic = "topic";
+    auto frame = havka::encodeFrame(request);
+    auto body = havka::encode(request);
+    ASSERT_EQ(havka::decodeFrameHeader(frame.data()), body.size());
+    ASSERT_EQ(frame.substr(havka::kFrameHeaderSize), body);
+}
+
+TEST(CodecTest, SplitRequestTest) {
+    havka::Request request;
+    request.type = havka::RequestType::PostMessageSafe;
+    request.topic = "topic";
+    request.group = "group";
+    request.offset = 7;
+    request.message = havka::Message();
+    request.message->setData("payload", 7, havka::MessageDataType::Text);
+
+    std::string head, tail;
+    havka::encode(request, head, tail);
+    ASSERT_EQ(head + request.message->data + tail, havka::encode(request));
+    ASSERT_EQ(head.size(), havka::getMessageHeadSize());
+
+    havka::MessageDataType dataType;
+    std::size_t dataSize = 0;
+    ASSERT_TRUE(havka::decodeHead(head.data(), dataType, dataSize));
+    ASSERT_EQ(dataType, havka::MessageDataType::Text);
+    ASSERT_EQ(dataSize, 7);
+    havka::Request decoded;
+    havka::decodeTail(tail.data(), tail.size(), decoded);
+    ASSERT_EQ(decoded.topic, "topic");
+    ASSERT_EQ(decoded.type, havka::RequestType::PostMessageSafe);
+    ASSERT_EQ(decoded.group, "group");
+    ASSERT_EQ(decoded.offset, 7);
+
+    /// message may be given apart from the request
+    auto message = *request.message;
+    request.message = std::nullopt;
+    std::string otherHead, otherTail;
+    havka::encode(request, &message, otherHead, otherTail);
+    ASSERT_EQ(otherHead, head);
+    ASSERT_EQ(otherTail, tail);
+
+    /// head of request without message is shorter, it has no data size
+    havka::encode(request, head, tail);
+    head.resize(havka::getMessageHeadSize());
+    ASSERT_FALSE(havka::decodeHead(head.data(), dataType, dataSize));
+}
@@ -129,10 +129,114 @@ TEST_F(ConfigTest, ServerConfig_DefaultFieldsTest1) {
     ASSERT_EQ(serverConfig->getQueueType(), QueueType::MutexQueue);
     ASSERT_EQ(serverConfig->getThreadsNumber(), -1);
     ASSERT_EQ(serverConfig->getTimeout(), -1);
+    ASSERT_TRUE(serverConfig->getTopicModes().empty());
+    ASSERT_EQ(serverConfig->getLogRetention().maxBytes, 1 << 30);
+    ASSERT_EQ(serverConfig->getLogRetention().maxAge.count(), 86400);
+    ASSERT_EQ(serverConfig->getSnapshotPath(), "");
+    ASSERT_EQ(serverConfig->getSnapshotInterval(), -1);
+    ASSERT_EQ(serverConfig->getTopicIdleTimeout(), -1);
+    ASSERT_EQ(serverConfig->getMetricsPort(), -1);
+    ASSERT_EQ(serverConfig->getLogLevel(), havka::log::Level::Info);
+    ASSERT_EQ(serverConfig->getLogRateLimit(), 0);
+    ASSERT_FALSE(serverConfig->isRequestTracing());
+    ASSERT_EQ(serverConfig->getSlowRequestThreshold(), -1);
+    ASSERT_EQ(serverConfig->getSlowRequestSample(), 1);
+    ASSERT_FALSE(serverConfig->isEnqueueTimeReturned());
+    ASSERT_EQ(serverConfig->getCapturePath(), "");
+    ASSERT_EQ(serverConfig->getUnixSocketPath(), "");
+    ASSERT_EQ(serverConfig->getShmSocketPath(), "");
+    ASSERT_EQ(serverConfig->getShmRingSize(), 1 << 20);
+    ASSERT_EQ(serverConfig->getWriteBatchSize(), 256 * 1024);
+    ASSERT_EQ(serverConfig->getZeroCopyThreshold(), 0);
+    ASSERT_EQ(serverConfig->getMaxMessageSize(), 64 << 20);
+    ASSERT_EQ(serverConfig->getStreamThreshold(), 64 * 1024);
+    ASSERT_FALSE(serverConfig->isThreadPerCore());
+    ASSERT_FALSE(serverConfig->isShardPerCore());
+    ASSERT_TRUE(serverConfig->getCpuAffinity().empty());
 
     std::remove("default_test.yaml");
 }
 
+TEST_F(ConfigTest, ServerConfig_TopicModesTest) {
+    std::ofstream file("topic_modes_test.yaml", std::ios::trunc);
+    file << "endpoint_address: 0.0.0.0\n"
+            "endpoint_port: 0\n"
+            "topic_modes:\n"
+            "  \"cache.#\": broadcast\n"
+            "  orders: queue\n";
+    file.close();
+
+    serverConfig =
+        std::make_shared<havka::ServerConfig>("topic_modes_test.yaml");
+    const auto& modes = serverConfig->getTopicModes();
+    ASSERT_EQ(modes.size(), 2);
+    ASSERT_EQ(modes[0].first, "cache.#");
+    ASSERT_EQ(modes[0].second, TopicMode::Broadcast);
+    ASSERT_EQ(modes[1].first, "orders");
+    ASSERT_EQ(modes[1].second, TopicMode::Queue);
+
+    std::remove("topic_modes_test.yaml");
+}
+
+TEST_F(ConfigTest, ServerConfig_StorageOptionsTest) {
+    std::ofstream file("storage_options_test.yaml", std::ios::trunc);
+    file << "endpoint_address: 0.0.0.0\n"
+            "endpoint_port: 0\n"
+            "log_retention_bytes: 1024\n"
+            "log_retention_seconds: 60\n"
+            "snapshot_path: /var/lib/havka/snapshot.bin\n"
+            "snapshot_interval: 300\n"
+            "topic_idle_timeout: 60\n"
+            "metrics_port: 9100\n"
+            "log_level: warning\n"
+            "log_rate_limit: 100\n"
+            "request_tracing: true\n"
+            "slow_request_threshold_us: 2000\n"
+            "slow_request_sample: 10\n"
+            "return_enqueue_time: true\n"
+            "capture_path: /tmp/havka.capture\n"
+            "unix_socket_path: /tmp/havka.sock\n"
+            "shm_socket_path: /tmp/havka-shm.sock\n"
+            "shm_ring_size: 100000\n"
+            "write_batch_size: 65536\n"
+            "zerocopy_threshold: 262144\n"
+            "max_message_size: 1048576\n"
+            "stream_threshold: 16384\n"
+            "shard_per_core: true\n"
+            "cpu_affinity: [2, 3]\n";
+    file.close();
+
+    serverConfig =
+        std::make_shared<havka::ServerConfig>("storage_options_test.yaml");
+    ASSERT_EQ(serverConfig->getLogRetention().maxBytes, 1024);
+    ASSERT_EQ(serverConfig->getLogRetention().maxAge.count(), 60);
+    ASSERT_EQ(serverConfig->getSnapshotPath(), "/var/lib/havka/snapshot.bin");
+    ASSERT_EQ(serverConfig->getSnapshotInterval(), 300);
+    ASSERT_EQ(serverConfig->getTopicIdleTimeout(), 60);
+    ASSERT_EQ(serverConfig->getMetricsPort(), 9100);
+    ASSERT_EQ(serverConfig->getLogLevel(), havka::log::Level::Warning);
+    ASSERT_EQ(serverConfig->getLogRateLimit(), 100);
+    ASSERT_TRUE(serverConfig->isRequestTracing());
+    ASSERT_EQ(serverConfig->getSlowRequestThreshold(), 2000);
+    ASSERT_EQ(serverConfig->getSlowRequestSample(), 10);
+    ASSERT_TRUE(serverConfig->isEnqueueTimeReturned());
+    ASSERT_EQ(serverConfig->getCapturePath(), "/tmp/havka.capture");
+    ASSERT_EQ(serverConfig->getUnixSocketPath(), "/tmp/havka.sock");
+    ASSERT_EQ(serverConfig->getShmSocketPath(), "/tmp/havka-shm.sock");
+    /// rounded up to a power of two
+    ASSERT_EQ(serverConfig->getShmRingSize(), 131072);
+    ASSERT_EQ(serverConfig->getWriteBatchSize(), 65536);
+    ASSERT_EQ(serverConfig->getZeroCopyThreshold(), 262144);
+    ASSERT_EQ(serverConfig->getMaxMessageSize(), 1 << 20);
+    ASSERT_EQ(serverConfig->getStreamThreshold(), 16384);
+    /// shard per core implies thread per core
+    ASSERT_TRUE(serverConfig->isThreadPerCore());
+    ASSERT_TRUE(serverConfig->isShardPerCore());
+    ASSERT_EQ(serverConfig->getCpuAffinity(), std::vector<int>({2, 3}));
+
+    std::remove("storage_options_test.yaml");
+}
+
 TEST_F(ConfigTest, ClientConfig_NonExistingFileTest) {
     ASSERT_DEATH(clientConfig = std::make_shared<havka::ClientConfig>(
                      "non-existing-file.ext"),
@@ -0,0 +1,154 @@
+#include <gtest/gtest.h>
+
+#include <boost/asio.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "codec.hpp"
+#include "metrics.h"
+#include "server/net.h"
+#include "server/storage.h"
+
+namespace net = boost::asio;
+
+namespace {
+class ConnectionTest : public testing::Test {
+public:
+    static constexpr int ITEMS = 10;
+
+    net::io_context ioc;
+    net::local::stream_protocol::socket server{ioc};
+    net::local::stream_protocol::socket client{ioc};
+    havka::Message message;
+    std::string frame;
+
+    void SetUp() override {
+        net::local::connect_pair(server, client);
+        message.setData("payload", 7, havka::MessageDataType::Text);
+        /// the same frame as sendBroadcastMessage writes
+        havka::Response response;
+        response.message = message;
+        response.type = havka::ResponseType::GetSuccess;
+        response.topic = "topic";
+        frame = havka::encodeFrame(response);
+    }
+
+    void TearDown() override {
+        havka::Connection::setWriteBatchSize(256 * 1024);
+    }
+
+    /**
+     * Creates connection over server end of socket pair
+     * @return connection
+     */
+    std::shared_ptr<havka::Connection> createConnection() {
+        return std::make_shared<havka::Connection>(
+            std::move(server), havka::createMessageStorage(
+                                   StorageType::RAM, QueueType::MutexQueue));
+    }
+
+    /**
+     * Sends ITEMS frames to connection one by one, all but the first are
+     * queued while the first is written
+     * @param connection connection
+     */
+    void sendItems(const std::shared_ptr<havka::Connection>& connection) {
+        for (int i = 0; i < ITEMS; ++i) {
+            havka::Connection::sendBroadcastMessage({connection}, message,
+                                                    "topic");
+        }
+    }
+
+    /**
+     * Runs handlers until there are no ready ones
+     */
+    void poll() {
+        /// context is stopped when it runs out of work
+        ioc.restart();
+        while (ioc.poll() > 0) {
+        }
+    }
+
+    static std::uint64_t getWrites() {
+        return havka::metrics::Registry::instance()
+            .getCounter("havka_writes_total", "")
+            .get();
+    }
+};
+}  // namespace
+
+TEST_F(ConnectionTest, OutboundBatchingTest) {
+    /// three frames fit into one write
+    havka::Connection::setWriteBatchSize(3 * frame.size());
+    auto connection = createConnection();
+    auto writes = getWrites();
+    sendItems(connection);
+    poll();
+    /// the first item alone, then the other nine in batches of three
+    ASSERT_EQ(getWrites() - writes, 4);
+
+    std::string received(ITEMS * frame.size(), '\0');
+    net::read(client, net::buffer(received));
+    std::string expected;
+    for (int i = 0; i < ITEMS; ++i) {
+        expected += frame;
+    }
+    ASSERT_EQ(received, expected);
+}
+
+TEST_F(ConnectionTest, OutboundErrorTest) {
+    auto connection = createConnection();
+    std::weak_ptr<havka::Connection> weak = connection;
+    client.close();
+    auto writes = getWrites();
+    sendItems(connection);
+    connection.reset();
+    poll();
+    /// failed write completes queued items with the error instead of
+    /// writing them, so none of them keeps the connection alive
+    ASSERT_EQ(getWrites() - writes, 1);
+    ASSERT_TRUE(weak.expired());
+}
+
+TEST_F(ConnectionTest, LogAtMostOnceTest) {
+    auto storage =
+        havka::createMessageStorage(StorageType::RAM, QueueType::MutexQueue);
+    storage->setTopicMode("events.#", TopicMode::Log);
+    havka::Message next;
+    next.setData("next", 4, havka::MessageDataType::Text);
+    storage->postMessage(message, "events.a");
+    storage->postMessage(next, "events.a");
+    storage->postMessage(message, "queue");
+
+    for (const std::string topic : {"events.a", "queue"}) {
+        net::local::stream_protocol::socket serverSocket{ioc};
+        net::local::stream_protocol::socket clientSocket{ioc};
+        net::local::connect_pair(serverSocket, clientSocket);
+        auto connection = std::make_shared<havka::Connection>(
+            std::move(serverSocket), storage);
+        std::weak_ptr<havka::Connection> weak = connection;
+        havka::Request request;
+        request.type = havka::RequestType::GetMessageBlocking;
+        request.topic = topic;
+        request.group = "g1";
+        net::write(clientSocket, net::buffer(havka::encodeFrame(request)));
+        connection->start();
+        connection.reset();
+        poll();
+
+        /// client gets the message and disconnects without confirmation
+        std::string header(havka::kFrameHeaderSize, '\0');
+        net::read(clientSocket, net::buffer(header));
+        std::string body(havka::decodeFrameHeader(header.data()), '\0');
+        net::read(clientSocket, net::buffer(body));
+        clientSocket.close();
+        poll();
+        ASSERT_TRUE(weak.expired());
+    }
+
+    /// group offset has moved on hand-out, log message is not redelivered
+    ASSERT_EQ(storage->getMessageNonblocking("events.a", "g1"), next);
+    /// queue message returns to its queue
+    ASSERT_EQ(storage->getMessageNonblocking("queue"), message);
+}
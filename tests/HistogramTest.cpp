@@ -0,0 +1,57 @@
+#include <gtest/gtest.h>
+
+#include <limits>
+
+#include "histogram.h"
+
+TEST(HistogramTest, EmptyTest) {
+    havka::Histogram histogram;
+    ASSERT_EQ(histogram.getCount(), 0);
+    ASSERT_EQ(histogram.getMin(), 0);
+    ASSERT_EQ(histogram.getMax(), 0);
+    ASSERT_EQ(histogram.getPercentile(99), 0);
+}
+
+TEST(HistogramTest, ExactSmallValuesTest) {
+    havka::Histogram histogram;
+    for (std::uint64_t i = 1; i <= 100; ++i) {
+        histogram.record(i);
+    }
+    ASSERT_EQ(histogram.getCount(), 100);
+    ASSERT_EQ(histogram.getMin(), 1);
+    ASSERT_EQ(histogram.getMax(), 100);
+    ASSERT_DOUBLE_EQ(histogram.getMean(), 50.5);
+    ASSERT_EQ(histogram.getPercentile(50), 50);
+    ASSERT_EQ(histogram.getPercentile(99), 99);
+    ASSERT_EQ(histogram.getPercentile(100), 100);
+}
+
+TEST(HistogramTest, RelativeErrorTest) {
+    havka::Histogram histogram;
+    for (std::uint64_t i = 1; i <= 1000000; ++i) {
+        histogram.record(i * 1000);
+    }
+    for (double percentile : {50.0, 90.0, 99.0, 99.9}) {
+        double expected = percentile / 100 * 1e9;
+        double actual = histogram.getPercentile(percentile);
+        ASSERT_NEAR(actual, expected, expected * 0.02);
+    }
+    ASSERT_EQ(histogram.getPercentile(100), 1000000000);
+
+    histogram.record(std::numeric_limits<std::uint64_t>::max());
+    ASSERT_EQ(histogram.getPercentile(100),
+              std::numeric_limits<std::uint64_t>::max());
+}
+
+TEST(HistogramTest, MergeTest) {
+    havka::Histogram first, second;
+    first.record(10);
+    second.record(1000);
+    second.record(5);
+    first.merge(second);
+    ASSERT_EQ(first.getCount(), 3);
+    ASSERT_EQ(first.getMin(), 5);
+    ASSERT_EQ(first.getMax(), 1000);
+    first.reset();
+    ASSERT_EQ(first.getCount(), 0);
+}
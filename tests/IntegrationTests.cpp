@@ -1,5 +1,8 @@
 #include <gtest/gtest.h>
 
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <chrono>
 #include <fstream>
 #include <iostream>
 #include <memory>
@@ -15,9 +18,32 @@ public:
     IntegrationTest() = default;
 
     /**
-     * Joins server thread
+     * Joins server thread, so files written by server on stop are there,
+     * and removes files of test, also if some assertion failed
      */
-    ~IntegrationTest() override { server_thread_->join(); }
+    void TearDown() override {
+        server_thread_->join();
+        for (const auto& path : files_) {
+            std::remove(path.c_str());
+        }
+    }
+
+    /**
+     * Writes server configuration file, it is removed after test
+     * @param path path of file
+     * @param contents YAML configuration
+     */
+    void writeConfig(const std::string& path, const std::string& contents) {
+        std::ofstream file(path, std::ios::trunc);
+        file << contents;
+        removeAfterTest(path);
+    }
+
+    /**
+     * Makes file created by test be removed after it
+     * @param path path of file
+     */
+    void removeAfterTest(const std::string& path) { files_.push_back(path); }
 
     /**
      * Runs server with exact timeout to correctly finish test
@@ -33,6 +59,17 @@ public:
         });
     }
 
+    /**
+     * Runs server configured with given configuration file
+     * @param configPath path to server configuration file
+     */
+    void runServer(const std::string& configPath) {
+        auto config = std::make_shared<havka::ServerConfig>(configPath);
+        server_thread_ = std::make_shared<std::thread>([config] {
+            std::make_shared<havka::BrokerServer>(*config)->run();
+        });
+    }
+
     /**
      * Generates random readable string with exact length
      * @param length number of elements
@@ -300,6 +337,8 @@ public:
     }
 
     std::shared_ptr<std::thread> server_thread_;
+    /// files removed in TearDown
+    std::vector<std::string> files_;
 };
 }  // namespace
 
@@ -367,6 +406,638 @@ TEST_F(IntegrationTest, SimpleTest2) {
         std::nullopt);
 }
 
+TEST_F(IntegrationTest, WildcardBlockingTest) {
+    runServer(3, 2);
+    sleep(1);
+    havka::Message mes1;
+    mes1.setData("111", 3, havka::MessageDataType::Text);
+
+    std::thread reader([&mes1] {
+        havka::BrokerSyncClient client(net::ip::make_address("127.0.0.1"),
+                                       9090);
+        client.connect();
+        ASSERT_EQ(
+            client.getMessage("orders.*.eu",
+                              havka::RequestType::GetMessageBlocking),
+            mes1);
+        ASSERT_EQ(client.getLastMessageTopic(), "orders.created.eu");
+    });
+    usleep(200000);
+
+    havka::BrokerSyncClient client(net::ip::make_address("127.0.0.1"), 9090);
+    client.connect();
+    ASSERT_FALSE(client.postMessage(mes1, "orders.*.eu",
+                                    havka::RequestType::PostMessageSafe));
+    ASSERT_TRUE(client.postMessage(mes1, "orders.created.us",
+                                   havka::RequestType::PostMessageSafe));
+    ASSERT_TRUE(client.postMessage(mes1, "orders.created.eu",
+                                   havka::RequestType::PostMessageSafe));
+    reader.join();
+    ASSERT_EQ(
+        client.getMessage("orders.created.us",
+                          havka::RequestType::GetMessageNonblocking),
+        mes1);
+}
+
+TEST_F(IntegrationTest, WildcardOrderTest) {
+    runServer(3, 2);
+    sleep(1);
+    havka::Message mes1, mes2;
+    mes1.setData("111", 3, havka::MessageDataType::Text);
+    mes2.setData("2222", 4, havka::MessageDataType::Text);
+
+    /// readers wait on different patterns, the first one to wait gets the
+    /// first message
+    auto read = [](const std::string& pattern, const havka::Message& mes) {
+        havka::BrokerSyncClient client(net::ip::make_address("127.0.0.1"),
+                                       9090);
+        client.connect();
+        ASSERT_EQ(
+            client.getMessage(pattern, havka::RequestType::GetMessageBlocking),
+            mes);
+    };
+    std::thread first(read, "orders.*", mes1);
+    usleep(200000);
+    std::thread second(read, "orders.#", mes2);
+    usleep(200000);
+
+    havka::BrokerSyncClient client(net::ip::make_address("127.0.0.1"), 9090);
+    client.connect();
+    ASSERT_TRUE(client.postMessage(mes1, "orders.created",
+                                   havka::RequestType::PostMessageSafe));
+    ASSERT_TRUE(client.postMessage(mes2, "orders.created",
+                                   havka::RequestType::PostMessageSafe));
+    first.join();
+    second.join();
+}
+
+TEST_F(IntegrationTest, BroadcastTest) {
+    writeConfig("broadcast_test.yaml",
+                "endpoint_address: 127.0.0.1\n"
+                "endpoint_port: 9090\n"
+                "threads: 2\n"
+                "timeout: 3\n"
+                "topic_modes:\n"
+                "  \"cache.#\": broadcast\n");
+    runServer("broadcast_test.yaml");
+    sleep(1);
+
+    havka::Message mes1;
+    mes1.setData("invalidate", 10, havka::MessageDataType::Text);
+
+    const int SUBSCRIBERS = 5;
+    std::vector<std::thread> subscribers;
+    for (int i = 0; i < SUBSCRIBERS; ++i) {
+        subscribers.emplace_back([&mes1, i] {
+            havka::BrokerSyncClient client(net::ip::make_address("127.0.0.1"),
+                                           9090);
+            client.connect();
+            ASSERT_EQ(client.getMessage(i % 2 ? "cache.users" : "cache.*",
+                                        havka::RequestType::GetMessageBlocking),
+                      mes1);
+            ASSERT_EQ(client.getLastMessageTopic(), "cache.users");
+        });
+    }
+    usleep(300000);
+
+    havka::BrokerSyncClient client(net::ip::make_address("127.0.0.1"), 9090);
+    client.connect();
+    ASSERT_TRUE(client.postMessage(mes1, "cache.users",
+                                   havka::RequestType::PostMessageSafe));
+    for (auto& subscriber : subscribers) {
+        subscriber.join();
+    }
+
+    /// nobody is subscribed, message is dropped
+    ASSERT_TRUE(client.postMessage(mes1, "cache.users",
+                                   havka::RequestType::PostMessageSafe));
+    ASSERT_EQ(client.getMessage("cache.users",
+                                havka::RequestType::GetMessageNonblocking),
+              std::nullopt);
+}
+
+TEST_F(IntegrationTest, BroadcastBurstTest) {
+    writeConfig("broadcast_burst_test.yaml",
+                "endpoint_address: 127.0.0.1\n"
+                "endpoint_port: 9090\n"
+                "threads: 2\n"
+                "timeout: 3\n"
+                "topic_modes:\n"
+                "  \"cache.#\": broadcast\n");
+    runServer("broadcast_burst_test.yaml");
+    sleep(1);
+
+    havka::Message mes1, mes2;
+    mes1.setData("invalidate", 10, havka::MessageDataType::Text);
+    mes2.setData("refresh", 7, havka::MessageDataType::Text);
+
+    const int SUBSCRIBERS = 5;
+    std::vector<std::thread> subscribers;
+    for (int i = 0; i < SUBSCRIBERS; ++i) {
+        subscribers.emplace_back([&mes1, &mes2, i] {
+            havka::BrokerSyncClient client(net::ip::make_address("127.0.0.1"),
+                                           9090);
+            client.connect();
+            const std::string topic = i % 2 ? "cache.users" : "cache.*";
+            /// the second message is posted before subscriber gets again
+            for (const auto& mes : {mes1, mes2}) {
+                ASSERT_EQ(client.getMessage(
+                              topic, havka::RequestType::GetMessageBlocking),
+                          mes);
+                ASSERT_EQ(client.getLastMessageTopic(), "cache.users");
+            }
+        });
+    }
+    usleep(300000);
+
+    havka::BrokerSyncClient client(net::ip::make_address("127.0.0.1"), 9090);
+    client.connect();
+    ASSERT_TRUE(client.postMessage(mes1, "cache.users",
+                                   havka::RequestType::PostMessageSafe));
+    ASSERT_TRUE(client.postMessage(mes2, "cache.users",
+                                   havka::RequestType::PostMessageSafe));
+    for (auto& subscriber : subscribers) {
+        subscriber.join();
+    }
+}
+
+TEST_F(IntegrationTest, LogReplayTest) {
+    writeConfig("log_test.yaml",
+                "endpoint_address: 127.0.0.1\n"
+                "endpoint_port: 9090\n"
+                "threads: 2\n"
+                "timeout: 3\n"
+                "topic_modes:\n"
+                "  \"events.#\": log\n");
+    runServer("log_test.yaml");
+    sleep(1);
+
+    havka::Message mes1, mes2;
+    mes1.setData("111", 3, havka::MessageDataType::Text);
+    mes2.setData("2222", 4, havka::MessageDataType::Binary);
+
+    std::thread reader([&mes1] {
+        havka::BrokerSyncClient client(net::ip::make_address("127.0.0.1"),
+                                       9090);
+        client.connect();
+        ASSERT_EQ(client.getMessage("events.a",
+                                    havka::RequestType::GetMessageBlocking,
+                                    "blocking"),
+                  mes1);
+        ASSERT_EQ(client.getLastMessageOffset(), 0);
+    });
+    usleep(200000);
+
+    havka::BrokerSyncClient client(net::ip::make_address("127.0.0.1"), 9090);
+    client.connect();
+    ASSERT_TRUE(client.postMessage(mes1, "events.a",
+                                   havka::RequestType::PostMessageSafe));
+    ASSERT_TRUE(client.postMessage(mes2, "events.a",
+                                   havka::RequestType::PostMessageSafe));
+    reader.join();
+
+    for (const std::string group : {"g1", "g2"}) {
+        ASSERT_EQ(client.getMessage("events.a",
+                                    havka::RequestType::GetMessageNonblocking,
+                                    group),
+                  mes1);
+        ASSERT_EQ(client.getMessage("events.a",
+                                    havka::RequestType::GetMessageNonblocking,
+                                    group),
+                  mes2);
+        ASSERT_EQ(client.getLastMessageOffset(), 1);
+        ASSERT_EQ(client.getMessage("events.a",
+                                    havka::RequestType::GetMessageNonblocking,
+                                    group),
+                  std::nullopt);
+    }
+
+    ASSERT_EQ(client.seek("events.a", "g1", 1), 1);
+    ASSERT_EQ(client.getMessage("events.a",
+                                havka::RequestType::GetMessageNonblocking,
+                                "g1"),
+              mes2);
+    ASSERT_EQ(client.seek("not.a.log", "g1", 0), std::nullopt);
+}
+
+TEST_F(IntegrationTest, SnapshotRestartTest) {
+    writeConfig("snapshot_test.yaml",
+                "endpoint_address: 127.0.0.1\n"
+                "endpoint_port: 9090\n"
+                "threads: 2\n"
+                "timeout: 2\n"
+                "snapshot_path: integration_snapshot.bin\n");
+    removeAfterTest("integration_snapshot.bin");
+
+    havka::Message mes1, mes2;
+    mes1.setData("111", 3, havka::MessageDataType::Text);
+    mes2.setData("2222", 4, havka::MessageDataType::Binary);
+
+    runServer("snapshot_test.yaml");
+    sleep(1);
+    {
+        havka::BrokerSyncClient client(net::ip::make_address("127.0.0.1"),
+                                       9090);
+        client.connect();
+        client.postMessage(mes1, "tag1", havka::RequestType::PostMessageSafe);
+        client.postMessage(mes2, "tag1", havka::RequestType::PostMessageSafe);
+    }
+    /// server writes snapshot on timeout
+    server_thread_->join();
+
+    runServer("snapshot_test.yaml");
+    sleep(1);
+    havka::BrokerSyncClient client(net::ip::make_address("127.0.0.1"), 9090);
+    client.connect();
+    ASSERT_EQ(
+        client.getMessage("tag1", havka::RequestType::GetMessageNonblocking),
+        mes1);
+    ASSERT_EQ(
+        client.getMessage("tag1", havka::RequestType::GetMessageNonblocking),
+        mes2);
+}
+
+TEST_F(IntegrationTest, MetricsEndpointTest) {
+    writeConfig("metrics_test.yaml",
+                "endpoint_address: 127.0.0.1\n"
+                "endpoint_port: 9090\n"
+                "threads: 2\n"
+                "timeout: 2\n"
+                "metrics_port: 9091\n");
+
+    runServer("metrics_test.yaml");
+    sleep(1);
+    havka::Message message;
+    message.setData("111", 3, havka::MessageDataType::Text);
+    havka::BrokerSyncClient client(net::ip::make_address("127.0.0.1"), 9090);
+    client.connect();
+    client.postMessage(message, "metrics.topic",
+                       havka::RequestType::PostMessageSafe);
+
+    namespace http = boost::beast::http;
+    net::io_context ioc;
+    net::ip::tcp::socket socket(ioc);
+    socket.connect(
+        net::ip::tcp::endpoint(net::ip::make_address("127.0.0.1"), 9091));
+    http::request<http::empty_body> request(http::verb::get, "/metrics", 11);
+    http::write(socket, request);
+    boost::beast::flat_buffer buffer;
+    http::response<http::string_body> response;
+    http::read(socket, buffer, response);
+
+    ASSERT_EQ(response.result(), http::status::ok);
+    const auto& body = response.body();
+    ASSERT_NE(body.find("havka_requests_total{type=\"post\"}"),
+              std::string::npos);
+    ASSERT_NE(body.find("havka_topic_messages{topic=\"metrics.topic\"} 1\n"),
+              std::string::npos);
+    ASSERT_NE(body.find("havka_request_stage_seconds_count{stage=\"storage\"}"),
+              std::string::npos);
+    ASSERT_NE(body.find("havka_topic_oldest_message_age_milliseconds{topic="
+                        "\"metrics.topic\"}"),
+              std::string::npos);
+    ASSERT_NE(body.find("havka_topic_queue_time_seconds_count{topic="
+                        "\"metrics.topic\"} 0\n"),
+              std::string::npos);
+
+}
+
+TEST_F(IntegrationTest, EnqueueTimeTest) {
+    writeConfig("enqueue_time_test.yaml",
+                "endpoint_address: 127.0.0.1\n"
+                "endpoint_port: 9090\n"
+                "threads: 2\n"
+                "timeout: 2\n"
+                "return_enqueue_time: true\n");
+
+    runServer("enqueue_time_test.yaml");
+    sleep(1);
+    havka::Message message;
+    message.setData("111", 3, havka::MessageDataType::Text);
+    havka::BrokerSyncClient client(net::ip::make_address("127.0.0.1"), 9090);
+    client.connect();
+
+    auto now = [] {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+                   std::chrono::system_clock::now().time_since_epoch())
+            .count();
+    };
+    auto before = now();
+    client.postMessage(message, "tag1", havka::RequestType::PostMessageSafe);
+    auto after = now();
+    ASSERT_EQ(client.getLastMessageEnqueueTime(), std::nullopt);
+    ASSERT_EQ(
+        client.getMessage("tag1", havka::RequestType::GetMessageNonblocking),
+        message);
+    ASSERT_NE(client.getLastMessageEnqueueTime(), std::nullopt);
+    ASSERT_GE(*client.getLastMessageEnqueueTime(), before);
+    ASSERT_LE(*client.getLastMessageEnqueueTime(), after);
+
+}
+
+TEST_F(IntegrationTest, ThreadPerCoreTest) {
+    writeConfig("thread_per_core_test.yaml",
+                "endpoint_address: 127.0.0.1\n"
+                "endpoint_port: 9090\n"
+                "threads: 4\n"
+                "timeout: 4\n"
+                "thread_per_core: true\n"
+                "cpu_affinity: [0]\n");
+
+    runServer("thread_per_core_test.yaml");
+    sleep(1);
+    /// connections are spread over threads, waiting clients are woken up
+    /// by posts from other threads
+    testMultiClientSimple(4, 1000, 100);
+    testMultiClientBlocking(4, 4, 1000, 1000);
+
+}
+
+TEST_F(IntegrationTest, ShardPerCoreTest) {
+    writeConfig("shard_per_core_test.yaml",
+                "endpoint_address: 127.0.0.1\n"
+                "endpoint_port: 9090\n"
+                "threads: 4\n"
+                "timeout: 4\n"
+                "shard_per_core: true\n");
+
+    runServer("shard_per_core_test.yaml");
+    sleep(1);
+    /// requests are forwarded to owners of their topics
+    testMultiClientSimple(4, 1000, 100);
+    testMultiClientBlocking(4, 4, 1000, 1000);
+
+    havka::BrokerSyncClient client(net::ip::make_address("127.0.0.1"), 9090);
+    client.connect();
+    havka::Message message;
+    message.setData("111", 3, havka::MessageDataType::Text);
+    client.postMessage(message, "sharded.a",
+                       havka::RequestType::PostMessageSafe);
+    ASSERT_EQ(client.getMessage("sharded.*",
+                                havka::RequestType::GetMessageNonblocking),
+              message);
+
+    /// blocking get of pattern waits on all shards and gets one message
+    std::thread reader([&message] {
+        havka::BrokerSyncClient client(net::ip::make_address("127.0.0.1"),
+                                       9090);
+        client.connect();
+        ASSERT_EQ(client.getMessage("sharded.*",
+                                    havka::RequestType::GetMessageBlocking),
+                  message);
+    });
+    usleep(200000);
+    const int TOPICS = 8;
+    for (int i = 0; i < TOPICS; ++i) {
+        client.postMessage(message, "sharded." + std::to_string(i),
+                           havka::RequestType::PostMessageSafe);
+    }
+    reader.join();
+    for (int i = 1; i < TOPICS; ++i) {
+        ASSERT_EQ(client.getMessage("sharded.*",
+                                    havka::RequestType::GetMessageNonblocking),
+                  message);
+    }
+    ASSERT_EQ(client.getMessage("sharded.*",
+                                havka::RequestType::GetMessageNonblocking),
+              std::nullopt);
+}
+
+TEST_F(IntegrationTest, UnixSocketTest) {
+    writeConfig("unix_socket_test.yaml",
+                "endpoint_address: 127.0.0.1\n"
+                "endpoint_port: 9090\n"
+                "threads: 2\n"
+                "timeout: 3\n"
+                "thread_per_core: true\n"
+                "unix_socket_path: havka_test.sock\n");
+
+    runServer("unix_socket_test.yaml");
+    sleep(1);
+    /// local connections are spread between threads
+    havka::BrokerSyncClient local1("havka_test.sock");
+    havka::BrokerSyncClient local2("havka_test.sock");
+    havka::BrokerSyncClient remote(net::ip::make_address("127.0.0.1"), 9090);
+    ASSERT_TRUE(local1.connect());
+    ASSERT_TRUE(local2.connect());
+    ASSERT_TRUE(remote.connect());
+
+    havka::Message message;
+    message.setData("111", 3, havka::MessageDataType::Text);
+    ASSERT_TRUE(local1.postMessage(message, "local",
+                                   havka::RequestType::PostMessageSafe));
+    ASSERT_EQ(remote.getMessage("local",
+                                havka::RequestType::GetMessageNonblocking),
+              message);
+
+    /// blocking get over Unix domain socket is woken up by TCP client
+    std::thread poster([&remote, &message] {
+        sleep(1);
+        remote.postMessage(message, "remote",
+                           havka::RequestType::PostMessageSafe);
+    });
+    ASSERT_EQ(local2.getMessage("remote",
+                                havka::RequestType::GetMessageBlocking),
+              message);
+    poster.join();
+
+    havka::BrokerSyncClient missing("havka_missing.sock");
+    ASSERT_FALSE(missing.connect());
+
+}
+
+TEST_F(IntegrationTest, ZeroCopyTest) {
+    writeConfig("zerocopy_test.yaml",
+                "endpoint_address: 127.0.0.1\n"
+                "endpoint_port: 9090\n"
+                "threads: 2\n"
+                "timeout: 3\n"
+                "zerocopy_threshold: 16384\n");
+
+    runServer("zerocopy_test.yaml");
+    sleep(1);
+    havka::BrokerSyncClient producer(net::ip::make_address("127.0.0.1"), 9090);
+    havka::BrokerSyncClient consumer(net::ip::make_address("127.0.0.1"), 9090);
+    ASSERT_TRUE(producer.connect());
+    ASSERT_TRUE(consumer.connect());
+
+    /// responses of at least threshold bytes are sent with MSG_ZEROCOPY,
+    /// small ones are copied
+    for (std::size_t size : {20000, 100, 30000}) {
+        havka::Message message;
+        auto data = random_string(size);
+        message.setData(data.c_str(), data.size(),
+                        havka::MessageDataType::Binary);
+        ASSERT_TRUE(producer.postMessage(message, "zerocopy",
+                                         havka::RequestType::PostMessageSafe));
+        ASSERT_EQ(consumer.getMessage(
+                      "zerocopy", havka::RequestType::GetMessageNonblocking),
+                  message);
+    }
+
+    /// emerged message of blocking get
+    havka::Message message;
+    auto data = random_string(20000);
+    message.setData(data.c_str(), data.size(), havka::MessageDataType::Binary);
+    std::thread poster([&producer, &message] {
+        usleep(200000);
+        producer.postMessage(message, "zerocopy",
+                             havka::RequestType::PostMessageSafe);
+    });
+    ASSERT_EQ(consumer.getMessage("zerocopy",
+                                  havka::RequestType::GetMessageBlocking),
+              message);
+    poster.join();
+
+}
+
+TEST_F(IntegrationTest, BigMessageTest) {
+    writeConfig("big_message_test.yaml",
+                "endpoint_address: 127.0.0.1\n"
+                "endpoint_port: 9090\n"
+                "threads: 2\n"
+                "timeout: 3\n"
+                "unix_socket_path: havka_test.sock\n"
+                "max_message_size: 8388608\n");
+
+    runServer("big_message_test.yaml");
+    sleep(1);
+    havka::BrokerSyncClient producer(net::ip::make_address("127.0.0.1"), 9090);
+    havka::BrokerSyncClient consumer("havka_test.sock");
+    ASSERT_TRUE(producer.connect());
+    ASSERT_TRUE(consumer.connect());
+
+    /// frames larger than the first buffer are read after their header
+    havka::Message message;
+    auto data = random_string(5 << 20);
+    message.setData(data.c_str(), data.size(), havka::MessageDataType::Binary);
+    ASSERT_TRUE(producer.postMessage(message, "big",
+                                     havka::RequestType::PostMessageSafe));
+    ASSERT_EQ(consumer.getMessage("big",
+                                  havka::RequestType::GetMessageNonblocking),
+              message);
+
+    /// connection which sends a frame over max_message_size is closed
+    data = random_string(9 << 20);
+    message.setData(data.c_str(), data.size(), havka::MessageDataType::Binary);
+    ASSERT_FALSE(producer.postMessage(message, "big",
+                                      havka::RequestType::PostMessageSafe));
+    ASSERT_EQ(consumer.getMessage("big",
+                                  havka::RequestType::GetMessageNonblocking),
+              std::nullopt);
+
+}
+
+TEST_F(IntegrationTest, StreamedMessageTest) {
+    writeConfig("streamed_message_test.yaml",
+                "endpoint_address: 127.0.0.1\n"
+                "endpoint_port: 9090\n"
+                "threads: 2\n"
+                "timeout: 3\n"
+                "unix_socket_path: havka_test.sock\n"
+                "stream_threshold: 1024\n");
+
+    runServer("streamed_message_test.yaml");
+    sleep(1);
+    havka::BrokerSyncClient producer(net::ip::make_address("127.0.0.1"), 9090);
+    havka::BrokerSyncClient consumer("havka_test.sock");
+    ASSERT_TRUE(producer.connect());
+    ASSERT_TRUE(consumer.connect());
+
+    /// data of larger requests is read straight into the message, data of
+    /// responses larger than the first buffer of client too
+    for (std::size_t size : {1000, 2000, 5000, 100, 3 << 20}) {
+        havka::Message message;
+        auto data = random_string(size);
+        message.setData(data.c_str(), data.size(),
+                        havka::MessageDataType::Binary);
+        ASSERT_TRUE(producer.postMessage(message, "streamed",
+                                         havka::RequestType::PostMessageSafe));
+        ASSERT_EQ(consumer.getMessage(
+                      "streamed", havka::RequestType::GetMessageNonblocking),
+                  message);
+        ASSERT_EQ(consumer.getLastMessageTopic(), "streamed");
+    }
+
+    /// emerged message of blocking get
+    havka::Message message;
+    auto data = random_string(1 << 20);
+    message.setData(data.c_str(), data.size(), havka::MessageDataType::Text);
+    std::thread poster([&producer, &message] {
+        usleep(200000);
+        producer.postMessage(message, "streamed",
+                             havka::RequestType::PostMessageSafe);
+    });
+    ASSERT_EQ(consumer.getMessage("streamed",
+                                  havka::RequestType::GetMessageBlocking),
+              message);
+    poster.join();
+
+}
+
+TEST_F(IntegrationTest, SharedMemoryTest) {
+    writeConfig("shm_test.yaml",
+                "endpoint_address: 127.0.0.1\n"
+                "endpoint_port: 9090\n"
+                "threads: 2\n"
+                "timeout: 3\n"
+                "shm_socket_path: havka_shm_test.sock\n"
+                "shm_ring_size: 65536\n");
+
+    runServer("shm_test.yaml");
+    sleep(1);
+    havka::BrokerSyncClient producer("havka_shm_test.sock", 65536,
+                                     havka::LocalTransport::SharedMemory);
+    havka::BrokerSyncClient consumer("havka_shm_test.sock", 65536,
+                                     havka::LocalTransport::SharedMemory);
+    havka::BrokerSyncClient remote(net::ip::make_address("127.0.0.1"), 9090);
+    ASSERT_TRUE(producer.connect());
+    ASSERT_TRUE(consumer.connect());
+    ASSERT_TRUE(remote.connect());
+
+    havka::Message message;
+    for (int i = 0; i < 1000; ++i) {
+        auto data = std::to_string(i);
+        message.setData(data.c_str(), data.size(),
+                        havka::MessageDataType::Text);
+        ASSERT_TRUE(producer.postMessage(message, "shm",
+                                         havka::RequestType::PostMessageSafe));
+        ASSERT_EQ(consumer.getMessage("shm",
+                                      havka::RequestType::GetMessageBlocking),
+                  message);
+    }
+
+    /// blocked consumer of shared memory is woken up by TCP client
+    std::thread poster([&remote, &message] {
+        sleep(1);
+        remote.postMessage(message, "remote",
+                           havka::RequestType::PostMessageSafe);
+    });
+    ASSERT_EQ(consumer.getMessage("remote",
+                                  havka::RequestType::GetMessageBlocking),
+              message);
+    poster.join();
+
+    /// the transport is set up only by its own socket
+    havka::BrokerSyncClient wrong("havka_missing.sock", 65536,
+                                  havka::LocalTransport::SharedMemory);
+    ASSERT_FALSE(wrong.connect());
+
+    /// response larger than ring closes the channel instead of hanging the
+    /// client, and the message is returned to its topic
+    auto data = random_string(100000);
+    message.setData(data.c_str(), data.size(), havka::MessageDataType::Text);
+    ASSERT_TRUE(
+        remote.postMessage(message, "big", havka::RequestType::PostMessageSafe));
+    ASSERT_EQ(consumer.getMessage("big",
+                                  havka::RequestType::GetMessageNonblocking),
+              std::nullopt);
+    /// channel is closed before the connection returns the message
+    ASSERT_EQ(remote.getMessage("big", havka::RequestType::GetMessageBlocking),
+              message);
+
+}
+
 TEST_F(IntegrationTest, SingleClientStressTest) {
     runServer(6, 11);
     sleep(1);
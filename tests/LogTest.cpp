@@ -0,0 +1,108 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "log.h"
+
+namespace {
+
+std::size_t countOccurrences(const std::string& text,
+                             const std::string& pattern) {
+    std::size_t count = 0;
+    for (auto position = text.find(pattern); position != std::string::npos;
+         position = text.find(pattern, position + pattern.size())) {
+        ++count;
+    }
+    return count;
+}
+
+}  // namespace
+
+TEST(LogTest, LevelTest) {
+    testing::internal::CaptureStderr();
+    havka::log::setLevel(havka::log::Level::Warning);
+    HAVKA_LOG(havka::log::Level::Info, "[INFO] ", "level test " << 1);
+    HAVKA_LOG(havka::log::Level::Warning, "[WARNING] ", "level test " << 2);
+    HAVKA_LOG(havka::log::Level::Error, "[ERROR] ", "level test " << 3);
+    havka::log::setLevel(havka::log::Level::Info);
+    havka::log::flush();
+    auto output = testing::internal::GetCapturedStderr();
+
+    ASSERT_EQ(output.find("level test 1"), std::string::npos);
+    ASSERT_NE(output.find("[WARNING] level test 2\n"), std::string::npos);
+    ASSERT_NE(output.find("[ERROR] level test 3\n"), std::string::npos);
+}
+
+TEST(LogTest, ManyThreadsTest) {
+    const int THREADS = 4;
+    const int LINES = 1000;
+
+    testing::internal::CaptureStderr();
+    std::vector<std::thread> threads;
+    for (int i = 0; i < THREADS; ++i) {
+        threads.emplace_back([i] {
+            for (int j = 0; j < LINES; ++j) {
+                HAVKA_LOG(havka::log::Level::Info, "[INFO] ",
+                          "thread " << i << " line " << j);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    havka::log::flush();
+    auto output = testing::internal::GetCapturedStderr();
+
+    ASSERT_EQ(countOccurrences(output, "[INFO] thread "), THREADS * LINES);
+    for (int i = 0; i < THREADS; ++i) {
+        ASSERT_NE(output.find("thread " + std::to_string(i) + " line " +
+                              std::to_string(LINES - 1) + "\n"),
+                  std::string::npos);
+    }
+}
+
+TEST(LogTest, RateLimitTest) {
+    const int LIMIT = 10;
+    const int LINES = 1000;
+
+    testing::internal::CaptureStderr();
+    havka::log::setRateLimit(LIMIT);
+    for (int i = 0; i < LINES; ++i) {
+        HAVKA_LOG(havka::log::Level::Error, "[ERROR] ", "rate limit test");
+    }
+    havka::log::setRateLimit(0);
+    havka::log::flush();
+    auto output = testing::internal::GetCapturedStderr();
+
+    /// loop may cross the border of a second
+    auto written = countOccurrences(output, "rate limit test");
+    ASSERT_GE(written, LIMIT);
+    ASSERT_LE(written, 2 * LIMIT);
+}
+
+TEST(LogTest, RateLimiterSuppressedTest) {
+    havka::log::setRateLimit(1);
+    havka::log::RateLimiter limiter;
+    std::uint64_t suppressed = 0;
+    std::uint64_t allowed = 0;
+    std::uint64_t reported = 0;
+    /// run through at least two seconds, suppressed lines of the first one
+    /// are reported with the first line of the next one
+    auto start = std::chrono::steady_clock::now();
+    while (std::chrono::steady_clock::now() - start <
+           std::chrono::milliseconds(2100)) {
+        if (limiter.allow(suppressed)) {
+            ++allowed;
+            reported += suppressed;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    havka::log::setRateLimit(0);
+
+    ASSERT_GE(allowed, 2);
+    ASSERT_LE(allowed, 4);
+    ASSERT_GT(reported, 0);
+}
@@ -0,0 +1,98 @@
+#include <gtest/gtest.h>
+
+#include <thread>
+
+#include "server/message_log.h"
+
+namespace {
+class MessageLogTest : public testing::Test {
+public:
+    /**
+     * Creates message with given text data
+     * @param data text of message
+     * @return message
+     */
+    static havka::Message makeMessage(const std::string& data) {
+        havka::Message message;
+        message.setData(data.c_str(), data.size(),
+                        havka::MessageDataType::Text);
+        return message;
+    }
+};
+}  // namespace
+
+TEST_F(MessageLogTest, AppendReadTest) {
+    havka::MessageLog log;
+    ASSERT_EQ(log.getBeginOffset(), 0);
+    ASSERT_EQ(log.getEndOffset(), 0);
+    ASSERT_EQ(log.read(0), std::nullopt);
+
+    ASSERT_EQ(log.append(makeMessage("a")), 0);
+    ASSERT_EQ(log.append(makeMessage("bb")), 1);
+    ASSERT_EQ(log.append(makeMessage("ccc")), 2);
+    ASSERT_EQ(log.getEndOffset(), 3);
+    ASSERT_EQ(log.getBytes(), 6);
+    ASSERT_EQ(log.read(1), makeMessage("bb"));
+    ASSERT_EQ(log.read(3), std::nullopt);
+}
+
+TEST_F(MessageLogTest, ConsumerGroupsTest) {
+    havka::MessageLog log;
+    log.append(makeMessage("a"));
+    log.append(makeMessage("b"));
+
+    std::uint64_t offset;
+    ASSERT_EQ(log.readNext("g1", &offset), makeMessage("a"));
+    ASSERT_EQ(offset, 0);
+    ASSERT_EQ(log.readNext("g1", &offset), makeMessage("b"));
+    ASSERT_EQ(offset, 1);
+    ASSERT_EQ(log.readNext("g1"), std::nullopt);
+
+    /// other group reads independently
+    ASSERT_EQ(log.readNext("g2"), makeMessage("a"));
+
+    log.append(makeMessage("c"));
+    ASSERT_EQ(log.readNext("g1"), makeMessage("c"));
+    ASSERT_EQ(log.readNext("g2"), makeMessage("b"));
+
+    ASSERT_EQ(log.seek("g1", 0), 0);
+    ASSERT_EQ(log.readNext("g1"), makeMessage("a"));
+    ASSERT_EQ(log.seek("g1", 42), 3);
+    ASSERT_EQ(log.readNext("g1"), std::nullopt);
+}
+
+TEST_F(MessageLogTest, SizeRetentionTest) {
+    havka::MessageLog log({5, std::chrono::seconds(0)});
+    log.append(makeMessage("aa"));
+    log.append(makeMessage("bb"));
+    ASSERT_EQ(log.getBeginOffset(), 0);
+    log.append(makeMessage("cc"));
+    ASSERT_EQ(log.getBeginOffset(), 1);
+    ASSERT_EQ(log.getBytes(), 4);
+    ASSERT_EQ(log.read(0), std::nullopt);
+
+    /// offset of group is moved to the oldest retained message
+    ASSERT_EQ(log.readNext("g1"), makeMessage("bb"));
+    ASSERT_EQ(log.seek("g2", 0), 1);
+}
+
+TEST_F(MessageLogTest, AgeRetentionTest) {
+    havka::MessageLog log({0, std::chrono::seconds(1)});
+    log.append(makeMessage("a"));
+    ASSERT_EQ(log.readNext("g1"), makeMessage("a"));
+    std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+    log.append(makeMessage("b"));
+    ASSERT_EQ(log.getBeginOffset(), 1);
+    ASSERT_EQ(log.readNext("g2"), makeMessage("b"));
+}
+
+TEST_F(MessageLogTest, TrimTest) {
+    havka::MessageLog log({0, std::chrono::seconds(1)});
+    log.append(makeMessage("a"));
+    std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+    /// idle log keeps expired message until it is trimmed
+    ASSERT_EQ(log.getBytes(), 1);
+    log.trim();
+    ASSERT_EQ(log.getBytes(), 0);
+    ASSERT_EQ(log.getEndOffset(), 1);
+}
@@ -0,0 +1,49 @@
+#include <gtest/gtest.h>
+
+#include "server/metrics_server.h"
+
+TEST(MetricsServerTest, FormatPrometheusTest) {
+    std::vector<havka::metrics::Sample> samples(4);
+    samples[0].name = "havka_requests_total";
+    samples[0].help = "Requests";
+    samples[0].labels = {{"type", "post"}};
+    samples[0].type = havka::metrics::MetricType::Counter;
+    samples[0].value = 3;
+
+    samples[1].name = "havka_stage_seconds";
+    samples[1].help = "Latency";
+    samples[1].type = havka::metrics::MetricType::Histogram;
+    samples[1].histogram.emplace();
+    samples[1].histogram->record(20000);    /// 20us
+    samples[1].histogram->record(2000000);  /// 2ms
+
+    samples[2] = samples[0];
+    samples[2].labels = {{"type", "get"}};
+    samples[2].value = 5;
+
+    samples[3].name = "havka_topic_messages";
+    samples[3].help = "Messages";
+    samples[3].labels = {{"topic", "a\"b"}};
+    samples[3].type = havka::metrics::MetricType::Gauge;
+    samples[3].value = 7;
+
+    auto text = havka::formatPrometheus(samples);
+    /// samples of one family are adjacent, header is written once
+    ASSERT_NE(text.find("# TYPE havka_requests_total counter\n"
+                        "havka_requests_total{type=\"post\"} 3\n"
+                        "havka_requests_total{type=\"get\"} 5\n"),
+              std::string::npos);
+    ASSERT_NE(text.find("# TYPE havka_stage_seconds histogram\n"),
+              std::string::npos);
+    ASSERT_NE(text.find("havka_stage_seconds_bucket{le=\"1e-05\"} 0\n"),
+              std::string::npos);
+    ASSERT_NE(text.find("havka_stage_seconds_bucket{le=\"2.5e-05\"} 1\n"),
+              std::string::npos);
+    ASSERT_NE(text.find("havka_stage_seconds_bucket{le=\"0.0025\"} 2\n"),
+              std::string::npos);
+    ASSERT_NE(text.find("havka_stage_seconds_bucket{le=\"+Inf\"} 2\n"),
+              std::string::npos);
+    ASSERT_NE(text.find("havka_stage_seconds_count 2\n"), std::string::npos);
+    ASSERT_NE(text.find("havka_topic_messages{topic=\"a\\\"b\"} 7\n"),
+              std::string::npos);
+}
@@ -0,0 +1,99 @@
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+#include "metrics.h"
+
+TEST(MetricsTest, ShardedCounterTest) {
+    const int THREADS = 8;
+    const int INCREMENTS = 100000;
+
+    auto& counter = havka::metrics::Registry::instance().getCounter(
+        "test_counter_total", "Test counter");
+    std::vector<std::thread> threads;
+    for (int i = 0; i < THREADS; ++i) {
+        threads.emplace_back([&counter] {
+            for (int j = 0; j < INCREMENTS; ++j) {
+                counter.add();
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    ASSERT_EQ(counter.get(), THREADS * INCREMENTS);
+}
+
+TEST(MetricsTest, GaugeTest) {
+    havka::metrics::Gauge gauge;
+    gauge.add(5);
+    std::thread([&gauge] { gauge.add(-7); }).join();
+    ASSERT_EQ(gauge.get(), -2);
+}
+
+TEST(MetricsTest, LatencyHistogramTest) {
+    havka::metrics::LatencyHistogram latency;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; ++i) {
+        threads.emplace_back([&latency] {
+            for (std::uint64_t value = 1; value <= 1000; ++value) {
+                latency.record(value * 1000);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    auto histogram = latency.get();
+    ASSERT_EQ(histogram.getCount(), 4000);
+    ASSERT_NEAR(histogram.getPercentile(50), 500000, 500000 * 0.02);
+    ASSERT_NEAR(histogram.getMax(), 1000000, 1000000 * 0.02);
+}
+
+TEST(MetricsTest, RegistryTest) {
+    auto& registry = havka::metrics::Registry::instance();
+    auto& first = registry.getCounter("test_requests_total", "Requests",
+                                      {{"type", "post"}});
+    auto& second = registry.getCounter("test_requests_total", "Requests",
+                                       {{"type", "get"}});
+    ASSERT_NE(&first, &second);
+    ASSERT_EQ(&first, &registry.getCounter("test_requests_total", "Requests",
+                                           {{"type", "post"}}));
+    first.add(3);
+
+    bool found = false;
+    for (const auto& sample : registry.collect()) {
+        if (sample.name == "test_requests_total" &&
+            sample.labels == havka::metrics::Labels{{"type", "post"}}) {
+            ASSERT_EQ(sample.type, havka::metrics::MetricType::Counter);
+            ASSERT_EQ(sample.value, 3);
+            found = true;
+        }
+    }
+    ASSERT_TRUE(found);
+}
+
+TEST(MetricsTest, BucketHistogramTest) {
+    havka::metrics::BucketHistogram buckets;
+    buckets.record(10000);        /// 10us, bound is inclusive
+    buckets.record(10001);
+    buckets.record(3000000);      /// 3ms
+    buckets.record(20000000000);  /// 20s
+    ASSERT_EQ(buckets.getCount(), 4);
+    ASSERT_EQ(buckets.counts[0], 1);
+    ASSERT_EQ(buckets.counts[1], 1);
+    ASSERT_EQ(buckets.counts[8], 1);
+    ASSERT_EQ(buckets.counts.back(), 1);
+    ASSERT_EQ(buckets.sum, 20003020001);
+
+    havka::Histogram histogram;
+    histogram.record(20000);
+    histogram.record(3000000);
+    histogram.record(20000000000);
+    auto converted = havka::metrics::BucketHistogram::fromHistogram(histogram);
+    ASSERT_EQ(converted.getCount(), 3);
+    ASSERT_EQ(converted.counts[1], 1);
+    ASSERT_EQ(converted.counts[8], 1);
+    ASSERT_EQ(converted.counts.back(), 1);
+}
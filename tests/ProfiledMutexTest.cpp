@@ -0,0 +1,66 @@
+#include <gtest/gtest.h>
+
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "metrics.h"
+#include "profiled_mutex.h"
+
+TEST(ProfiledMutexTest, MutualExclusionTest) {
+    const int THREADS = 4;
+    const int INCREMENTS = 100000;
+
+    havka::ProfiledMutex mutex("test_exclusion");
+    long long counter = 0;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < THREADS; ++i) {
+        threads.emplace_back([&] {
+            for (int j = 0; j < INCREMENTS; ++j) {
+                std::lock_guard<havka::ProfiledMutex> lock(mutex);
+                ++counter;
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    ASSERT_EQ(counter, THREADS * INCREMENTS);
+
+    std::unique_lock<havka::ProfiledMutex> lock(mutex, std::try_to_lock);
+    ASSERT_TRUE(lock.owns_lock());
+    std::thread([&mutex] { ASSERT_FALSE(mutex.try_lock()); }).join();
+}
+
+#ifdef HAVKA_PROFILE_LOCKS
+TEST(ProfiledMutexTest, ContentionMetricsTest) {
+    havka::ProfiledMutex mutex("test_contention");
+    havka::ProfiledMutex other("test_contention");
+
+    {
+        std::lock_guard<havka::ProfiledMutex> lock(other);
+    }
+    std::unique_lock<havka::ProfiledMutex> holder(mutex);
+    std::thread waiter([&mutex] {
+        std::lock_guard<havka::ProfiledMutex> lock(mutex);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    holder.unlock();
+    waiter.join();
+
+    auto& registry = havka::metrics::Registry::instance();
+    havka::metrics::Labels labels = {{"lock", "test_contention"}};
+    auto wait = registry.getHistogram("havka_lock_wait_seconds", "", labels)
+                    .get();
+    auto hold = registry.getHistogram("havka_lock_hold_seconds", "", labels)
+                    .get();
+    /// mutexes of one site share metrics
+    ASSERT_EQ(wait.getCount(), 3);
+    ASSERT_EQ(hold.getCount(), 3);
+    ASSERT_GE(wait.getMax(), 10000000);
+    ASSERT_GE(hold.getMax(), 10000000);
+    ASSERT_EQ(registry.getCounter("havka_lock_contended_total", "", labels)
+                  .get(),
+              1);
+}
+#endif
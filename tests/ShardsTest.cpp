@@ -0,0 +1,120 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <boost/asio.hpp>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "server/shards.h"
+
+TEST(ShardsTest, SpscRingTest) {
+    havka::SpscRing<int> ring(4);
+    ASSERT_TRUE(ring.empty());
+    for (int i = 0; i < 4; ++i) {
+        ASSERT_TRUE(ring.push(i));
+    }
+    int item = 10;
+    ASSERT_FALSE(ring.push(item));
+    ASSERT_EQ(item, 10);
+
+    for (int i = 0; i < 4; ++i) {
+        ASSERT_TRUE(ring.pop(item));
+        ASSERT_EQ(item, i);
+        /// ring wraps around
+        int next = i + 4;
+        ASSERT_TRUE(ring.push(next));
+    }
+    for (int i = 4; i < 8; ++i) {
+        ASSERT_TRUE(ring.pop(item));
+        ASSERT_EQ(item, i);
+    }
+    ASSERT_FALSE(ring.pop(item));
+    ASSERT_TRUE(ring.empty());
+}
+
+TEST(ShardsTest, SpscRingThreadsTest) {
+    const int ITEMS = 1000000;
+
+    havka::SpscRing<int> ring(64);
+    std::thread producer([&] {
+        for (int i = 0; i < ITEMS; ++i) {
+            int item = i;
+            while (!ring.push(item)) {
+                std::this_thread::yield();
+            }
+        }
+    });
+    int item;
+    for (int i = 0; i < ITEMS; ++i) {
+        while (!ring.pop(item)) {
+            std::this_thread::yield();
+        }
+        ASSERT_EQ(item, i);
+    }
+    producer.join();
+}
+
+TEST(ShardsTest, ExecutorTest) {
+    const std::size_t SHARDS = 3;
+    const int TASKS = 10000;
+
+    std::vector<std::unique_ptr<boost::asio::io_context>> contexts;
+    std::vector<boost::asio::io_context*> pointers;
+    for (std::size_t i = 0; i < SHARDS; ++i) {
+        contexts.push_back(std::make_unique<boost::asio::io_context>(1));
+        pointers.push_back(contexts.back().get());
+    }
+    havka::ShardExecutor executor(pointers);
+    ASSERT_EQ(executor.size(), SHARDS);
+    ASSERT_EQ(havka::ShardExecutor::getCurrentShard(),
+              havka::ShardExecutor::kNoShard);
+
+    std::vector<std::atomic<int>> done(SHARDS);
+    std::atomic<int> wrongThread{0};
+    std::atomic<int> total{0};
+    /// every shard sends tasks to all shards, more than fits in mailboxes
+    for (std::size_t from = 0; from < SHARDS; ++from) {
+        boost::asio::post(*contexts[from], [&, from] {
+            for (int i = 0; i < TASKS; ++i) {
+                auto to = (from + i) % SHARDS;
+                executor.dispatch(to, [&, to] {
+                    if (havka::ShardExecutor::getCurrentShard() != to) {
+                        ++wrongThread;
+                    }
+                    ++done[to];
+                    if (++total == static_cast<int>(SHARDS) * TASKS) {
+                        for (auto& context : contexts) {
+                            context->stop();
+                        }
+                    }
+                });
+            }
+        });
+    }
+
+    std::vector<std::thread> threads;
+    for (std::size_t i = 0; i < SHARDS; ++i) {
+        threads.emplace_back([&, i] {
+            havka::ShardExecutor::bindThread(i);
+            auto guard = boost::asio::make_work_guard(*contexts[i]);
+            contexts[i]->run();
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    ASSERT_EQ(total, static_cast<int>(SHARDS) * TASKS);
+    ASSERT_EQ(wrongThread, 0);
+    for (std::size_t i = 0; i < SHARDS; ++i) {
+        ASSERT_EQ(done[i], TASKS);
+    }
+
+    /// tasks of threads which do not own shards are posted
+    int posted = 0;
+    executor.dispatch(1, [&] { ++posted; });
+    ASSERT_EQ(posted, 0);
+    contexts[1]->restart();
+    contexts[1]->run();
+    ASSERT_EQ(posted, 1);
+}
@@ -0,0 +1,141 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "shm_ring.h"
+
+TEST(ShmRingTest, PushPopTest) {
+    const std::size_t CAPACITY = 64;
+    std::vector<char> memory(havka::ShmRing::getMemorySize(CAPACITY) + 64);
+    /// control block must be aligned as in mapped memory
+    auto aligned = reinterpret_cast<char*>(
+        (reinterpret_cast<std::uintptr_t>(memory.data()) + 63) & ~63ULL);
+    havka::ShmRing ring(aligned, CAPACITY, true);
+    ASSERT_TRUE(ring.empty());
+
+    char buffer[64];
+    std::size_t size;
+    ASSERT_FALSE(ring.pop(buffer, sizeof(buffer), size));
+    /// frames of 4 + 20 bytes wrap around the end of ring
+    for (int i = 0; i < 10; ++i) {
+        std::string frame(20, static_cast<char>('a' + i));
+        ASSERT_TRUE(ring.push(frame.data(), frame.size()));
+        ASSERT_TRUE(ring.push(frame.data(), frame.size()));
+        ASSERT_FALSE(ring.push(frame.data(), frame.size()));
+        for (int j = 0; j < 2; ++j) {
+            ASSERT_TRUE(ring.pop(buffer, sizeof(buffer), size));
+            ASSERT_EQ(std::string(buffer, size), frame);
+        }
+        ASSERT_TRUE(ring.empty());
+    }
+
+    /// longer frames are truncated
+    ASSERT_TRUE(ring.push("0123456789", 10));
+    ASSERT_TRUE(ring.push("ab", 2));
+    ASSERT_TRUE(ring.pop(buffer, 4, size));
+    ASSERT_EQ(std::string(buffer, size), "0123");
+    ASSERT_TRUE(ring.pop(buffer, sizeof(buffer), size));
+    ASSERT_EQ(std::string(buffer, size), "ab");
+
+    /// frame gathered from parts
+    iovec parts[] = {{const_cast<char*>("head"), 4},
+                     {nullptr, 0},
+                     {const_cast<char*>("tail"), 4}};
+    ASSERT_TRUE(ring.push(parts, 3));
+    ASSERT_TRUE(ring.pop(buffer, sizeof(buffer), size));
+    ASSERT_EQ(std::string(buffer, size), "headtail");
+
+    /// frame which can never fit breaks the ring
+    ASSERT_FALSE(ring.isBroken());
+    ASSERT_FALSE(ring.push(buffer, CAPACITY));
+    ASSERT_TRUE(ring.isBroken());
+}
+
+TEST(ShmRingTest, BrokenFrameTest) {
+    const std::size_t CAPACITY = 64;
+    std::vector<char> memory(havka::ShmRing::getMemorySize(CAPACITY) + 64);
+    auto aligned = reinterpret_cast<char*>(
+        (reinterpret_cast<std::uintptr_t>(memory.data()) + 63) & ~63ULL);
+    havka::ShmRing ring(aligned, CAPACITY, true);
+
+    /// length written by the other side is larger than the frame
+    ASSERT_TRUE(ring.push("abcd", 4));
+    std::uint32_t length = 1000;
+    std::memcpy(aligned + sizeof(havka::ShmRing::Header), &length,
+                sizeof(length));
+    char buffer[64];
+    std::size_t size;
+    ASSERT_FALSE(ring.pop(buffer, sizeof(buffer), size));
+    ASSERT_TRUE(ring.isBroken());
+    /// nothing is pushed or popped after it
+    ASSERT_FALSE(ring.push("ab", 2));
+    ASSERT_FALSE(ring.pop(buffer, sizeof(buffer), size));
+}
+
+TEST(ShmRingTest, BrokenHeadTest) {
+    const std::size_t CAPACITY = 64;
+    std::vector<char> memory(havka::ShmRing::getMemorySize(CAPACITY) + 64);
+    auto aligned = reinterpret_cast<char*>(
+        (reinterpret_cast<std::uintptr_t>(memory.data()) + 63) & ~63ULL);
+    havka::ShmRing ring(aligned, CAPACITY, true);
+    ASSERT_TRUE(ring.push("abcd", 4));
+
+    /// head written by the other side is ahead of tail
+    auto header = reinterpret_cast<havka::ShmRing::Header*>(aligned);
+    header->head.store(1000);
+    ASSERT_FALSE(ring.push("ab", 2));
+    ASSERT_TRUE(ring.isBroken());
+    /// nothing is pushed after it
+    header->head.store(header->tail.load());
+    ASSERT_FALSE(ring.push("ab", 2));
+}
+
+TEST(ShmRingTest, ChannelTest) {
+    const std::string name = "/havka-test-channel";
+    havka::ShmChannel::unlink(name);
+    ASSERT_FALSE(havka::ShmChannel(name).good());
+
+    havka::ShmChannel server(name, 4096);
+    ASSERT_TRUE(server.good());
+    /// name is not reused while it exists
+    ASSERT_FALSE(havka::ShmChannel(name, 4096).good());
+    havka::ShmChannel client(name);
+    ASSERT_TRUE(client.good());
+    havka::ShmChannel::unlink(name);
+
+    const int FRAMES = 10000;
+    std::thread echo([&server] {
+        char buffer[16];
+        std::size_t size;
+        while (!server.isClosed()) {
+            if (!server.getRequests().pop(buffer, sizeof(buffer), size)) {
+                server.getRequests().wait(std::chrono::milliseconds(100));
+                continue;
+            }
+            while (!server.getResponses().push(buffer, size)) {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    char buffer[16];
+    std::size_t size;
+    for (int i = 0; i < FRAMES; ++i) {
+        ASSERT_TRUE(
+            client.getRequests().push(reinterpret_cast<char*>(&i), sizeof(i)));
+        while (!client.getResponses().pop(buffer, sizeof(buffer), size)) {
+            client.getResponses().wait(std::chrono::milliseconds(100));
+        }
+        ASSERT_EQ(size, sizeof(i));
+        ASSERT_EQ(*reinterpret_cast<int*>(buffer), i);
+    }
+    ASSERT_FALSE(client.isClosed());
+    client.close();
+    echo.join();
+    ASSERT_TRUE(server.isClosed());
+}
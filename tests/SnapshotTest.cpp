@@ -0,0 +1,145 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+
+#include "server/snapshot.h"
+#include "server/storage.h"
+
+namespace {
+class SnapshotTest : public testing::Test {
+public:
+    const std::string path = "snapshot_test.bin";
+
+    ~SnapshotTest() override { std::remove(path.c_str()); }
+
+    /**
+     * Creates message with given data
+     * @param data data of message
+     * @param dataType type of data
+     * @return message
+     */
+    static havka::Message makeMessage(
+        const std::string& data,
+        havka::MessageDataType dataType = havka::MessageDataType::Text) {
+        havka::Message message;
+        message.setData(data.c_str(), data.size(), dataType);
+        return message;
+    }
+};
+}  // namespace
+
+TEST_F(SnapshotTest, WriteReadTest) {
+    std::vector<havka::Message> messages1 = {
+        makeMessage("111"), makeMessage(std::string("\0\1\2", 3),
+                                        havka::MessageDataType::Binary)};
+    std::vector<havka::Message> messages2 = {makeMessage("")};
+    {
+        havka::SnapshotWriter writer(path);
+        ASSERT_TRUE(writer.good());
+        writer.addTopic("tag1", messages1);
+        writer.addTopic("orders.created.eu", messages2);
+        ASSERT_TRUE(writer.finish());
+    }
+
+    havka::SnapshotReader reader(path);
+    ASSERT_TRUE(reader.good());
+    ASSERT_EQ(reader.getTopicsNumber(), 2);
+    havka::TopicSnapshot snapshot;
+    ASSERT_TRUE(reader.readTopic(1, snapshot));
+    ASSERT_EQ(snapshot.topic, "orders.created.eu");
+    ASSERT_EQ(snapshot.messages, messages2);
+    ASSERT_TRUE(reader.readTopic(0, snapshot));
+    ASSERT_EQ(snapshot.topic, "tag1");
+    ASSERT_EQ(snapshot.messages, messages1);
+    ASSERT_EQ(snapshot.messages[1].dataType, havka::MessageDataType::Binary);
+    ASSERT_FALSE(reader.readTopic(2, snapshot));
+}
+
+TEST_F(SnapshotTest, CorruptedFileTest) {
+    std::ofstream file(path, std::ios::trunc | std::ios::binary);
+    file << "definitely not a snapshot, but long enough for header";
+    file.close();
+
+    havka::SnapshotReader reader(path);
+    ASSERT_FALSE(reader.good());
+    ASSERT_EQ(reader.getTopicsNumber(), 0);
+
+    havka::SnapshotReader absent("non-existing-snapshot.bin");
+    ASSERT_FALSE(absent.good());
+}
+
+TEST_F(SnapshotTest, RamStorageRestartTest) {
+    const int TAGS = 1000;
+    const int MESSAGES = 20;
+
+    auto storage =
+        havka::createMessageStorage(StorageType::RAM, QueueType::MutexQueue);
+    for (int i = 0; i < TAGS; ++i) {
+        for (int j = 0; j < MESSAGES; ++j) {
+            storage->postMessage(makeMessage(std::to_string(i * MESSAGES + j)),
+                                 "tag." + std::to_string(i));
+        }
+    }
+    /// empty queue is not written
+    storage->getMessageNonblocking("tag.0");
+    ASSERT_TRUE(storage->saveSnapshot(path));
+
+    auto restarted =
+        havka::createMessageStorage(StorageType::RAM, QueueType::MutexQueue);
+    ASSERT_TRUE(restarted->loadSnapshot(path, 4));
+    for (int i = 0; i < TAGS; ++i) {
+        std::string tag = "tag." + std::to_string(i);
+        for (int j = i == 0 ? 1 : 0; j < MESSAGES; ++j) {
+            ASSERT_EQ(restarted->getMessageNonblocking(tag),
+                      makeMessage(std::to_string(i * MESSAGES + j)));
+        }
+        ASSERT_EQ(restarted->getMessageNonblocking(tag), std::nullopt);
+    }
+    /// original storage is not changed by snapshot
+    ASSERT_EQ(storage->getMessageNonblocking("tag.1"), makeMessage("20"));
+}
+
+TEST_F(SnapshotTest, LogRestartTest) {
+    auto storage =
+        havka::createMessageStorage(StorageType::RAM, QueueType::MutexQueue);
+    storage->setTopicMode("log.*", TopicMode::Log);
+    for (int i = 0; i < 5; ++i) {
+        storage->postMessage(makeMessage(std::to_string(i)), "log.a");
+    }
+    ASSERT_EQ(storage->getMessageNonblocking("log.a", "g1"), makeMessage("0"));
+    ASSERT_EQ(storage->getMessageNonblocking("log.a", "g1"), makeMessage("1"));
+    ASSERT_EQ(storage->seekLog("log.a", "g2", 4), 4);
+    ASSERT_TRUE(storage->saveSnapshot(path));
+
+    havka::SnapshotReader reader(path);
+    ASSERT_TRUE(reader.good());
+    ASSERT_EQ(reader.getTopicsNumber(), 1);
+    havka::TopicSnapshot snapshot;
+    ASSERT_TRUE(reader.readTopic(0, snapshot));
+    ASSERT_TRUE(snapshot.isLog);
+    ASSERT_EQ(snapshot.topic, "log.a");
+    ASSERT_EQ(snapshot.messages.size(), 5);
+    ASSERT_EQ(snapshot.groupOffsets.size(), 2);
+
+    auto restarted =
+        havka::createMessageStorage(StorageType::RAM, QueueType::MutexQueue);
+    restarted->setTopicMode("log.*", TopicMode::Log);
+    ASSERT_TRUE(restarted->loadSnapshot(path, 2));
+    /// consumer groups continue from their offsets
+    havka::DeliveryInfo info;
+    ASSERT_EQ(restarted->getMessageNonblocking("log.a", "g1", &info),
+              makeMessage("2"));
+    ASSERT_EQ(info.offset, 2);
+    ASSERT_EQ(restarted->getMessageNonblocking("log.a", "g2"),
+              makeMessage("4"));
+    ASSERT_EQ(restarted->getMessageNonblocking("log.a", "g2"), std::nullopt);
+    /// new group reads all retained messages
+    ASSERT_EQ(restarted->getMessageNonblocking("log.a", "g3"),
+              makeMessage("0"));
+    /// offsets are not reused after restart
+    restarted->postMessage(makeMessage("5"), "log.a");
+    ASSERT_EQ(restarted->getMessageNonblocking("log.a", "g2", &info),
+              makeMessage("5"));
+    ASSERT_EQ(info.offset, 5);
+}
@@ -1,5 +1,7 @@
 #include <gtest/gtest.h>
 
+#include <chrono>
+#include <cstdio>
 #include <set>
 #include <thread>
 
@@ -224,6 +226,207 @@ TEST_F(StorageTest, RamMutexStorage_SimpleSingleThreadTest2) {
     ASSERT_EQ(storage->getMessageNonblocking("tag3"), std::nullopt);
 }
 
+TEST_F(StorageTest, RamMutexStorage_WildcardNonblockingTest) {
+    storage =
+        havka::createMessageStorage(StorageType::RAM, QueueType::MutexQueue);
+
+    havka::Message mes1, mes2, mes3;
+    mes1.setData("111", 3, havka::MessageDataType::Text);
+    mes2.setData("2222", 4, havka::MessageDataType::Binary);
+    mes3.setData("33333", 5, havka::MessageDataType::Text);
+    storage->postMessage(mes1, "orders.created.eu");
+    storage->postMessage(mes2, "orders.created.us");
+    storage->postMessage(mes3, "orders.eu");
+
+    havka::DeliveryInfo info;
+    ASSERT_EQ(storage->getMessageNonblocking("orders.*.eu", "", &info), mes1);
+    ASSERT_EQ(info.topic, "orders.created.eu");
+    ASSERT_EQ(storage->getMessageNonblocking("orders.*.eu"), std::nullopt);
+    ASSERT_EQ(storage->getMessageNonblocking("*.eu", "", &info), mes3);
+    ASSERT_EQ(info.topic, "orders.eu");
+    ASSERT_EQ(storage->getMessageNonblocking("#", "", &info), mes2);
+    ASSERT_EQ(info.topic, "orders.created.us");
+    ASSERT_EQ(storage->getMessageNonblocking("#"), std::nullopt);
+}
+
+TEST_F(StorageTest, RamMutexStorage_LogConsumerGroupsTest) {
+    storage =
+        havka::createMessageStorage(StorageType::RAM, QueueType::MutexQueue);
+    storage->setTopicMode("events.#", TopicMode::Log);
+
+    havka::Message mes1, mes2, mes3;
+    mes1.setData("111", 3, havka::MessageDataType::Text);
+    mes2.setData("2222", 4, havka::MessageDataType::Binary);
+    mes3.setData("33333", 5, havka::MessageDataType::Text);
+    storage->postMessage(mes1, "events.a");
+    storage->postMessage(mes2, "events.a");
+
+    havka::DeliveryInfo info;
+    ASSERT_EQ(storage->getMessageNonblocking("events.a", "g1", &info), mes1);
+    ASSERT_EQ(info.offset, 0);
+    ASSERT_EQ(storage->getMessageNonblocking("events.a", "g2", &info), mes1);
+    ASSERT_EQ(storage->getMessageNonblocking("events.a", "g1", &info), mes2);
+    ASSERT_EQ(info.offset, 1);
+    ASSERT_EQ(storage->getMessageNonblocking("events.a", "g1"), std::nullopt);
+
+    storage->postMessage(mes3, "events.a");
+    ASSERT_EQ(storage->getMessageNonblocking("events.a", "g1"), mes3);
+    ASSERT_EQ(storage->getMessageNonblocking("events.a", "g2"), mes2);
+
+    /// replay
+    ASSERT_EQ(storage->seekLog("events.a", "g1", 1), 1);
+    ASSERT_EQ(storage->getMessageNonblocking("events.a", "g1"), mes2);
+    ASSERT_EQ(storage->seekLog("events.a", "g1", 100), 3);
+    ASSERT_EQ(storage->getMessageNonblocking("events.a", "g1"), std::nullopt);
+    ASSERT_EQ(storage->seekLog("queue.topic", "g1", 0), std::nullopt);
+}
+
+TEST_F(StorageTest, RamMutexStorage_GarbageCollectionTest) {
+    storage =
+        havka::createMessageStorage(StorageType::RAM, QueueType::MutexQueue);
+
+    havka::Message mes1, mes2;
+    mes1.setData("111", 3, havka::MessageDataType::Text);
+    mes2.setData("2222", 4, havka::MessageDataType::Binary);
+    storage->postMessage(mes1, "idle");
+    storage->postMessage(mes2, "busy");
+    ASSERT_EQ(storage->getMessageNonblocking("idle"), mes1);
+    ASSERT_EQ(storage->getQueuesNumber(), 2);
+
+    /// topics were used since the previous collection
+    ASSERT_EQ(storage->collectGarbage(), 0);
+    /// empty idle topic is erased, non-empty topic is kept
+    ASSERT_EQ(storage->collectGarbage(), 1);
+    ASSERT_EQ(storage->getQueuesNumber(), 1);
+    ASSERT_EQ(storage->getMessageNonblocking("#"), mes2);
+
+    /// erased topic works as a new one
+    storage->postMessage(mes1, "idle");
+    ASSERT_EQ(storage->getMessageNonblocking("idle"), mes1);
+    ASSERT_EQ(storage->collectGarbage(), 0);
+    ASSERT_EQ(storage->collectGarbage(), 2);
+    ASSERT_EQ(storage->getQueuesNumber(), 0);
+}
+
+TEST_F(StorageTest, RamMutexStorage_QueueTimeTest) {
+    storage =
+        havka::createMessageStorage(StorageType::RAM, QueueType::MutexQueue);
+
+    havka::Message mes1, mes2;
+    mes1.setData("111", 3, havka::MessageDataType::Text);
+    mes2.setData("2222", 4, havka::MessageDataType::Binary);
+    auto before = std::chrono::duration_cast<std::chrono::microseconds>(
+                      std::chrono::system_clock::now().time_since_epoch())
+                      .count();
+    storage->postMessage(mes1, "orders");
+    storage->postMessage(mes2, "orders");
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+
+    auto stats = storage->getTopicStats();
+    ASSERT_EQ(stats.size(), 1);
+    ASSERT_EQ(stats[0].topic, "orders");
+    ASSERT_EQ(stats[0].depth, 2);
+    ASSERT_GE(stats[0].oldestAge, 30000000);
+    ASSERT_EQ(stats[0].queueTime.getCount(), 0);
+
+    havka::DeliveryInfo info;
+    auto message = storage->getMessageNonblocking("orders", "", &info);
+    ASSERT_EQ(message, mes1);
+    ASSERT_GE(message->enqueueTime, before);
+    ASSERT_EQ(storage->getMessageNonblocking("#"), mes2);
+
+    stats = storage->getTopicStats();
+    ASSERT_EQ(stats[0].depth, 0);
+    ASSERT_EQ(stats[0].oldestAge, 0);
+    ASSERT_EQ(stats[0].queueTime.getCount(), 2);
+    ASSERT_GE(stats[0].queueTime.sum, 2 * 30000000);
+    /// no message is in buckets up to 25ms
+    for (std::size_t i = 0; i <= 10; ++i) {
+        ASSERT_EQ(stats[0].queueTime.counts[i], 0);
+    }
+}
+
+TEST_F(StorageTest, ShardedStorage_SimpleTest) {
+    storage = havka::createMessageStorage(StorageType::RAM,
+                                          QueueType::MutexQueue, 4);
+    storage->setTopicMode("events.#", TopicMode::Log);
+
+    std::vector<havka::Message> messages(16);
+    for (std::size_t i = 0; i < messages.size(); ++i) {
+        auto data = std::to_string(i);
+        messages[i].setData(data.c_str(), data.size(),
+                            havka::MessageDataType::Text);
+        storage->postMessage(messages[i], "orders." + data);
+    }
+    storage->postMessage(messages[0], "events.a");
+    ASSERT_EQ(storage->getTopicStats().size(), messages.size());
+
+    for (std::size_t i = 0; i < messages.size(); i += 2) {
+        ASSERT_EQ(storage->getMessageNonblocking("orders." + std::to_string(i)),
+                  messages[i]);
+    }
+    /// pattern gets go through all shards
+    std::set<std::string> topics;
+    havka::DeliveryInfo info;
+    while (storage->getMessageNonblocking("orders.*", "", &info)) {
+        topics.insert(info.topic);
+    }
+    ASSERT_EQ(topics.size(), messages.size() / 2);
+    ASSERT_EQ(storage->getMessageBlocking("orders.*", nullptr), std::nullopt);
+
+    ASSERT_EQ(storage->getMessageNonblocking("events.a", "g1"), messages[0]);
+    ASSERT_EQ(storage->seekLog("events.a", "g1", 0), 0);
+    ASSERT_EQ(storage->getMessageNonblocking("events.a", "g1"), messages[0]);
+}
+
+TEST_F(StorageTest, ShardedStorage_SnapshotTest) {
+    const std::string path = "sharded_snapshot_test.bin";
+    storage = havka::createMessageStorage(StorageType::RAM,
+                                          QueueType::MutexQueue, 3);
+    havka::Message mes1, mes2;
+    mes1.setData("111", 3, havka::MessageDataType::Text);
+    mes2.setData("2222", 4, havka::MessageDataType::Binary);
+    for (int i = 0; i < 10; ++i) {
+        storage->postMessage(mes1, "tag" + std::to_string(i));
+        storage->postMessage(mes2, "tag" + std::to_string(i));
+    }
+    ASSERT_TRUE(storage->saveSnapshot(path));
+
+    /// snapshot does not depend on number of shards
+    for (std::size_t shards : {1, 5}) {
+        auto loaded = havka::createMessageStorage(
+            StorageType::RAM, QueueType::MutexQueue, shards);
+        ASSERT_TRUE(loaded->loadSnapshot(path, 2));
+        for (int i = 0; i < 10; ++i) {
+            auto tag = "tag" + std::to_string(i);
+            ASSERT_EQ(loaded->getMessageNonblocking(tag), mes1);
+            ASSERT_EQ(loaded->getMessageNonblocking(tag), mes2);
+        }
+    }
+    std::remove(path.c_str());
+}
+
+TEST_F(StorageTest, RamMutexStorage_LargeShortLivedTopicsTest) {
+    storage =
+        havka::createMessageStorage(StorageType::RAM, QueueType::MutexQueue);
+
+    const int TOPICS = 1000000;
+    const int GC_PERIOD = 10000;
+
+    havka::Message message;
+    message.setData("reply", 5, havka::MessageDataType::Text);
+    for (int i = 0; i < TOPICS; ++i) {
+        std::string tag = "reply." + std::to_string(i);
+        storage->postMessage(message, tag);
+        ASSERT_EQ(storage->getMessageNonblocking(tag), message);
+        if ((i + 1) % GC_PERIOD == 0) {
+            storage->collectGarbage();
+            /// only topics of the last two periods can be alive
+            ASSERT_LE(storage->getQueuesNumber(), 2 * GC_PERIOD);
+        }
+    }
+}
+
 TEST_F(StorageTest, RamMutexStorage_LargeSingleThreadTest) {
     storage =
         havka::createMessageStorage(StorageType::RAM, QueueType::MutexQueue);
@@ -0,0 +1,142 @@
+#include <gtest/gtest.h>
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include "server/topic_trie.hpp"
+
+namespace {
+class TopicTrieTest : public testing::Test {
+public:
+    havka::TopicTrie<int> trie;
+
+    /**
+     * Collects keys of stored patterns matching topic
+     * @param topic concrete topic
+     * @return set of matching keys
+     */
+    std::set<std::string> matching(const std::string& topic) {
+        std::set<std::string> keys;
+        trie.forEachMatching(topic, [&](const std::string& key, int&) {
+            keys.insert(key);
+            return false;
+        });
+        return keys;
+    }
+
+    /**
+     * Collects keys of stored topics matched by pattern
+     * @param pattern topic pattern
+     * @return set of matched keys
+     */
+    std::set<std::string> matchedBy(const std::string& pattern) {
+        std::set<std::string> keys;
+        trie.forEachMatchedBy(pattern, [&](const std::string& key, int&) {
+            keys.insert(key);
+            return false;
+        });
+        return keys;
+    }
+};
+}  // namespace
+
+TEST_F(TopicTrieTest, IsTopicPatternTest) {
+    ASSERT_FALSE(havka::isTopicPattern("orders.created.eu"));
+    ASSERT_FALSE(havka::isTopicPattern("orders*.eu"));
+    ASSERT_FALSE(havka::isTopicPattern(""));
+    ASSERT_TRUE(havka::isTopicPattern("orders.*.eu"));
+    ASSERT_TRUE(havka::isTopicPattern("orders.#"));
+    ASSERT_TRUE(havka::isTopicPattern("*"));
+}
+
+TEST_F(TopicTrieTest, ExactKeysTest) {
+    ASSERT_TRUE(trie.empty());
+    trie["a.b"] = 1;
+    trie["a"] = 2;
+    trie["a.b.c"] = 3;
+    ASSERT_EQ(trie.size(), 3);
+    ASSERT_EQ(*trie.find("a.b"), 1);
+    ASSERT_EQ(*trie.find("a"), 2);
+    ASSERT_EQ(trie.find("a.c"), nullptr);
+    ASSERT_EQ(trie.find("a.b.c.d"), nullptr);
+
+    ASSERT_TRUE(trie.erase("a.b"));
+    ASSERT_FALSE(trie.erase("a.b"));
+    ASSERT_EQ(trie.find("a.b"), nullptr);
+    ASSERT_EQ(*trie.find("a.b.c"), 3);
+    ASSERT_TRUE(trie.erase("a.b.c"));
+    ASSERT_TRUE(trie.erase("a"));
+    ASSERT_TRUE(trie.empty());
+}
+
+TEST_F(TopicTrieTest, ForEachMatchingTest) {
+    trie["orders.*.eu"];
+    trie["orders.#"];
+    trie["#"];
+    trie["orders.created.eu"];
+    trie["*.created.*"];
+    trie["orders.#.eu"];
+
+    ASSERT_EQ(matching("orders.created.eu"),
+              std::set<std::string>({"orders.*.eu", "orders.#", "#",
+                                     "orders.created.eu", "*.created.*",
+                                     "orders.#.eu"}));
+    ASSERT_EQ(matching("orders.eu"),
+              std::set<std::string>({"orders.#", "#", "orders.#.eu"}));
+    ASSERT_EQ(matching("orders.created.us"),
+              std::set<std::string>({"orders.#", "#", "*.created.*"}));
+    ASSERT_EQ(matching("users"), std::set<std::string>({"#"}));
+    ASSERT_EQ(matching("orders.a.b.eu"),
+              std::set<std::string>({"orders.#", "#", "orders.#.eu"}));
+}
+
+TEST_F(TopicTrieTest, ForEachMatchedByTest) {
+    trie["orders.created.eu"];
+    trie["orders.created.us"];
+    trie["orders.deleted.eu"];
+    trie["orders.eu"];
+    trie["users.created.eu"];
+
+    ASSERT_EQ(matchedBy("orders.*.eu"),
+              std::set<std::string>(
+                  {"orders.created.eu", "orders.deleted.eu"}));
+    ASSERT_EQ(matchedBy("orders.#"),
+              std::set<std::string>({"orders.created.eu", "orders.created.us",
+                                     "orders.deleted.eu", "orders.eu"}));
+    ASSERT_EQ(matchedBy("#.eu"),
+              std::set<std::string>({"orders.created.eu", "orders.deleted.eu",
+                                     "orders.eu", "users.created.eu"}));
+    ASSERT_EQ(matchedBy("*.created.*"),
+              std::set<std::string>({"orders.created.eu", "orders.created.us",
+                                     "users.created.eu"}));
+    ASSERT_EQ(matchedBy("orders.eu"), std::set<std::string>({"orders.eu"}));
+    ASSERT_EQ(matchedBy("orders.*"), std::set<std::string>({"orders.eu"}));
+    ASSERT_TRUE(matchedBy("users.*").empty());
+}
+
+TEST_F(TopicTrieTest, EarlyStopTest) {
+    for (int i = 0; i < 100; ++i) {
+        trie["topic." + std::to_string(i)] = i;
+    }
+    int visited = 0;
+    trie.forEachMatchedBy("topic.*", [&](const std::string&, int&) {
+        ++visited;
+        return visited == 10;
+    });
+    ASSERT_EQ(visited, 10);
+}
+
+TEST_F(TopicTrieTest, InsertionOrderTest) {
+    const std::vector<std::string> patterns = {"orders.#", "#", "*.created",
+                                               "orders.*", "#.created"};
+    for (const auto& pattern : patterns) {
+        trie[pattern];
+    }
+    std::vector<std::string> keys;
+    trie.forEachMatching("orders.created", [&](const std::string& key, int&) {
+        keys.push_back(key);
+        return false;
+    });
+    ASSERT_EQ(keys, patterns);
+}
@@ -0,0 +1,78 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+#include "server/trace.h"
+
+namespace {
+
+havka::trace::RequestTrace createTrace(std::uint64_t totalUs) {
+    havka::trace::RequestTrace requestTrace;
+    requestTrace.type = havka::RequestType::PostMessageSafe;
+    requestTrace.received = 1000000;
+    requestTrace.decoded = requestTrace.received + 3000;
+    requestTrace.processed = requestTrace.decoded + 50000;
+    requestTrace.encoded = requestTrace.processed + 2000;
+    requestTrace.written = requestTrace.received + totalUs * 1000;
+    requestTrace.lockWait = 40000;
+    return requestTrace;
+}
+
+}  // namespace
+
+TEST(TraceTest, FormatTest) {
+    ASSERT_EQ(havka::trace::format(createTrace(100), "orders"),
+              "RequestType::PostMessageSafe 'orders' total 100us: decode 3us, "
+              "lock_wait 40us, storage 50us, encode 2us, write 45us");
+}
+
+TEST(TraceTest, SlowRequestLogTest) {
+    havka::trace::setEnabled(true);
+    havka::trace::setSlowRequestLog(std::chrono::microseconds(500), 1);
+    ASSERT_FALSE(havka::trace::shouldLog(createTrace(100)));
+    ASSERT_TRUE(havka::trace::shouldLog(createTrace(1000)));
+
+    havka::trace::setSlowRequestLog(std::chrono::microseconds(500), 4);
+    int logged = 0;
+    for (int i = 0; i < 40; ++i) {
+        logged += havka::trace::shouldLog(createTrace(1000));
+    }
+    ASSERT_EQ(logged, 10);
+
+    havka::trace::setSlowRequestLog(std::chrono::microseconds(-1), 1);
+    ASSERT_FALSE(havka::trace::shouldLog(createTrace(1000000)));
+
+    havka::trace::setSlowRequestLog(std::chrono::microseconds(0), 1);
+    havka::trace::setEnabled(false);
+    ASSERT_FALSE(havka::trace::shouldLog(createTrace(1000)));
+    havka::trace::setSlowRequestLog(std::chrono::microseconds(-1), 1);
+}
+
+TEST(TraceTest, LockWaitTest) {
+    std::mutex mutex;
+    havka::trace::takeLockWait();
+
+    havka::trace::setEnabled(false);
+    std::unique_lock<std::mutex> holder(mutex);
+    std::thread releaser([&holder] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        holder.unlock();
+    });
+    havka::trace::lock(mutex).unlock();
+    releaser.join();
+    ASSERT_EQ(havka::trace::takeLockWait(), 0);
+
+    havka::trace::setEnabled(true);
+    holder.lock();
+    releaser = std::thread([&holder] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        holder.unlock();
+    });
+    havka::trace::lock(mutex).unlock();
+    releaser.join();
+    ASSERT_GE(havka::trace::takeLockWait(), 10000000);
+    ASSERT_EQ(havka::trace::takeLockWait(), 0);
+    havka::trace::setEnabled(false);
+}
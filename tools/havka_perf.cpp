@@ -0,0 +1,288 @@
+/// Open-loop load generator for havka server.
+/**
+ * Producers post messages on a fixed schedule (rate / producers messages
+ * per second each) whatever the latency of previous requests is, and every
+ * message carries its intended send time. Consumers measure latency from
+ * the intended send time to receiving, so stalls of the server are not
+ * hidden by producers slowing down (coordinated omission).
+ *
+ * Usage:
+ *  havka-perf [--address=127.0.0.1] [--port=9090] [--socket=PATH]
+ *             [--shm=PATH] [--producers=1] [--consumers=1] [--topics=1]
+ *             [--payload=64] [--rate=10000] [--duration=10]
+ *
+ * With --socket clients connect to Unix domain socket of the server
+ * instead of address and port, with --shm they use shared memory
+ * transport set up by its socket.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "client/client.h"
+#include "histogram.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+/// Options of load
+struct PerfOptions {
+    std::string address{"127.0.0.1"};
+    unsigned short port{9090};
+    std::string socket;
+    std::string shm;
+    int producers{1};
+    int consumers{1};
+    int topics{1};
+    std::size_t payload{64};
+    double rate{10000};
+    int duration{10};
+};
+
+/// Results shared by all threads
+struct PerfResults {
+    std::atomic<std::uint64_t> sent{0};
+    std::atomic<std::uint64_t> errors{0};
+    std::atomic<std::uint64_t> received{0};
+    std::mutex mutex;
+    havka::Histogram latency;
+    Clock::time_point lastReceive;
+};
+
+std::uint64_t toNs(Clock::time_point time) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               time.time_since_epoch())
+        .count();
+}
+
+/**
+ * Parses options in format --name=value
+ * @return true on success
+ */
+bool parseOptions(int argc, char* argv[], PerfOptions& options) {
+    std::map<std::string, std::string> values;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto eq = arg.find('=');
+        if (arg.rfind("--", 0) != 0 || eq == std::string::npos) {
+            std::cerr << "Unknown argument '" << arg << "'\n";
+            return false;
+        }
+        values[arg.substr(2, eq - 2)] = arg.substr(eq + 1);
+    }
+    try {
+        for (const auto& [name, value] : values) {
+            if (name == "address") {
+                options.address = value;
+            } else if (name == "port") {
+                options.port = std::stoi(value);
+            } else if (name == "socket") {
+                options.socket = value;
+            } else if (name == "shm") {
+                options.shm = value;
+            } else if (name == "producers") {
+                options.producers = std::stoi(value);
+            } else if (name == "consumers") {
+                options.consumers = std::stoi(value);
+            } else if (name == "topics") {
+                options.topics = std::stoi(value);
+            } else if (name == "payload") {
+                options.payload = std::stoul(value);
+            } else if (name == "rate") {
+                options.rate = std::stod(value);
+            } else if (name == "duration") {
+                options.duration = std::stoi(value);
+            } else {
+                std::cerr << "Unknown option '" << name << "'\n";
+                return false;
+            }
+        }
+    } catch (std::exception& e) {
+        std::cerr << "Invalid option value: " << e.what() << '\n';
+        return false;
+    }
+    if (options.producers <= 0 || options.consumers <= 0 ||
+        options.topics <= 0 || options.rate <= 0 || options.duration <= 0) {
+        std::cerr << "Numbers of producers, consumers, topics, rate and "
+                     "duration must be positive\n";
+        return false;
+    }
+    /// intended send time is stored in payload
+    options.payload = std::max(options.payload, sizeof(std::uint64_t));
+    return true;
+}
+
+/// Creates connected client or returns nullptr
+std::unique_ptr<havka::BrokerSyncClient> connectClient(
+    const PerfOptions& options) {
+    std::unique_ptr<havka::BrokerSyncClient> client;
+    if (!options.shm.empty()) {
+        client = std::make_unique<havka::BrokerSyncClient>(
+            options.shm, options.payload + 1024,
+            havka::LocalTransport::SharedMemory);
+    } else if (!options.socket.empty()) {
+        client = std::make_unique<havka::BrokerSyncClient>(
+            options.socket, options.payload + 1024);
+    } else {
+        client = std::make_unique<havka::BrokerSyncClient>(
+            boost::asio::ip::make_address(options.address), options.port,
+            options.payload + 1024);
+    }
+    if (!client->connect()) {
+        return nullptr;
+    }
+    return client;
+}
+
+void runProducer(int index, const PerfOptions& options,
+                 const std::vector<std::string>& topics,
+                 Clock::time_point start, PerfResults& results) {
+    auto client = connectClient(options);
+    if (!client) {
+        std::cerr << "Producer " << index << " can not connect\n";
+        return;
+    }
+    havka::Message message;
+    std::string payload(options.payload, 'x');
+    auto interval = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(options.producers / options.rate));
+    auto end = start + std::chrono::seconds(options.duration);
+
+    /// producers are shifted, so their messages are interleaved
+    auto intended = start + interval * index / options.producers;
+    for (std::uint64_t i = index; intended < end;
+         i += options.producers, intended += interval) {
+        std::this_thread::sleep_until(intended);
+        std::uint64_t intendedNs = toNs(intended);
+        std::memcpy(payload.data(), &intendedNs, sizeof(intendedNs));
+        message.setData(payload.c_str(), payload.size(),
+                        havka::MessageDataType::Binary);
+        if (client->postMessage(message, topics[i % topics.size()],
+                                havka::RequestType::PostMessageSafe)) {
+            ++results.sent;
+        } else {
+            ++results.errors;
+        }
+    }
+}
+
+void runConsumer(int index, const PerfOptions& options,
+                 const std::vector<std::string>& topics,
+                 PerfResults& results) {
+    auto client = connectClient(options);
+    if (!client) {
+        std::cerr << "Consumer " << index << " can not connect\n";
+        return;
+    }
+    /// consumer reads its topics in the same round-robin order
+    /// as producers write them
+    std::vector<std::string> own;
+    for (std::size_t i = index; i < topics.size(); i += options.consumers) {
+        own.push_back(topics[i]);
+    }
+    if (own.empty()) {
+        return;
+    }
+
+    for (std::size_t i = 0;; i = (i + 1) % own.size()) {
+        auto message =
+            client->getMessage(own[i], havka::RequestType::GetMessageBlocking);
+        if (!message) {
+            ++results.errors;
+            break;
+        }
+        std::uint64_t received = toNs(Clock::now());
+        std::uint64_t intendedNs;
+        std::memcpy(&intendedNs, message->data.data(), sizeof(intendedNs));
+        {
+            std::lock_guard<std::mutex> lock(results.mutex);
+            results.latency.record(
+                received > intendedNs ? received - intendedNs : 0);
+            results.lastReceive = Clock::now();
+        }
+        ++results.received;
+    }
+}
+
+void printLatency(const std::string& name, std::uint64_t ns) {
+    std::cout << "  " << std::setw(6) << std::left << name << std::right
+              << std::setw(12) << std::fixed << std::setprecision(1)
+              << ns / 1000.0 << " us\n";
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    PerfOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        return 1;
+    }
+
+    /// unique topics, so runs against one server do not interfere
+    std::vector<std::string> topics;
+    for (int i = 0; i < options.topics; ++i) {
+        topics.push_back("perf." + std::to_string(getpid()) + "." +
+                         std::to_string(i));
+    }
+
+    PerfResults results;
+    std::vector<std::thread> consumers;
+    for (int i = 0; i < options.consumers; ++i) {
+        consumers.emplace_back(runConsumer, i, std::cref(options),
+                               std::cref(topics), std::ref(results));
+    }
+    /// consumers are waiting before load starts
+    auto start = Clock::now() + std::chrono::milliseconds(200);
+    std::vector<std::thread> producers;
+    for (int i = 0; i < options.producers; ++i) {
+        producers.emplace_back(runProducer, i, std::cref(options),
+                               std::cref(topics), start, std::ref(results));
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+
+    /// waiting for in-flight messages
+    auto drainDeadline = Clock::now() + std::chrono::seconds(5);
+    while (results.received < results.sent && Clock::now() < drainDeadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    std::lock_guard<std::mutex> lock(results.mutex);
+    double elapsed =
+        std::chrono::duration<double>(
+            std::max(results.lastReceive, start + std::chrono::seconds(
+                                                      options.duration)) -
+            start)
+            .count();
+    std::cout << "Producers: " << options.producers
+              << ", consumers: " << options.consumers
+              << ", topics: " << options.topics
+              << ", payload: " << options.payload << " bytes"
+              << ", target rate: " << options.rate << " msg/s\n";
+    std::cout << "Sent: " << results.sent << ", received: " << results.received
+              << ", errors: " << results.errors << '\n';
+    std::cout << "Throughput: " << std::fixed << std::setprecision(1)
+              << results.received / elapsed << " msg/s\n";
+    std::cout << "Latency (" << results.latency.getCount() << " samples):\n";
+    printLatency("p50", results.latency.getPercentile(50));
+    printLatency("p99", results.latency.getPercentile(99));
+    printLatency("p99.9", results.latency.getPercentile(99.9));
+    printLatency("max", results.latency.getMax());
+    std::cout.flush();
+    /// consumers are blocked in requests, process exits without joining them
+    std::_Exit(results.errors > 0 ? 2 : 0);
+}
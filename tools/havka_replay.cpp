@@ -0,0 +1,280 @@
+/// Replays traffic capture of havka server against a broker.
+/**
+ * Reads trace written by the server with `capture_path` option and sends
+ * the same requests: every captured connection is replayed by its own
+ * client in its own thread, requests are sent at their captured time
+ * divided by speed (speed 0 sends them as fast as possible). Posted
+ * messages have captured size and 'x' as data, seek requests set offset 0
+ * because offsets are not captured. Latency is measured from the intended
+ * send time to the response, so a server slower than the trace is not
+ * hidden by the replay slowing down.
+ *
+ * Usage:
+ *  havka-replay --trace=FILE [--address=127.0.0.1] [--port=9090]
+ *               [--speed=1] [--drain=5]
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "client/client.h"
+#include "histogram.h"
+#include "server/capture.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+/// Options of replay
+struct ReplayOptions {
+    std::string trace;
+    std::string address{"127.0.0.1"};
+    unsigned short port{9090};
+    double speed{1};
+    int drain{5};
+};
+
+/// Results of one request type
+struct TypeResults {
+    std::uint64_t sent{0};
+    std::uint64_t errors{0};
+    havka::Histogram latency;
+};
+
+/// Results shared by all threads
+struct ReplayResults {
+    std::atomic<std::uint64_t> done{0};
+    std::atomic<int> finished{0};
+    std::mutex mutex;
+    std::map<havka::RequestType, TypeResults> types;
+    havka::Histogram latency;
+    Clock::time_point lastResponse;
+};
+
+/**
+ * Parses options in format --name=value
+ * @return true on success
+ */
+bool parseOptions(int argc, char* argv[], ReplayOptions& options) {
+    std::map<std::string, std::string> values;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto eq = arg.find('=');
+        if (arg.rfind("--", 0) != 0 || eq == std::string::npos) {
+            std::cerr << "Unknown argument '" << arg << "'\n";
+            return false;
+        }
+        values[arg.substr(2, eq - 2)] = arg.substr(eq + 1);
+    }
+    try {
+        for (const auto& [name, value] : values) {
+            if (name == "trace") {
+                options.trace = value;
+            } else if (name == "address") {
+                options.address = value;
+            } else if (name == "port") {
+                options.port = std::stoi(value);
+            } else if (name == "speed") {
+                options.speed = std::stod(value);
+            } else if (name == "drain") {
+                options.drain = std::stoi(value);
+            } else {
+                std::cerr << "Unknown option '" << name << "'\n";
+                return false;
+            }
+        }
+    } catch (std::exception& e) {
+        std::cerr << "Invalid option value: " << e.what() << '\n';
+        return false;
+    }
+    if (options.trace.empty()) {
+        std::cerr << "Trace file is not set\n";
+        return false;
+    }
+    if (options.speed < 0 || options.drain < 0) {
+        std::cerr << "Speed and drain must not be negative\n";
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Sends one captured request
+ * @return true if broker responded successfully
+ */
+bool sendRequest(havka::BrokerSyncClient& client,
+                 const havka::CaptureRecord& record,
+                 const std::string& payload) {
+    switch (record.type) {
+        case havka::RequestType::PostMessageSafe: {
+            havka::Message message;
+            message.setData(payload.c_str(), record.payloadSize,
+                            havka::MessageDataType::Binary);
+            return client.postMessage(message, record.topic, record.type);
+        }
+        case havka::RequestType::GetMessageBlocking:
+        case havka::RequestType::GetMessageNonblocking:
+            /// nonblocking get of empty queue is not an error of replay
+            return client.getMessage(record.topic, record.type,
+                                     record.group) ||
+                   record.type == havka::RequestType::GetMessageNonblocking;
+        case havka::RequestType::SeekOffset:
+            return client.seek(record.topic, record.group, 0).has_value();
+        default:
+            return false;
+    }
+}
+
+void runConnection(const std::vector<havka::CaptureRecord>& records,
+                   const ReplayOptions& options, std::size_t maxPayload,
+                   Clock::time_point start, ReplayResults& results) {
+    havka::BrokerSyncClient client(
+        boost::asio::ip::make_address(options.address), options.port,
+        maxPayload + 1024);
+    bool connected = client.connect();
+    std::string payload(maxPayload, 'x');
+    std::this_thread::sleep_until(start);
+    for (const auto& record : records) {
+        auto intended = start;
+        if (options.speed > 0) {
+            intended += std::chrono::duration_cast<Clock::duration>(
+                std::chrono::duration<double, std::nano>(record.time /
+                                                         options.speed));
+            std::this_thread::sleep_until(intended);
+        } else {
+            intended = Clock::now();
+        }
+        bool ok = connected && sendRequest(client, record, payload);
+        auto now = Clock::now();
+        std::uint64_t latency =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::max(now - intended, Clock::duration::zero()))
+                .count();
+        {
+            std::lock_guard<std::mutex> lock(results.mutex);
+            auto& type = results.types[record.type];
+            ++type.sent;
+            if (ok) {
+                type.latency.record(latency);
+                results.latency.record(latency);
+            } else {
+                ++type.errors;
+            }
+            results.lastResponse = now;
+        }
+        ++results.done;
+    }
+    ++results.finished;
+}
+
+void printLatency(const std::string& name, const havka::Histogram& latency) {
+    std::cout << "  " << std::setw(24) << std::left << name << std::right
+              << std::setw(10) << latency.getCount() << std::fixed
+              << std::setprecision(1) << std::setw(12)
+              << latency.getPercentile(50) / 1000.0 << std::setw(12)
+              << latency.getPercentile(99) / 1000.0 << std::setw(12)
+              << latency.getPercentile(99.9) / 1000.0 << std::setw(12)
+              << latency.getMax() / 1000.0 << '\n';
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    ReplayOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        return 1;
+    }
+
+    havka::CaptureReader reader(options.trace);
+    if (!reader.good()) {
+        std::cerr << "Can not read trace '" << options.trace << "'\n";
+        return 1;
+    }
+    /// records are split by captured connection, writer does not keep
+    /// strict time order between connections
+    std::map<std::uint64_t, std::vector<havka::CaptureRecord>> connections;
+    std::uint64_t total = 0;
+    std::uint64_t duration = 0;
+    std::size_t maxPayload = 0;
+    havka::CaptureRecord record;
+    while (reader.next(record)) {
+        ++total;
+        duration = std::max(duration, record.time);
+        maxPayload = std::max<std::size_t>(maxPayload, record.payloadSize);
+        connections[record.connection].push_back(record);
+    }
+    for (auto& [id, records] : connections) {
+        std::stable_sort(records.begin(), records.end(),
+                         [](const auto& lhs, const auto& rhs) {
+                             return lhs.time < rhs.time;
+                         });
+    }
+
+    ReplayResults results;
+    auto start = Clock::now() + std::chrono::milliseconds(200);
+    std::vector<std::thread> threads;
+    for (const auto& [id, records] : connections) {
+        threads.emplace_back(runConnection, std::cref(records),
+                             std::cref(options), maxPayload, start,
+                             std::ref(results));
+    }
+    if (options.speed > 0) {
+        std::this_thread::sleep_until(
+            start + std::chrono::duration_cast<Clock::duration>(
+                        std::chrono::duration<double, std::nano>(
+                            duration / options.speed)));
+    }
+    /// blocking gets may wait for messages which are never posted
+    auto drainDeadline = Clock::now() + std::chrono::seconds(options.drain);
+    while (results.finished < static_cast<int>(threads.size()) &&
+           Clock::now() < drainDeadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    std::lock_guard<std::mutex> lock(results.mutex);
+    double elapsed = std::max(
+        std::chrono::duration<double>(results.lastResponse - start).count(),
+        1e-9);
+    std::uint64_t sent = 0;
+    std::uint64_t errors = 0;
+    for (const auto& [type, typeResults] : results.types) {
+        sent += typeResults.sent;
+        errors += typeResults.errors;
+    }
+    std::cout << "Trace: " << options.trace << ", records: " << total
+              << ", connections: " << connections.size() << ", duration: "
+              << std::fixed << std::setprecision(3) << duration / 1e9
+              << " s, speed: ";
+    if (options.speed > 0) {
+        std::cout << options.speed << "x\n";
+    } else {
+        std::cout << "max\n";
+    }
+    std::cout << "Sent: " << sent << ", errors: " << errors
+              << ", unfinished: " << total - results.done << '\n';
+    std::cout << "Throughput: " << std::fixed << std::setprecision(1)
+              << (sent - errors) / elapsed << " req/s\n";
+    std::cout << "Latency, us:\n";
+    std::cout << "  " << std::setw(24) << std::left << "type" << std::right
+              << std::setw(10) << "count" << std::setw(12) << "p50"
+              << std::setw(12) << "p99" << std::setw(12) << "p99.9"
+              << std::setw(12) << "max" << '\n';
+    for (const auto& [type, typeResults] : results.types) {
+        std::string name = havka::getStringFromRequestType(type);
+        printLatency(name.substr(name.find("::") + 2), typeResults.latency);
+    }
+    printLatency("all", results.latency);
+    std::cout.flush();
+    /// blocked connections are not joined, process exits without them
+    std::_Exit(errors > 0 ? 2 : 0);
+}